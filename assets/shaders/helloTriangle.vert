@@ -5,11 +5,16 @@ layout(binding = 0) uniform UniformBufferObject
 	vec3 resolution;
 	float time;
 	vec3 cameraPos;
+	uint frameIndex; // number of frames accumulated since the last reset
 	mat4 model;
 	mat4 viewProj;
 	mat4 invView;
 	mat4 invProj;
 	mat4 invViewProj;
+	mat4 prevViewProj; // of the frame the history was accumulated in
+	vec3 prevCameraPos;
+	uint viewChanged; // since the history was accumulated, it's reprojected if it has
+	uint maxBounces; // of the paths, see `TraceRay()` in `raytracing.glsl`
 }
 ubo;
 
@@ -0,0 +1,34 @@
+#version 450
+
+// drawn while the ray tracing pipeline is built, see `Engine::CreatePipelines()`
+
+layout(binding = 0) uniform UniformBufferObject
+{
+	vec3 resolution;
+	float time;
+	vec3 cameraPos;
+	uint frameIndex; // number of frames accumulated since the last reset
+	mat4 model;
+	mat4 viewProj;
+	mat4 invView;
+	mat4 invProj;
+	mat4 invViewProj;
+	mat4 prevViewProj; // of the frame the history was accumulated in
+	vec3 prevCameraPos;
+	uint viewChanged; // since the history was accumulated, it's reprojected if it has
+	uint maxBounces; // of the paths, see `TraceRay()` in `raytracing.glsl`
+}
+ubo;
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inRayDir;
+
+layout(location = 0) out vec4 outColor;
+
+void main()
+{
+	// sky gradient with a slow pulse, so it's visible that the renderer is alive
+	float t = 0.5 * (normalize(inRayDir).y + 1.0);
+	vec3 color = mix(vec3(1.0), vec3(0.5, 0.7, 1.0), t) * (0.85 + 0.15 * sin(ubo.time * 4.0));
+	outColor = vec4(color, 1.0);
+}
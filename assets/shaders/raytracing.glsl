@@ -0,0 +1,927 @@
+// ray tracing functions shared by `raytracing.frag` and `raytracing.comp`
+// the including shader has to declare the uniform buffer (`ubo`), the
+// accumulation and history images before including this file, and call `InitSampler()` before tracing
+
+const float PI = 3.14159265359;
+const float MAX_FLOAT = 1.0 / 0.0;
+const float MIN_HIT_BIAS = 0.001; // prevents shadow acne caused by lack of floating point precision
+
+const uint MAX_SAMPLES = 4;
+const uint MAX_BOUNCES = 1 << 6; // 2^n, `ubo.maxBounces` can lower it
+
+// russian roulette: from this bounce on, a path survives with the probability of its largest attenuation
+// (at most `MAX_SURVIVAL_PROBABILITY`) and the survivors are weighted up by it, so the dim paths end early
+// without changing the average
+const uint ROULETTE_START_BOUNCE = 3;
+const float MAX_SURVIVAL_PROBABILITY = 0.95;
+
+const vec3 LUMINANCE_WEIGHTS = vec3(0.2126, 0.7152, 0.0722); // Rec. 709
+
+// samples a reprojected history can count for, so that the changes the reprojection can't follow (e.g. the
+// reflections, which move with the view) fade out quickly while the camera moves
+const float MAX_REPROJECTED_SAMPLES = 16.0;
+// relative difference of the distances to the first hit, and the cosine between the normals, for which
+// the history of a pixel is still the same surface (otherwise it was disoccluded)
+const float MAX_HISTORY_DEPTH_DIFFERENCE = 0.05;
+const float MIN_HISTORY_NORMAL_COSINE = 0.9;
+// distance of the "hit" of the rays that miss everything, so that the sky is reprojected like a far away surface
+const float SKY_DISTANCE = 1e4;
+
+
+// ---------------------------------------
+
+// sampler: Owen scrambled Sobol points
+// (Burley 2020, "Practical Hash-based Owen Scrambling", https://jcgt.org/published/0009/04/01/)
+// the samples of a pixel are indexed by the accumulated frame, and the dimensions are drawn in pairs from a
+// 2D Sobol sequence that is shuffled and scrambled differently for every pixel and every pair, so the samples of
+// a pixel are stratified in every pair, and a pixel, sample and dimension always get the same value
+struct Sampler
+{
+	uint seed; // of the pixel
+	uint sampleIndex;
+	uint dimension; // next pair of dimensions
+};
+
+Sampler g_Sampler;
+
+// pairs of dimensions of the primary ray (the jitter within the pixel), and of every bounce (the russian
+// roulette, the scattered direction, and the radius or the choice between reflection and refraction)
+const uint PIXEL_SAMPLE_PAIRS = 1;
+const uint BOUNCE_SAMPLE_PAIRS = 3;
+// first pair of a bounce that is used for the roulette, and for the scattering
+const uint ROULETTE_SAMPLE_PAIR = 0;
+const uint SCATTER_SAMPLE_PAIR = 1;
+
+// https://nullprogram.com/blog/2018/07/31/ (lowbias32)
+uint Hash(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7feb352dU;
+	x ^= x >> 15;
+	x *= 0x846ca68bU;
+	x ^= x >> 16;
+	return x;
+}
+
+// a random permutation of the bits that only depends on the lower ones (the first bits of the reversed value)
+uint LaineKarrasPermutation(uint x, const uint seed)
+{
+	x += seed;
+	x ^= x * 0x6c50b47cU;
+	x ^= x * 0xb82f1e52U;
+	x ^= x * 0xc7afe638U;
+	x ^= x * 0x8d22f6e6U;
+	return x;
+}
+
+// flips the bits of `x` in the order of a binary tree (Owen scrambling), keeping the stratification
+uint NestedUniformScramble(const uint x, const uint seed)
+{
+	return bitfieldReverse(LaineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+/**
+ * @param `index` of the point
+ * @returns the first two dimensions of the Sobol sequence, as 32 bit fractions
+ */
+uvec2 Sobol2D(uint index)
+{
+	uvec2 p = uvec2(bitfieldReverse(index), 0U);
+	for (uint v = 1U << 31; index != 0U; index >>= 1, v ^= v >> 1)
+	{
+		if ((index & 1U) != 0U)
+			p.y ^= v;
+	}
+	return p;
+}
+
+/**
+ * starts the sequence of a sample, has to be called before any other sampler function
+ * @param `pixel` coordinates of the pixel
+ * @param `sampleIndex` of the sample within the pixel (e.g. the accumulated frame)
+ */
+void InitSampler(const ivec2 pixel, const uint sampleIndex)
+{
+	g_Sampler = Sampler(Hash(uint(pixel.x) ^ Hash(uint(pixel.y))), sampleIndex, 0U);
+}
+
+/**
+ * every bounce draws from its own dimensions, whatever the previous bounces have drawn
+ * @param `bounce` index of the bounce
+ * @param `pair` the next samples are the dimensions of the bounce from this pair on (e.g. `SCATTER_SAMPLE_PAIR`)
+ */
+void SetSampleBounce(const uint bounce, const uint pair)
+{
+	g_Sampler.dimension = PIXEL_SAMPLE_PAIRS + bounce * BOUNCE_SAMPLE_PAIRS + pair;
+}
+
+/**
+ * @returns the next pair of dimensions of the sample, within [0, 1)
+ */
+vec2 Sample2D()
+{
+	uint seed = Hash(g_Sampler.seed ^ Hash(g_Sampler.dimension));
+	++g_Sampler.dimension;
+
+	// the shuffled index decorrelates the pairs of dimensions from each other
+	uint index = NestedUniformScramble(g_Sampler.sampleIndex, seed);
+	uvec2 p = Sobol2D(index);
+	p.x = NestedUniformScramble(p.x, Hash(seed + 1U));
+	p.y = NestedUniformScramble(p.y, Hash(seed + 2U));
+	// 24 bits, so that the float can't be rounded up to 1
+	return vec2(p >> 8) * (1.0 / float(1U << 24));
+}
+
+/**
+ * @returns the next dimension of the sample (the second one of its pair is unused), within [0, 1)
+ */
+float Sample1D()
+{
+	return Sample2D().x;
+}
+
+/**
+ * @returns random normalized vec3, uniformly distributed on the unit sphere
+ */
+vec3 randNormSphereVec()
+{
+	vec2 u = Sample2D();
+	float z = 1.0 - 2.0 * u.x;
+	float r = sqrt(max(1.0 - z * z, 0.0));
+	float phi = 2.0 * PI * u.y;
+	return vec3(r * cos(phi), r * sin(phi), z);
+}
+
+/**
+ * @returns random vec3 within a unit sphere
+ */
+vec3 randUnitSphere()
+{
+	vec3 direction = randNormSphereVec();
+	return direction * pow(Sample1D(), 1.0 / 3.0);
+}
+
+/**
+ * @param `normal` normal of the surface
+ * @returns normalized random vec3 within a unit hemisphere
+ */
+vec3 randNormHemisphere(const vec3 normal)
+{
+	vec3 onSphere = randNormSphereVec();
+	if (dot(onSphere, normal) > 0.0)
+		return onSphere;
+
+	// flip the points if not aligned with the normal
+	return -onSphere;
+}
+
+// ---------------------------------------
+
+// NOTE: Always normalize the direction when initializing
+struct Ray
+{
+	vec3 origin;
+	vec3 direction;
+};
+
+/**
+ * @param `r` Ray object
+ * @param `t` distance from the ray origin
+ * @returns value of the ray hit point at distance `t`
+ */
+vec3 RayAt(const Ray r, float t)
+{
+	return r.origin + t * r.direction;
+}
+
+// --------- primitive objects ------------------
+
+// types of materials
+const uint LAMBERTIAN = 0; // diffuse
+const uint METAL = 1;
+const uint DIELECTRIC = 2; // glass / refractive
+
+// the scene is uploaded by `Scene` (engine/scene.h), keep the layouts in sync
+struct Material
+{
+	vec3 albedo;
+	uint type;
+
+	// metal
+	float roughness; // [0, 1]
+
+	// dielectric
+	float refractiveIndex;
+
+	// a path ends when it hits the material after this many bounces, 0 if only `ubo.maxBounces` limits it
+	uint maxBounces;
+};
+
+struct Sphere
+{
+	vec3 center;
+	float radius;
+	uint materialIndex;
+};
+
+struct Plane
+{
+	vec3 normal;
+	uint materialIndex;
+	vec3 position; // a point on the plane
+};
+
+// every primitive type has its own array, and refers to its material by index
+layout(std430, binding = 3) readonly buffer MaterialBuffer
+{
+	uint materialCount;
+	Material materials[];
+};
+
+layout(std430, binding = 4) readonly buffer SphereBuffer
+{
+	uint sphereCount;
+	Sphere spheres[];
+};
+
+layout(std430, binding = 5) readonly buffer PlaneBuffer
+{
+	uint planeCount;
+	Plane planes[];
+};
+
+// node of the BVH over the bounded primitives (spheres, triangles), see `Bvh` (engine/bvh.h)
+struct BvhNode
+{
+	vec3 boundsMin;
+	uint leftOrFirst; // inner node: index of the left child (the right one follows it), leaf: first primitive ref
+	vec3 boundsMax;
+	uint primitiveCount; // 0 for inner nodes
+};
+
+layout(std430, binding = 6) readonly buffer BvhNodeBuffer
+{
+	uint nodeCount;
+	BvhNode nodes[];
+};
+
+// primitive references in leaf order, the type is stored in the upper bits and the index in the rest
+const uint PRIMITIVE_INDEX_BITS = 28;
+const uint PRIMITIVE_INDEX_MASK = (1u << PRIMITIVE_INDEX_BITS) - 1u;
+const uint PRIMITIVE_SPHERE = 0;
+const uint PRIMITIVE_TRIANGLE = 1;
+
+layout(std430, binding = 7) readonly buffer PrimitiveRefBuffer
+{
+	uint primitiveRefCount;
+	layout(offset = 16) uint primitiveRefs[]; // same header size as the other scene buffers
+};
+
+// `Bvh::s_TraversalStackSize` (engine/bvh.h), the tree isn't built deeper than the stack
+const uint BVH_STACK_SIZE = 64;
+
+// `Vertex` (engine/types.h) is tightly packed (32 bytes), so it's read as two vec4s
+// position = `data0.xyz`, normal = (`data0.w`, `data1.xy`) (0 if the mesh has no normals), tex coord = `data1.zw`
+struct PackedVertex
+{
+	vec4 data0;
+	vec4 data1;
+};
+
+struct Triangle
+{
+	uvec3 indices; // into the vertex array
+	uint materialIndex;
+};
+
+layout(std430, binding = 8) readonly buffer VertexBuffer
+{
+	uint vertexCount;
+	PackedVertex vertices[];
+};
+
+layout(std430, binding = 9) readonly buffer TriangleBuffer
+{
+	uint triangleCount;
+	Triangle triangles[];
+};
+
+// to record the closest object hit
+// the material is only fetched for the final hit (see `TraceRay()`)
+struct HitRecord
+{
+	float closestT;
+	vec3 normal;
+	vec3 point; // point of hit
+	uint materialIndex; // material of the object at point of hit
+};
+
+// ---------- hit functions for primitives ----------------
+
+/**
+ * @param `sphere`
+ * @param `r` ray
+ * @param `rec` used to pass the hit info
+ * calculates if the ray hit the sphere and stores the hit info in `rec` if it did
+ */
+bool HitSphere(const Sphere sphere, const Ray r, inout HitRecord rec)
+{
+	// equation of a sphere
+	// (x - c) . (x - c) - r ^ 2 = 0
+	// in the quadriatic equation
+	// a = dir . dir
+	// b = 2 * (dir . (org - center))
+	// c = org . org - radius^2
+	// replace b = 2h in quadriatic equation
+	// (-h +- sqrt(h^2 - ac)) / a
+	// NOTE: the dot product of itself can be replaced with length squared
+
+	vec3 originToCenter = r.origin - sphere.center;
+	// float a = dot(r.direction, r.direction); // NOTE: if the ray direction is not normalized uncomment this
+	float a = 1.0f; // ray direction is normalized so dot product is 1.0
+	float h = dot(r.direction, originToCenter);
+	float c = dot(originToCenter, originToCenter) - sphere.radius * sphere.radius;
+
+	float discriminant = h * h - a * c;
+
+	if (discriminant < 0)
+		return false;
+
+	float t = (-h - sqrt(discriminant)) / a;
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		rec.materialIndex = sphere.materialIndex;
+		// radius is the magnitude of a vector from the center to the surface of the sphere
+		// so we are basically normalizing the normal vector of the sphere
+		rec.normal = (rec.point - sphere.center) / sphere.radius;
+		return true; // no need to calc further if the camera is outside the sphere
+	}
+
+	// useful if the camera is inside the sphere
+	t = (-h + sqrt(discriminant)) / a;
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		rec.materialIndex = sphere.materialIndex;
+		// radius is the magnitude of a vector from the center to the surface of the sphere
+		// so we are basically normalizing the normal vector of the sphere
+		rec.normal = (rec.point - sphere.center) / sphere.radius;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @param `plane`
+ * @param `r` ray
+ * @param `rec` used to pass the hit info
+ * calculates if the ray hit the sphere and stores the hit info in `rec` if it did
+ */
+bool HitPlane(const Plane plane, const Ray r, inout HitRecord rec)
+{
+	// equation of a plane
+	// (p - p0) . n = 0
+	// p is any point on the plane
+	// p0 is position (of a point on the plane)
+	// n is normal of the plane
+	float numerator = dot(plane.position - r.origin, plane.normal);
+	float denominator = dot(r.direction, plane.normal);
+
+	// the ray did not intersect the plane
+	if (denominator == 0.0)
+		return false;
+
+	float t = numerator / denominator;
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		rec.materialIndex = plane.materialIndex;
+		rec.normal = plane.normal;
+
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Moller-Trumbore intersection
+ * @param `triangle`
+ * @param `r` ray
+ * @param `rec` used to pass the hit info
+ * calculates if the ray hit the triangle and stores the hit info in `rec` if it did
+ */
+bool HitTriangle(const Triangle triangle, const Ray r, inout HitRecord rec)
+{
+	PackedVertex v0 = vertices[triangle.indices.x];
+	PackedVertex v1 = vertices[triangle.indices.y];
+	PackedVertex v2 = vertices[triangle.indices.z];
+
+	vec3 edge1 = v1.data0.xyz - v0.data0.xyz;
+	vec3 edge2 = v2.data0.xyz - v0.data0.xyz;
+	vec3 p = cross(r.direction, edge2);
+	float det = dot(edge1, p);
+	// the ray is parallel to the triangle
+	if (det == 0.0)
+		return false;
+
+	float invDet = 1.0 / det;
+	vec3 originToV0 = r.origin - v0.data0.xyz;
+	float u = dot(originToV0, p) * invDet;
+	if (u < 0.0 || u > 1.0)
+		return false;
+
+	vec3 q = cross(originToV0, edge1);
+	float v = dot(r.direction, q) * invDet;
+	if (v < 0.0 || u + v > 1.0)
+		return false;
+
+	float t = dot(edge2, q) * invDet;
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		// the vertices without a normal use the normal of the triangle
+		vec3 normal = (1.0 - u - v) * vec3(v0.data0.w, v0.data1.xy) + u * vec3(v1.data0.w, v1.data1.xy)
+					  + v * vec3(v2.data0.w, v2.data1.xy);
+		if (dot(normal, normal) == 0.0)
+			normal = cross(edge1, edge2);
+		rec.normal = normalize(normal);
+		rec.materialIndex = triangle.materialIndex;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * slab test of an axis aligned box
+ * @param `invDir` reciprocal of the ray direction
+ * @param `closestT` distance to the closest hit so far
+ * @returns distance to the entry point of the box, or `MAX_FLOAT` if the ray misses
+ * it or if the box is farther than the closest hit
+ */
+float HitAabb(const vec3 boundsMin, const vec3 boundsMax, const Ray r, const vec3 invDir, const float closestT)
+{
+	vec3 t0 = (boundsMin - r.origin) * invDir;
+	vec3 t1 = (boundsMax - r.origin) * invDir;
+	vec3 tMin = min(t0, t1);
+	vec3 tMax = max(t0, t1);
+	float tNear = max(max(tMin.x, tMin.y), tMin.z);
+	float tFar = min(min(tMax.x, tMax.y), tMax.z);
+
+	if (tFar >= max(tNear, 0.0) && tNear < closestT)
+		return tNear;
+
+	return MAX_FLOAT;
+}
+
+/**
+ * @param `ref` packed primitive reference of a BVH leaf
+ * calls the hit function of the primitive type and stores the hit info in `rec`
+ */
+bool HitPrimitive(const uint ref, const Ray r, inout HitRecord rec)
+{
+	uint index = ref & PRIMITIVE_INDEX_MASK;
+	switch (ref >> PRIMITIVE_INDEX_BITS)
+	{
+	case PRIMITIVE_SPHERE:
+		return HitSphere(spheres[index], r, rec);
+	case PRIMITIVE_TRIANGLE:
+		return HitTriangle(triangles[index], r, rec);
+	}
+
+	return false;
+}
+
+/**
+ * calls the appropriate hit function and stores the hit info in `rec`
+ * the hit info initially has the furthest value of `t` (the
+ * scalar parameter of the parametric equation of a line (ray)),
+ * and if the ray instersects an object `t` is updated
+ *
+ * @param `r` ray
+ * @param `rec` used to pass the hit info
+ * @returns true if the ray instersects the objects, and false if it doesn't.
+ */
+bool Hit(const Ray r, inout HitRecord rec)
+{
+	bool isHit = false;
+	rec.closestT = MAX_FLOAT;
+
+	// the planes are unbounded, so they are not part of the BVH
+	// testing them first also makes the BVH traversal skip everything behind them
+	for (uint i = 0; i < planeCount; ++i)
+		isHit = HitPlane(planes[i], r, rec) || isHit;
+
+	if (nodeCount == 0)
+		return isHit;
+
+	vec3 invDir = 1.0 / r.direction;
+	uint stack[BVH_STACK_SIZE];
+	uint stackSize = 0;
+	uint nodeIndex = 0;
+	while (true)
+	{
+		BvhNode node = nodes[nodeIndex];
+		if (node.primitiveCount > 0) // leaf
+		{
+			for (uint i = 0; i < node.primitiveCount; ++i)
+				isHit = HitPrimitive(primitiveRefs[node.leftOrFirst + i], r, rec) || isHit;
+
+			if (stackSize == 0)
+				break;
+			nodeIndex = stack[--stackSize];
+			continue;
+		}
+
+		// visit the closer child first and push the other one
+		uint nearChild = node.leftOrFirst;
+		uint farChild = node.leftOrFirst + 1;
+		float tNear = HitAabb(nodes[nearChild].boundsMin, nodes[nearChild].boundsMax, r, invDir, rec.closestT);
+		float tFar = HitAabb(nodes[farChild].boundsMin, nodes[farChild].boundsMax, r, invDir, rec.closestT);
+		if (tNear > tFar)
+		{
+			uint child = nearChild;
+			nearChild = farChild;
+			farChild = child;
+			float t = tNear;
+			tNear = tFar;
+			tFar = t;
+		}
+
+		if (tNear == MAX_FLOAT)
+		{
+			if (stackSize == 0)
+				break;
+			nodeIndex = stack[--stackSize];
+			continue;
+		}
+
+		// at most one child per inner node on the way to the leaf, the tree isn't deeper than the stack
+		nodeIndex = nearChild;
+		if (tFar != MAX_FLOAT)
+			stack[stackSize++] = farChild;
+	}
+
+	return isHit;
+}
+
+
+// ----------  Ray scatter/reflect functions for materials ----------------
+
+/**
+ * @param `normal` normalized normal of the surface
+ * @returns random direction (not normalized)
+ */
+vec3 Diffuse(const vec3 normal)
+{
+	// instead of just randomly casting rays, the rays should be scattered towards the direction of the normal
+	return normal + randNormHemisphere(normal);
+}
+
+/**
+ * @param `rayDir` normalized direction of the ray
+ * @param `normal` normalized normal of the surface
+ * @returns direction of a perfectly reflected ray (not normalized)
+ */
+vec3 Reflect(const vec3 rayDir, const vec3 normal)
+{
+	return rayDir - 2 * dot(rayDir, normal) * normal;
+}
+
+/**
+ * Schlick's Approximation for reflectance of a dielectric material
+ * @param `cosine` cosine of the angle between ray direction and the normal
+ * @param `refractiveIndex` refractive index of the material
+ * @returns contribution of Fresnel factor in reflection
+ */
+float Schlick(const float cosine, const float refractiveIndex)
+{
+	// Use Schlick's approximation for reflectance.
+	float r0 = (1.0 - refractiveIndex) / (1.0 + refractiveIndex);
+	r0 = r0 * r0;
+	return r0 + (1.0 - r0) * pow((1.0 - cosine), 5.0);
+}
+
+/**
+ * // NOTE: this function also checks for total internal reflection and returns
+ * the direction of the reflected ray if the ray doesn't get refracted.
+ *
+ * @param `rayDir` normalized direction of the ray
+ * @param `normal` normlized normal of the surface
+ * @param `refractiveIndex` refractive index of the material
+ * @returns direction of a perfectly reflected ray (not normalized)
+ */
+vec3 Refract(const vec3 rayDir, const vec3 normal, const float refractiveIndex)
+{
+	vec3 n = vec3(0.0); // normal
+	float ri = 0.0; // refractive index
+
+	// check if front face
+	float rDotN = dot(rayDir, normal);
+	if (rDotN > 0.0) // back face
+	{
+		n = -normal;
+		ri = refractiveIndex;
+	}
+	else // front face
+	{
+		n = normal;
+		ri = 1.0 / refractiveIndex;
+	}
+
+	float cosTheta = min(dot(-rayDir, n), 1.0);
+	float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+	float random = Sample1D();
+
+	if ((ri * sinTheta) > 1.0 || (Schlick(cosTheta, ri) > random)) // cannot refract
+		return Reflect(rayDir, n);
+
+	vec3 rayOutPerp = ri * (rayDir + cosTheta * n);
+	vec3 rayOutPara = -sqrt(abs(1.0 - dot(rayOutPerp, rayOutPerp))) * n;
+	return rayOutPerp + rayOutPara;
+}
+
+
+// --------------------------------------------------------
+
+// the images are only indexed with constants, so the
+// `shaderStorageImageArrayDynamicIndexing` feature is not required
+vec4 LoadAccumulation(const uint index, const ivec2 pixel)
+{
+	if (index == 0u)
+		return imageLoad(accumulationImages[0], pixel);
+
+	return imageLoad(accumulationImages[1], pixel);
+}
+
+void StoreAccumulation(const uint index, const ivec2 pixel, const vec4 value)
+{
+	if (index == 0u)
+		imageStore(accumulationImages[0], pixel, value);
+	else
+		imageStore(accumulationImages[1], pixel, value);
+}
+
+// same as the accumulation images, the history images hold the number of samples (x), and the depth (y) and
+// normal (zw, octahedral) of the first hit of each pixel
+vec4 LoadHistory(const uint index, const ivec2 pixel)
+{
+	if (index == 0u)
+		return imageLoad(historyImages[0], pixel);
+
+	return imageLoad(historyImages[1], pixel);
+}
+
+void StoreHistory(const uint index, const ivec2 pixel, const vec4 value)
+{
+	if (index == 0u)
+		imageStore(historyImages[0], pixel, value);
+	else
+		imageStore(historyImages[1], pixel, value);
+}
+
+// maps a unit vector to the octahedron unfolded onto [-1, 1]^2
+vec2 EncodeNormal(const vec3 n)
+{
+	vec2 p = n.xy / (abs(n.x) + abs(n.y) + abs(n.z));
+	if (n.z < 0.0)
+		p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+	return p;
+}
+
+vec3 DecodeNormal(const vec2 p)
+{
+	vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+	if (n.z < 0.0)
+		n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
+// features of the first hit of a camera ray, they guide the denoiser (see `denoise.comp`)
+struct FirstHit
+{
+	vec3 albedo; // the sky color if the ray doesn't hit anything
+	vec3 normal; // of the surface, the reversed ray direction if it doesn't hit anything
+	float depth; // distance along the (normalized) ray, negative if it doesn't hit anything
+};
+
+/**
+ * russian roulette, the path continues with the probability of its largest attenuation
+ * @param `bounce` index of the bounce, there is no roulette before `ROULETTE_START_BOUNCE`
+ * @param `attenuation` of the path, weighted up by the probability if it survives
+ * @returns false if the path ends
+ */
+bool SurvivesRoulette(const uint bounce, inout vec3 attenuation)
+{
+	if (bounce < ROULETTE_START_BOUNCE)
+		return true;
+
+	SetSampleBounce(bounce, ROULETTE_SAMPLE_PAIR);
+	float survival = min(max(attenuation.r, max(attenuation.g, attenuation.b)), MAX_SURVIVAL_PROBABILITY);
+	if (Sample1D() >= survival)
+		return false;
+
+	attenuation /= survival;
+	return true;
+}
+
+/**
+ * @param `direction` normalized direction of the ray that doesn't hit anything
+ * @returns the ambient color
+ */
+vec3 SkyColor(const vec3 direction)
+{
+	float a = 0.5 * (direction.y + 1.0);
+	return (1.0 - a) * vec3(1.0) + a * vec3(0.5, 0.7, 1.0);
+}
+
+/**
+ * @param `r` ray
+ * @param `firstHit` features of the first object hit
+ * @returns color of the closest object hit
+ */
+vec4 TraceRay(Ray r, out FirstHit firstHit)
+{
+	vec3 attenuation = vec3(1.0);
+	firstHit = FirstHit(vec3(1.0), -r.direction, -1.0);
+
+	HitRecord rec;
+	uint maxBounces = min(ubo.maxBounces, MAX_BOUNCES);
+	for (uint bounces = 0; bounces < maxBounces; ++bounces)
+	{
+		if (!SurvivesRoulette(bounces, attenuation))
+			break;
+
+		// if hit, then attenuate the color and
+		// cast the ray in a random direction
+		if (Hit(r, rec))
+		{
+			Material mat = materials[rec.materialIndex];
+			if (mat.maxBounces != 0 && bounces >= mat.maxBounces)
+				break;
+			if (bounces == 0)
+				firstHit = FirstHit(mat.albedo, rec.normal, rec.closestT);
+			attenuation *= mat.albedo;
+			vec3 direction = vec3(0.0);
+
+			SetSampleBounce(bounces, SCATTER_SAMPLE_PAIR);
+
+			switch (mat.type)
+			{
+			case LAMBERTIAN:
+				direction = normalize(Diffuse(rec.normal));
+				break;
+
+			case METAL:
+				direction = normalize(Reflect(r.direction, rec.normal) + mat.roughness * randUnitSphere());
+				break;
+
+			case DIELECTRIC:
+				direction = normalize(Refract(r.direction, rec.normal, mat.refractiveIndex));
+				break;
+			}
+
+			r = Ray(rec.point, direction);
+			continue;
+		}
+
+		// if the ray doesn't intesect anything while bouncing,
+		// return the attenuated ambient color
+		vec3 skyGradient = SkyColor(r.direction);
+		if (bounces == 0)
+			firstHit.albedo = skyGradient;
+		return vec4(attenuation * skyGradient, 1.0);
+	}
+
+	return vec4(0.0, 0.0, 0.0, 1.0);
+}
+
+/**
+ * anti-aliasing without multisampling: every accumulated frame traces a different point of the
+ * pixel, so the average converges to the pixel's area (the first frame traces its center)
+ * the sampler has to be at the first dimension (right after `InitSampler()`)
+ * @returns offset from the pixel center, within [-0.5, 0.5)
+ */
+vec2 PixelJitter()
+{
+	vec2 jitter = Sample2D() - 0.5;
+	return ubo.frameIndex == 0 ? vec2(0.0) : jitter;
+}
+
+/**
+ * @param `ndc` normalized device coords [-1, 1] of the point on the screen
+ * @returns direction of the primary ray (not normalized)
+ */
+vec3 PrimaryRayDir(const vec2 ndc)
+{
+	// world space
+	vec4 far = ubo.invViewProj * vec4(ndc, 1.0, 1.0);
+	far /= far.w;
+	vec4 near = ubo.invViewProj * vec4(ndc, 0.0, 1.0);
+	near /= near.w;
+
+	return far.xyz - near.xyz;
+}
+
+/**
+ * reprojects the first hit of the pixel into the previous frame, and blends the history of the (up to 4)
+ * pixels around it that saw the same surface (bilinear, the disoccluded ones are rejected)
+ * @param `pixel` coordinates of the pixel
+ * @param `firstHit` of the current sample
+ * @param `average` returns the reprojected running average (and average of the squared luminance)
+ * @returns number of samples of the reprojected history, 0 if there is none
+ */
+float ReprojectHistory(const ivec2 pixel, const FirstHit firstHit, out vec4 average)
+{
+	average = vec4(0.0);
+
+	// the hit is moved onto the ray through the pixel center, so that a still camera maps every pixel onto itself
+	vec2 ndc = (vec2(pixel) + 0.5) / ubo.resolution.xy * 2.0 - 1.0;
+	float depth = firstHit.depth < 0.0 ? SKY_DISTANCE : firstHit.depth;
+	vec3 point = ubo.cameraPos + normalize(PrimaryRayDir(ndc)) * depth;
+
+	vec4 prevClip = ubo.prevViewProj * vec4(point, 1.0);
+	if (prevClip.w <= 0.0)
+		return 0.0;
+	// pixel coords in the previous frame, the centers of the pixels are at integer coords
+	vec2 prevPos = (prevClip.xy / prevClip.w * 0.5 + 0.5) * ubo.resolution.xy - 0.5;
+	ivec2 base = ivec2(floor(prevPos));
+	vec2 f = prevPos - vec2(base);
+	float prevDepth = firstHit.depth < 0.0 ? -1.0 : distance(point, ubo.prevCameraPos);
+
+	uint historyIndex = (ubo.frameIndex + 1u) & 1u;
+	float sampleCount = 0.0;
+	float weightSum = 0.0;
+	for (int i = 0; i < 4; ++i)
+	{
+		ivec2 offset = ivec2(i & 1, i >> 1);
+		ivec2 tap = base + offset;
+		if (any(lessThan(tap, ivec2(0))) || any(greaterThanEqual(tap, ivec2(ubo.resolution.xy))))
+			continue;
+
+		vec4 history = LoadHistory(historyIndex, tap);
+		if (history.x == 0.0 || (prevDepth < 0.0) != (history.y < 0.0))
+			continue;
+		if (prevDepth >= 0.0
+			&& (abs(prevDepth - history.y) > MAX_HISTORY_DEPTH_DIFFERENCE * prevDepth
+				|| dot(firstHit.normal, DecodeNormal(history.zw)) < MIN_HISTORY_NORMAL_COSINE))
+			continue;
+
+		vec2 w = mix(vec2(1.0) - f, f, vec2(offset));
+		float weight = w.x * w.y;
+		average += LoadAccumulation(historyIndex, tap) * weight;
+		sampleCount += history.x * weight;
+		weightSum += weight;
+	}
+
+	// a history that only matches at the far corners of the bilinear footprint is too unreliable
+	if (weightSum < 0.01)
+		return 0.0;
+
+	average /= weightSum;
+	return min(sampleCount / weightSum, MAX_REPROJECTED_SAMPLES);
+}
+
+/**
+ * adds `color` to the running average of the pixel (in linear space)
+ * the alpha channel holds the average of the squared luminance, so the denoiser
+ * can estimate the variance of the samples (see `denoise.comp`)
+ * if the view has changed, the average is continued from the reprojected history
+ * @param `pixel` coordinates of the pixel in the accumulation images
+ * @param `color` color of the current sample
+ * @param `firstHit` of the current sample, finds the history of the surface after the camera has moved
+ * @returns average of all the samples since the last reset
+ */
+vec3 Accumulate(const ivec2 pixel, const vec3 color, const FirstHit firstHit)
+{
+	float luminance = dot(color, LUMINANCE_WEIGHTS);
+	vec4 average = vec4(color, luminance * luminance);
+
+	float historySamples = 0.0;
+	vec4 history = vec4(0.0);
+	if (ubo.frameIndex > 0u && ubo.viewChanged != 0u)
+	{
+		historySamples = ReprojectHistory(pixel, firstHit, history);
+	}
+	else if (ubo.frameIndex > 0u)
+	{
+		historySamples = LoadHistory((ubo.frameIndex + 1u) & 1u, pixel).x;
+		history = LoadAccumulation((ubo.frameIndex + 1u) & 1u, pixel);
+	}
+	average = mix(history, average, 1.0 / (historySamples + 1.0));
+
+	StoreAccumulation(ubo.frameIndex & 1u, pixel, average);
+	StoreHistory(ubo.frameIndex & 1u,
+		pixel,
+		vec4(historySamples + 1.0, firstHit.depth, EncodeNormal(firstHit.normal)));
+
+	return average.xyz;
+}
+
@@ -1,13 +1,10 @@
 #version 450
 
-vec3 positions[6] = vec3[](
+// a single triangle covering the viewport (a quad shades the 2x2 pixel blocks along its diagonal twice)
+vec3 positions[3] = vec3[](
 	vec3(-1.0, -1.0, 0.0),
-	vec3(-1.0,  1.0, 0.0),
-	vec3( 1.0,  1.0, 0.0),
-
-	vec3( 1.0,  1.0, 0.0),
-	vec3( 1.0, -1.0, 0.0),
-	vec3(-1.0, -1.0, 0.0)
+	vec3(-1.0,  3.0, 0.0),
+	vec3( 3.0, -1.0, 0.0)
 );
 
 layout(binding = 0) uniform UniformBufferObject
@@ -15,11 +12,16 @@ layout(binding = 0) uniform UniformBufferObject
 	vec3 resolution;
 	float time;
 	vec3 cameraPos;
+	uint frameIndex; // number of frames accumulated since the last reset
 	mat4 model;
 	mat4 viewProj;
 	mat4 invView;
 	mat4 invProj;
 	mat4 invViewProj;
+	mat4 prevViewProj; // of the frame the history was accumulated in
+	vec3 prevCameraPos;
+	uint viewChanged; // since the history was accumulated, it's reprojected if it has
+	uint maxBounces; // of the paths, see `TraceRay()` in `raytracing.glsl`
 }
 ubo;
 
@@ -0,0 +1,426 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+#include "core/core.h"
+#include "engine/engine.h"
+
+namespace {
+
+// camera position and target at `time` (0 = first frame, 1 = last frame)
+struct CameraKeyframe
+{
+	float time;
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+struct BenchmarkOptions
+{
+	uint32_t warmupFrameCount = 10; // not measured, e.g. the first frames still create resources
+	std::string pathFile; // camera keyframes, the default path if empty
+	std::string jsonPath = "benchmark.json";
+	std::string csvPath; // a row is appended to it
+};
+
+struct BenchmarkResult
+{
+	float startupMs = 0.0f; // from creating the engine to the first frame (including the pipeline build)
+	float meanMs = 0.0f;
+	float p50Ms = 0.0f;
+	float p95Ms = 0.0f;
+	float p99Ms = 0.0f;
+	float minMs = 0.0f;
+	float maxMs = 0.0f;
+	double raysPerSecond = 0.0; // camera rays, one per traced pixel (adaptive sampling skips the converged ones)
+};
+
+// still for the first half of the frames (the image accumulates), then around the spheres
+const std::vector<CameraKeyframe> s_DefaultCameraPath{
+	{ 0.0f, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+	{ 0.5f, glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 0.0f, -1.0f) },
+	{ 0.75f, glm::vec3(1.5f, 0.5f, 0.5f), glm::vec3(0.0f, 0.0f, -1.0f) },
+	{ 1.0f, glm::vec3(-1.5f, 0.8f, 0.5f), glm::vec3(0.0f, 0.0f, -1.0f) },
+};
+
+/**
+ * Reads camera keyframes, one per line: `time px py pz tx ty tz` (lines starting with `#` are skipped)
+ * @param path file with the keyframes, sorted by time
+ */
+std::vector<CameraKeyframe> LoadCameraPath(const std::string& path)
+{
+	std::ifstream file{ path };
+	THROW(!file.is_open(), "Error opening camera path: {}", path)
+
+	std::vector<CameraKeyframe> keyframes;
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		std::istringstream stream{ line };
+		CameraKeyframe keyframe{};
+		stream >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+			>> keyframe.target.x >> keyframe.target.y >> keyframe.target.z;
+		THROW(stream.fail(), "Invalid camera keyframe: {}", line)
+		keyframes.push_back(keyframe);
+	}
+	THROW(keyframes.empty(), "The camera path {} has no keyframes!", path)
+
+	return keyframes;
+}
+
+// interpolates the keyframes linearly
+void MoveCamera(const std::vector<CameraKeyframe>& keyframes, float time, Camera& camera)
+{
+	auto next = std::find_if(keyframes.begin(), keyframes.end(), [time](const CameraKeyframe& keyframe) {
+		return keyframe.time >= time;
+	});
+	if (next == keyframes.begin() || next == keyframes.end())
+	{
+		const CameraKeyframe& keyframe = next == keyframes.end() ? keyframes.back() : keyframes.front();
+		camera.LookAt(keyframe.position, keyframe.target);
+		return;
+	}
+
+	const CameraKeyframe& previous = *(next - 1);
+	const float t = (time - previous.time) / std::max(next->time - previous.time, 1e-6f);
+	camera.LookAt(glm::mix(previous.position, next->position, t), glm::mix(previous.target, next->target, t));
+}
+
+// nearest rank percentile of the sorted values
+float Percentile(const std::vector<float>& sortedValues, float percentile)
+{
+	const auto rank = static_cast<size_t>(std::ceil(percentile / 100.0f * static_cast<float>(sortedValues.size())));
+	return sortedValues[std::clamp<size_t>(rank, 1, sortedValues.size()) - 1];
+}
+
+/**
+ * Parses the command line arguments
+ * --width <pixels>      width of the offscreen image
+ * --height <pixels>     height of the offscreen image
+ * --frames <count>      number of measured frames
+ * --warmup <count>      number of frames rendered before the measured ones
+ * --fragment            trace rays in a fullscreen fragment pass instead of the compute shader
+ * --shader <name>       program of the fragment path (raytracing, shader, random, helloTriangle)
+ * --spheres <count>     number of random spheres added to the scene
+ * --mesh <path>         .obj mesh added to the scene
+ * --time <seconds>      value of `ubo.time` in every frame
+ * --frames-in-flight <count> number of frames recorded while the device works on the previous ones
+ * --render-scale <s>    resolution of the ray traced image relative to the output (0.25 to 1), upscaled to it
+ * --denoise <count>     iterations of the denoiser (0 to 5)
+ * --no-reprojection     restart the accumulation every frame instead of reprojecting the samples along the path
+ * --max-bounces <count> bounces of the ray traced paths (1 to 64)
+ * --noise-threshold <t> adaptive sampling, pixels whose noise is lower aren't sampled (0 disables it)
+ * --wavefront           trace the paths in stages with one kernel per material
+ * --path <path>         camera keyframes (`time px py pz tx ty tz` per line, time from 0 to 1)
+ * --json <path>         results written as JSON
+ * --csv <path>          results appended as a CSV row
+ * --output <path>       the last frame is written here (.ppm)
+ * @returns false if the arguments are invalid
+ */
+bool ParseArgs(int argc, char** argv, EngineProps& props, BenchmarkOptions& options)
+{
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (std::strcmp(arg, "--width") == 0 && hasValue)
+			{
+				props.width = std::stoull(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--height") == 0 && hasValue)
+			{
+				props.height = std::stoull(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+			{
+				props.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--warmup") == 0 && hasValue)
+			{
+				options.warmupFrameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--fragment") == 0)
+			{
+				props.computeRayTracing = false;
+			}
+			else if (std::strcmp(arg, "--shader") == 0 && hasValue)
+			{
+				props.fragmentProgram = argv[++i];
+			}
+			else if (std::strcmp(arg, "--spheres") == 0 && hasValue)
+			{
+				props.sphereCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--mesh") == 0 && hasValue)
+			{
+				props.meshPath = argv[++i];
+			}
+			else if (std::strcmp(arg, "--time") == 0 && hasValue)
+			{
+				props.fixedTime = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--frames-in-flight") == 0 && hasValue)
+			{
+				props.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--render-scale") == 0 && hasValue)
+			{
+				props.renderScale = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--denoise") == 0 && hasValue)
+			{
+				props.denoiseIterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--no-reprojection") == 0)
+			{
+				props.reprojection = false;
+			}
+			else if (std::strcmp(arg, "--max-bounces") == 0 && hasValue)
+			{
+				props.maxBounces = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--noise-threshold") == 0 && hasValue)
+			{
+				props.noiseThreshold = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--wavefront") == 0)
+			{
+				props.wavefront = true;
+			}
+			else if (std::strcmp(arg, "--path") == 0 && hasValue)
+			{
+				options.pathFile = argv[++i];
+			}
+			else if (std::strcmp(arg, "--json") == 0 && hasValue)
+			{
+				options.jsonPath = argv[++i];
+			}
+			else if (std::strcmp(arg, "--csv") == 0 && hasValue)
+			{
+				options.csvPath = argv[++i];
+			}
+			else if (std::strcmp(arg, "--output") == 0 && hasValue)
+			{
+				props.outputPath = argv[++i];
+			}
+			else
+			{
+				Logger::Error("Invalid argument: {}", arg);
+				return false;
+			}
+		}
+	}
+	catch (const std::exception&)
+	{
+		Logger::Error("Invalid argument value!");
+		return false;
+	}
+
+	if (props.width == 0 || props.height == 0 || props.frameCount == 0)
+	{
+		Logger::Error("Width, height and frame count must be greater than 0!");
+		return false;
+	}
+	if (!props.fragmentProgram.empty() && props.computeRayTracing)
+	{
+		Logger::Error("--shader selects a program of the fragment path (--fragment)!");
+		return false;
+	}
+
+	return true;
+}
+
+void WriteJson(const std::string& path,
+	const EngineProps& props,
+	uint32_t warmupFrameCount,
+	const BenchmarkResult& result)
+{
+	std::ofstream file{ path };
+	THROW(!file.is_open(), "Error opening file: {}", path)
+
+	file << "{\n"
+		 << "  \"shader\": \"" << (props.computeRayTracing ? "compute" : "fragment") << "\",\n"
+		 << "  \"program\": \"" << (props.fragmentProgram.empty() ? "raytracing" : props.fragmentProgram) << "\",\n"
+		 << "  \"width\": " << props.width << ",\n"
+		 << "  \"height\": " << props.height << ",\n"
+		 << "  \"frames\": " << props.frameCount << ",\n"
+		 << "  \"warmupFrames\": " << warmupFrameCount << ",\n"
+		 << "  \"spheres\": " << props.sphereCount << ",\n"
+		 << "  \"framesInFlight\": " << props.framesInFlight << ",\n"
+		 << "  \"renderScale\": " << props.renderScale << ",\n"
+		 << "  \"denoiseIterations\": " << props.denoiseIterations << ",\n"
+		 << "  \"reprojection\": " << (props.reprojection ? "true" : "false") << ",\n"
+		 << "  \"maxBounces\": " << props.maxBounces << ",\n"
+		 << "  \"noiseThreshold\": " << props.noiseThreshold << ",\n"
+		 << "  \"wavefront\": " << (props.wavefront ? "true" : "false") << ",\n"
+		 << "  \"startupMs\": " << result.startupMs << ",\n"
+		 << "  \"frameTimeMs\": { \"mean\": " << result.meanMs << ", \"p50\": " << result.p50Ms
+		 << ", \"p95\": " << result.p95Ms << ", \"p99\": " << result.p99Ms << ", \"min\": " << result.minMs
+		 << ", \"max\": " << result.maxMs << " },\n"
+		 << "  \"raysPerSecond\": " << result.raysPerSecond << "\n"
+		 << "}\n";
+}
+
+// appends a row, so the results of several runs (e.g. one per commit) can be compared
+void AppendCsv(const std::string& path, const EngineProps& props, const BenchmarkResult& result)
+{
+	// the options of the run (like in the JSON), then the results
+	const std::string header =
+		"shader,program,width,height,frames,spheres,"
+		"frames_in_flight,"
+		"render_scale,"
+		"denoise_iterations,"
+		"reprojection,"
+		"max_bounces,"
+		"noise_threshold,"
+		"wavefront,"
+		"startup_ms,mean_ms,p50_ms,p95_ms,p99_ms,rays_per_second";
+
+	// the rows of another set of columns (e.g. written by another commit) would be misaligned
+	const bool writeHeader = !std::filesystem::exists(path) || std::filesystem::is_empty(path);
+	if (!writeHeader)
+	{
+		std::ifstream existingFile{ path };
+		std::string existingHeader;
+		std::getline(existingFile, existingHeader);
+		THROW(existingHeader != header, "The columns of {} differ from the current ones, use another file", path)
+	}
+
+	std::ofstream file{ path, std::ios::app };
+	THROW(!file.is_open(), "Error opening file: {}", path)
+
+	if (writeHeader)
+		file << header << "\n";
+	file << (props.computeRayTracing ? "compute" : "fragment") << ","
+		 << (props.fragmentProgram.empty() ? "raytracing" : props.fragmentProgram) << "," << props.width << ","
+		 << props.height << "," << props.frameCount << "," << props.sphereCount << ","
+		 << props.framesInFlight << ","
+		 << props.renderScale << ","
+		 << props.denoiseIterations << ","
+		 << (props.reprojection ? "true" : "false") << ","
+		 << props.maxBounces << ","
+		 << props.noiseThreshold << ","
+		 << (props.wavefront ? "true" : "false") << ","
+		 << result.startupMs << "," << result.meanMs << "," << result.p50Ms << "," << result.p95Ms << ","
+		 << result.p99Ms << "," << result.raysPerSecond << "\n";
+}
+
+} // namespace
+
+/**
+ * Renders a fixed number of headless frames along a camera path and reports the frame times
+ * The frame time is the time between the starts of two frames, with the frames in flight
+ * it's limited by the device once the queue is full.
+ */
+int main(int argc, char** argv)
+{
+	Logger::Init();
+
+	EngineProps props{ "Shaders Basics benchmark", 1280, 720 };
+	props.headless = true;
+	props.frameCount = 300;
+	props.fixedTime = 0.0f;
+	props.outputPath.clear();
+	BenchmarkOptions options{};
+	if (!ParseArgs(argc, argv, props, options))
+	{
+		Logger::Info("Usage: {} [--width <pixels>] [--height <pixels>] [--frames <count>] [--warmup <count>] "
+					 "[--fragment] [--shader <name>] [--spheres <count>] [--mesh <path.obj>] [--time <seconds>] "
+					 "[--frames-in-flight <count>] [--render-scale <scale>] [--denoise <count>] [--path <path>] "
+					 "[--no-reprojection] [--max-bounces <count>] [--noise-threshold <t>] [--wavefront] "
+					 "[--json <path.json>] [--csv <path.csv>] [--output <path.ppm>]",
+			argv[0]);
+		return 1;
+	}
+
+	const std::vector<CameraKeyframe> keyframes =
+		options.pathFile.empty() ? s_DefaultCameraPath : LoadCameraPath(options.pathFile);
+	const uint32_t measuredFrameCount = props.frameCount;
+	const uint32_t warmupFrameCount = options.warmupFrameCount;
+
+	// the start of one more frame ends the last measured frame
+	const std::chrono::time_point<std::chrono::steady_clock> createTime = std::chrono::steady_clock::now();
+	std::vector<std::chrono::time_point<std::chrono::steady_clock>> frameStartTimes;
+	frameStartTimes.reserve(warmupFrameCount + measuredFrameCount + 1);
+	EngineProps engineProps = props;
+	engineProps.frameCount = warmupFrameCount + measuredFrameCount + 1;
+	engineProps.onHeadlessFrame = [&](uint32_t frameIndex, Camera& camera) {
+		frameStartTimes.push_back(std::chrono::steady_clock::now());
+		// the warmup frames stay at the start of the path
+		const uint32_t pathFrame = frameIndex > warmupFrameCount ? frameIndex - warmupFrameCount : 0;
+		MoveCamera(keyframes,
+			static_cast<float>(pathFrame) / static_cast<float>(std::max(measuredFrameCount - 1, 1u)),
+			camera);
+	};
+
+	// the engine is gone before the results are computed
+	std::vector<uint64_t> tracedPixelCounts;
+	try
+	{
+		Engine* engine = Engine::Create(engineProps);
+		engine->Run();
+		tracedPixelCounts = engine->GetTracedPixelCounts();
+		delete engine;
+	}
+	catch (const std::exception& e)
+	{
+		Logger::Error("Benchmark failed: {}", e.what());
+		return 1;
+	}
+
+	std::vector<float> frameTimes;
+	for (uint32_t i = warmupFrameCount; i < warmupFrameCount + measuredFrameCount; ++i)
+	{
+		frameTimes.push_back(
+			std::chrono::duration<float, std::chrono::milliseconds::period>(frameStartTimes[i + 1] - frameStartTimes[i])
+				.count());
+	}
+	std::sort(frameTimes.begin(), frameTimes.end());
+
+	BenchmarkResult result{};
+	result.startupMs =
+		std::chrono::duration<float, std::chrono::milliseconds::period>(frameStartTimes.front() - createTime).count();
+	double totalMs = 0.0;
+	for (float frameTime : frameTimes)
+		totalMs += frameTime;
+	result.meanMs = static_cast<float>(totalMs / static_cast<double>(frameTimes.size()));
+	result.p50Ms = Percentile(frameTimes, 50.0f);
+	result.p95Ms = Percentile(frameTimes, 95.0f);
+	result.p99Ms = Percentile(frameTimes, 99.0f);
+	result.minMs = frameTimes.front();
+	result.maxMs = frameTimes.back();
+	// the pixels traced by the measured frames, at the render scale and without the ones adaptive sampling skipped
+	// (the frame numbers are the indices of the headless frames)
+	uint64_t tracedPixelCount = 0;
+	for (uint32_t i = warmupFrameCount; i < warmupFrameCount + measuredFrameCount && i < tracedPixelCounts.size(); ++i)
+		tracedPixelCount += tracedPixelCounts[i];
+	result.raysPerSecond = static_cast<double>(tracedPixelCount) / (totalMs / 1000.0);
+
+	Logger::Info("Startup: {:.2f} ms, frame time: {:.3f} ms mean, {:.3f} ms p50, {:.3f} ms p95, {:.3f} ms p99, "
+				 "{:.2f} Mrays/s",
+		result.startupMs,
+		result.meanMs,
+		result.p50Ms,
+		result.p95Ms,
+		result.p99Ms,
+		result.raysPerSecond / 1.0e6);
+
+	if (!options.jsonPath.empty())
+		WriteJson(options.jsonPath, props, warmupFrameCount, result);
+	if (!options.csvPath.empty())
+		AppendCsv(options.csvPath, props, result);
+
+	return 0;
+}
@@ -0,0 +1,99 @@
+#include "core/mappedFile.h"
+
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+#include "core/core.h"
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char* path)
+{
+	HANDLE file = CreateFileA(
+		path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	THROW(file == INVALID_HANDLE_VALUE, "Error opening file: {}", path)
+	m_FileHandle = file;
+
+	LARGE_INTEGER size{};
+	if (!GetFileSizeEx(file, &size))
+	{
+		Close();
+		LOG_AND_THROW("Error reading the size of file: {}", path)
+	}
+	m_Size = static_cast<size_t>(size.QuadPart);
+	// empty files cannot be mapped
+	if (m_Size == 0)
+		return;
+
+	m_MappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_MappingHandle)
+		m_Data = static_cast<const char*>(MapViewOfFile(m_MappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (!m_Data)
+	{
+		Close();
+		LOG_AND_THROW("Error mapping file: {}", path)
+	}
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+		UnmapViewOfFile(m_Data);
+	if (m_MappingHandle)
+		CloseHandle(m_MappingHandle);
+	if (m_FileHandle)
+		CloseHandle(m_FileHandle);
+}
+
+#else
+
+MappedFile::MappedFile(const char* path)
+{
+	m_FileDescriptor = open(path, O_RDONLY);
+	THROW(m_FileDescriptor < 0, "Error opening file: {}", path)
+
+	struct stat fileStat{};
+	if (fstat(m_FileDescriptor, &fileStat) != 0)
+	{
+		Close();
+		LOG_AND_THROW("Error reading the size of file: {}", path)
+	}
+	m_Size = static_cast<size_t>(fileStat.st_size);
+	// empty files cannot be mapped
+	if (m_Size == 0)
+		return;
+
+	void* data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, m_FileDescriptor, 0);
+	if (data == MAP_FAILED)
+	{
+		Close();
+		LOG_AND_THROW("Error mapping file: {}", path)
+	}
+	m_Data = static_cast<const char*>(data);
+	// the file is parsed front to back
+	madvise(data, m_Size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::Close()
+{
+	if (m_Data)
+		munmap(const_cast<char*>(m_Data), m_Size);
+	if (m_FileDescriptor >= 0)
+		close(m_FileDescriptor);
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
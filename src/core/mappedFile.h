@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+/**
+ * Read-only memory mapping of a whole file
+ * The pages are loaded by the OS on demand, so large files can be parsed
+ * without reading them into memory first.
+ */
+class MappedFile
+{
+public:
+	explicit MappedFile(const char* path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// NOTE: the data is not null terminated
+	[[nodiscard]] inline const char* GetData() const { return m_Data; }
+	[[nodiscard]] inline size_t GetSize() const { return m_Size; }
+
+private:
+	// also used to clean up when the constructor fails
+	void Close();
+
+private:
+	const char* m_Data = nullptr;
+	size_t m_Size = 0;
+
+#ifdef _WIN32
+	void* m_FileHandle = nullptr;
+	void* m_MappingHandle = nullptr;
+#else
+	int m_FileDescriptor = -1;
+#endif
+};
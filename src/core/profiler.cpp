@@ -0,0 +1,190 @@
+#include "core/profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "core/core.h"
+
+namespace {
+
+// scopes kept per thread (power of 2), ~1.5 MiB per buffer
+constexpr uint64_t s_EventCapacity = 1 << 16;
+
+struct ProfileEvent
+{
+	// atomic, because the exporting thread can read an event while it's overwritten
+	std::atomic<const char*> name{ nullptr };
+	std::atomic<uint64_t> beginNs{ 0 };
+	std::atomic<uint64_t> endNs{ 0 };
+};
+
+} // namespace
+
+struct ProfileThreadBuffer
+{
+	uint32_t threadId = 0;
+	std::string threadName;
+	bool isInUse = true; // the buffer of an exited thread is reused by the next new thread
+
+	// number of events written, and of the events that have started to be (over)written
+	std::atomic<uint64_t> head{ 0 };
+	std::atomic<uint64_t> reserved{ 0 };
+	std::unique_ptr<ProfileEvent[]> events{ new ProfileEvent[s_EventCapacity] };
+};
+
+namespace {
+
+std::mutex s_Mutex;
+std::vector<std::unique_ptr<ProfileThreadBuffer>> s_ThreadBuffers;
+
+// hands the buffer over to the next new thread when the thread exits
+struct ThreadBufferHandle
+{
+	ProfileThreadBuffer* buffer = nullptr;
+
+	~ThreadBufferHandle()
+	{
+		if (!buffer)
+			return;
+
+		std::lock_guard<std::mutex> lock{ s_Mutex };
+		buffer->isInUse = false;
+	}
+};
+
+thread_local ThreadBufferHandle t_ThreadBuffer;
+
+} // namespace
+
+
+void Profiler::SetThreadName(const char* name)
+{
+	ProfileThreadBuffer& buffer = GetThreadBuffer();
+	std::lock_guard<std::mutex> lock{ s_Mutex };
+	buffer.threadName = name;
+}
+
+void Profiler::Record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+	ProfileThreadBuffer& buffer = GetThreadBuffer();
+
+	// `reserved` is published before the slot is overwritten, so the exporting thread
+	// can tell which of the events it has read may have been torn (see `ExportChromeTrace()`)
+	const uint64_t index = buffer.head.load(std::memory_order_relaxed);
+	buffer.reserved.store(index + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	ProfileEvent& event = buffer.events[index & (s_EventCapacity - 1)];
+	event.name.store(name, std::memory_order_relaxed);
+	event.beginNs.store(beginNs, std::memory_order_relaxed);
+	event.endNs.store(endNs, std::memory_order_relaxed);
+	buffer.head.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::ExportChromeTrace(const char* path)
+{
+	PROFILE_SCOPE("Profiler::ExportChromeTrace");
+
+	struct Event
+	{
+		uint32_t threadId;
+		const char* name;
+		uint64_t beginNs;
+		uint64_t endNs;
+	};
+
+	std::vector<std::pair<uint32_t, std::string>> threadNames;
+	std::vector<Event> events;
+	{
+		std::lock_guard<std::mutex> lock{ s_Mutex };
+		for (const auto& buffer : s_ThreadBuffers)
+		{
+			threadNames.emplace_back(buffer->threadId, buffer->threadName);
+
+			const uint64_t head = buffer->head.load(std::memory_order_acquire);
+			const size_t firstEvent = events.size();
+			for (uint64_t i = head > s_EventCapacity ? head - s_EventCapacity : 0; i < head; ++i)
+			{
+				const ProfileEvent& event = buffer->events[i & (s_EventCapacity - 1)];
+				events.push_back({ buffer->threadId,
+					event.name.load(std::memory_order_relaxed),
+					event.beginNs.load(std::memory_order_relaxed),
+					event.endNs.load(std::memory_order_relaxed) });
+			}
+
+			// drop the events the thread has started to overwrite while they were read
+			std::atomic_thread_fence(std::memory_order_acquire);
+			const uint64_t reserved = buffer->reserved.load(std::memory_order_relaxed);
+			const uint64_t firstValid = reserved > s_EventCapacity ? reserved - s_EventCapacity : 0;
+			const uint64_t firstRead = head > s_EventCapacity ? head - s_EventCapacity : 0;
+			if (firstValid > firstRead)
+			{
+				const auto droppedCount = static_cast<ptrdiff_t>(std::min(firstValid, head) - firstRead);
+				events.erase(events.begin() + static_cast<ptrdiff_t>(firstEvent),
+					events.begin() + static_cast<ptrdiff_t>(firstEvent) + droppedCount);
+			}
+		}
+	}
+
+	std::ofstream file{ path };
+	THROW(!file.is_open(), "Error opening trace file: {}", path)
+
+	// the timestamps are relative to the first one, in microseconds
+	uint64_t originNs = UINT64_MAX;
+	for (const Event& event : events)
+		originNs = std::min(originNs, event.beginNs);
+
+	file << "{\"traceEvents\":[";
+	bool isFirst = true;
+	for (const auto& [threadId, threadName] : threadNames)
+	{
+		file << (isFirst ? "" : ",") << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadId
+			 << ",\"args\":{\"name\":\""
+			 << (threadName.empty() ? "Thread " + std::to_string(threadId) : threadName) << "\"}}";
+		isFirst = false;
+	}
+	for (const Event& event : events)
+	{
+		// complete events ("X") with a duration, nested by their time ranges
+		file << (isFirst ? "" : ",") << "\n{\"name\":\"" << event.name
+			 << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadId
+			 << ",\"ts\":" << static_cast<double>(event.beginNs - originNs) / 1000.0
+			 << ",\"dur\":" << static_cast<double>(event.endNs - event.beginNs) / 1000.0 << "}";
+		isFirst = false;
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	Logger::Info("Exported {} CPU scope(s) of {} thread(s) to \"{}\"", events.size(), threadNames.size(), path);
+}
+
+ProfileThreadBuffer& Profiler::GetThreadBuffer()
+{
+	if (t_ThreadBuffer.buffer)
+		return *t_ThreadBuffer.buffer;
+
+	std::lock_guard<std::mutex> lock{ s_Mutex };
+	auto it = std::find_if(s_ThreadBuffers.begin(), s_ThreadBuffers.end(), [](const auto& buffer) {
+		return !buffer->isInUse;
+	});
+	if (it != s_ThreadBuffers.end())
+	{
+		// the scopes of the exited thread are discarded
+		ProfileThreadBuffer& buffer = **it;
+		buffer.threadName.clear();
+		buffer.isInUse = true;
+		buffer.head.store(0, std::memory_order_relaxed);
+		buffer.reserved.store(0, std::memory_order_relaxed);
+		t_ThreadBuffer.buffer = &buffer;
+		return buffer;
+	}
+
+	auto buffer = std::make_unique<ProfileThreadBuffer>();
+	buffer->threadId = static_cast<uint32_t>(s_ThreadBuffers.size());
+	t_ThreadBuffer.buffer = buffer.get();
+	s_ThreadBuffers.push_back(std::move(buffer));
+	return *t_ThreadBuffer.buffer;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+// the scopes are cheap enough to stay in release builds, -DSHADERS_BASICS_DISABLE_PROFILER compiles them out
+#ifndef SHADERS_BASICS_DISABLE_PROFILER
+	#define PROFILE_CONCAT_IMPL(a, b) a##b
+	#define PROFILE_CONCAT(a, b)      PROFILE_CONCAT_IMPL(a, b)
+	// records the time until the end of the enclosing scope, `name` has to outlive the profiler (string literal)
+	#define PROFILE_SCOPE(name)       ProfileScope PROFILE_CONCAT(profileScope, __LINE__){ name }
+	#define PROFILE_FUNCTION()        PROFILE_SCOPE(__func__)
+#else
+	#define PROFILE_SCOPE(name)
+	#define PROFILE_FUNCTION()
+#endif
+
+struct ProfileThreadBuffer;
+
+/**
+ * CPU scope profiler
+ * Every thread writes its scopes into its own fixed size ring buffer (single producer,
+ * no locks, the oldest scopes are overwritten), so recording a scope costs two clock
+ * reads and a few stores. The buffers are only locked when a thread records its first
+ * scope, exits, or when the trace is exported in the Chrome trace event format
+ * (chrome://tracing, Perfetto).
+ */
+class Profiler
+{
+public:
+	// the name shown in the trace, defaults to the order the threads recorded their first scope in
+	static void SetThreadName(const char* name);
+	// writes the scopes in the buffers of all the threads (including the ones that have exited)
+	static void ExportChromeTrace(const char* path);
+
+	[[nodiscard]] static inline uint64_t Now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::steady_clock::now().time_since_epoch())
+										 .count());
+	}
+
+	static void Record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+private:
+	static ProfileThreadBuffer& GetThreadBuffer();
+};
+
+class ProfileScope
+{
+public:
+	explicit ProfileScope(const char* name)
+		: m_Name{ name },
+		  m_BeginNs{ Profiler::Now() }
+	{}
+	~ProfileScope() { Profiler::Record(m_Name, m_BeginNs, Profiler::Now()); }
+
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* m_Name;
+	uint64_t m_BeginNs;
+};
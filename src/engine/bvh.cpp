@@ -0,0 +1,196 @@
+#include "engine/bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <utility>
+
+
+Bvh::Bvh(const std::vector<Aabb>& primitiveBounds)
+	: m_PrimitiveBounds{ &primitiveBounds }
+{
+	const uint32_t primitiveCount = static_cast<uint32_t>(primitiveBounds.size());
+	if (primitiveCount == 0)
+		return;
+
+	m_PrimitiveIndices.resize(primitiveCount);
+	std::iota(m_PrimitiveIndices.begin(), m_PrimitiveIndices.end(), 0);
+
+	m_Centroids.resize(primitiveCount);
+	for (uint32_t i = 0; i < primitiveCount; ++i)
+		m_Centroids[i] = primitiveBounds[i].GetCenter();
+
+	// a binary tree with `n` leaves has at most `2n - 1` nodes, so
+	// the node references stay valid while the tree is being built
+	m_Nodes.reserve(2 * static_cast<size_t>(primitiveCount) - 1);
+
+	BvhNode root{};
+	root.leftOrFirst = 0;
+	root.primitiveCount = primitiveCount;
+	UpdateNodeBounds(root);
+	m_Nodes.push_back(root);
+
+	// iterative instead of recursive, degenerate scenes can make the tree very deep
+	// pairs of (node index, depth)
+	std::vector<std::pair<uint32_t, uint32_t>> stack{ { 0, 1 } };
+	while (!stack.empty())
+	{
+		auto [nodeIndex, depth] = stack.back();
+		stack.pop_back();
+		m_Depth = std::max(m_Depth, depth);
+
+		// the nodes at the maximum depth stay leaves, the traversal could miss their children otherwise
+		if (depth >= s_TraversalStackSize || !Subdivide(nodeIndex))
+			continue;
+
+		const uint32_t leftIndex = m_Nodes[nodeIndex].leftOrFirst;
+		stack.emplace_back(leftIndex + 1, depth + 1);
+		stack.emplace_back(leftIndex, depth + 1);
+	}
+
+	m_Nodes.shrink_to_fit();
+	m_Centroids.clear();
+	m_Centroids.shrink_to_fit();
+	m_PrimitiveBounds = nullptr;
+}
+
+void Bvh::UpdateNodeBounds(BvhNode& node) const
+{
+	Aabb bounds{};
+	for (uint32_t i = 0; i < node.primitiveCount; ++i)
+		bounds.Grow((*m_PrimitiveBounds)[m_PrimitiveIndices[node.leftOrFirst + i]]);
+
+	node.boundsMin = bounds.min;
+	node.boundsMax = bounds.max;
+}
+
+Bvh::Split Bvh::FindBestSplit(const BvhNode& node) const
+{
+	struct Bin
+	{
+		Aabb bounds{};
+		uint32_t count = 0;
+	};
+
+	// the bins are spread over the bounds of the centroids, not of the primitives
+	Aabb centroidBounds{};
+	for (uint32_t i = 0; i < node.primitiveCount; ++i)
+		centroidBounds.Grow(m_Centroids[m_PrimitiveIndices[node.leftOrFirst + i]]);
+
+	Split best{};
+	for (int axis = 0; axis < 3; ++axis)
+	{
+		const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+		if (extent <= 0.0f)
+			continue;
+
+		Split split{};
+		split.axis = axis;
+		split.centroidMin = centroidBounds.min[axis];
+		split.binScale = static_cast<float>(s_BinCount) / extent;
+
+		std::array<Bin, s_BinCount> bins{};
+		for (uint32_t i = 0; i < node.primitiveCount; ++i)
+		{
+			const uint32_t primitiveIndex = m_PrimitiveIndices[node.leftOrFirst + i];
+			Bin& bin = bins[GetBin(split, primitiveIndex)];
+			bin.bounds.Grow((*m_PrimitiveBounds)[primitiveIndex]);
+			++bin.count;
+		}
+
+		// sweep from both sides to get the area and primitive count on
+		// each side of the `s_BinCount - 1` planes between the bins
+		std::array<float, s_BinCount - 1> leftArea{}, rightArea{};
+		std::array<uint32_t, s_BinCount - 1> leftCount{}, rightCount{};
+		Aabb leftBounds{}, rightBounds{};
+		uint32_t leftSum = 0, rightSum = 0;
+		for (uint32_t i = 0; i < s_BinCount - 1; ++i)
+		{
+			leftSum += bins[i].count;
+			leftCount[i] = leftSum;
+			leftBounds.Grow(bins[i].bounds);
+			leftArea[i] = leftBounds.GetHalfArea();
+
+			rightSum += bins[s_BinCount - 1 - i].count;
+			rightCount[s_BinCount - 2 - i] = rightSum;
+			rightBounds.Grow(bins[s_BinCount - 1 - i].bounds);
+			rightArea[s_BinCount - 2 - i] = rightBounds.GetHalfArea();
+		}
+
+		for (uint32_t i = 0; i < s_BinCount - 1; ++i)
+		{
+			if (leftCount[i] == 0 || rightCount[i] == 0)
+				continue;
+
+			const float cost = static_cast<float>(leftCount[i]) * leftArea[i]
+							   + static_cast<float>(rightCount[i]) * rightArea[i];
+			if (cost < best.cost)
+			{
+				best = split;
+				best.bin = i + 1;
+				best.cost = cost;
+			}
+		}
+	}
+
+	return best;
+}
+
+bool Bvh::Subdivide(uint32_t nodeIndex)
+{
+	BvhNode& node = m_Nodes[nodeIndex];
+	if (node.primitiveCount <= 1)
+		return false;
+
+	const Split split = FindBestSplit(node);
+	if (split.axis < 0)
+		return false;
+
+	// compare with the cost of intersecting every primitive of the node
+	Aabb nodeBounds{ node.boundsMin, node.boundsMax };
+	const float nodeArea = nodeBounds.GetHalfArea();
+	const float leafCost = static_cast<float>(node.primitiveCount) * nodeArea;
+	if (s_TraversalCost * nodeArea + split.cost >= leafCost)
+		return false;
+
+	// in-place partition of the primitive indices
+	uint32_t i = node.leftOrFirst;
+	uint32_t j = node.leftOrFirst + node.primitiveCount - 1;
+	while (i <= j)
+	{
+		if (GetBin(split, m_PrimitiveIndices[i]) < split.bin)
+		{
+			++i;
+		}
+		else
+		{
+			std::swap(m_PrimitiveIndices[i], m_PrimitiveIndices[j]);
+			if (j == 0)
+				break;
+			--j;
+		}
+	}
+
+	const uint32_t leftCount = i - node.leftOrFirst;
+	if (leftCount == 0 || leftCount == node.primitiveCount)
+		return false;
+
+	const uint32_t leftIndex = static_cast<uint32_t>(m_Nodes.size());
+	BvhNode left{};
+	left.leftOrFirst = node.leftOrFirst;
+	left.primitiveCount = leftCount;
+	UpdateNodeBounds(left);
+	BvhNode right{};
+	right.leftOrFirst = i;
+	right.primitiveCount = node.primitiveCount - leftCount;
+	UpdateNodeBounds(right);
+
+	// the node becomes an inner node
+	node.leftOrFirst = leftIndex;
+	node.primitiveCount = 0;
+
+	m_Nodes.push_back(left);
+	m_Nodes.push_back(right);
+
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <glm/glm.hpp>
+
+// axis aligned bounding box
+struct Aabb
+{
+	glm::vec3 min{ std::numeric_limits<float>::infinity() };
+	glm::vec3 max{ -std::numeric_limits<float>::infinity() };
+
+	inline void Grow(const glm::vec3& point)
+	{
+		min = glm::min(min, point);
+		max = glm::max(max, point);
+	}
+
+	inline void Grow(const Aabb& other)
+	{
+		min = glm::min(min, other.min);
+		max = glm::max(max, other.max);
+	}
+
+	[[nodiscard]] inline glm::vec3 GetCenter() const { return 0.5f * (min + max); }
+
+	// half of the surface area (the factor doesn't matter for the SAH)
+	[[nodiscard]] inline float GetHalfArea() const
+	{
+		glm::vec3 extent = max - min;
+		return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+	}
+};
+
+// node of the flattened BVH, matches the std430 layout of `BvhNode` in `assets/shaders/raytracing.glsl`
+struct BvhNode
+{
+	alignas(16) glm::vec3 boundsMin;
+	// inner node: index of the left child (the right child is at `leftOrFirst + 1`)
+	// leaf: index of the first primitive in the primitive index array
+	alignas(4) uint32_t leftOrFirst;
+	alignas(16) glm::vec3 boundsMax;
+	alignas(4) uint32_t primitiveCount; // 0 for inner nodes
+
+	[[nodiscard]] inline bool IsLeaf() const { return primitiveCount > 0; }
+};
+
+/**
+ * Bounding volume hierarchy built with the binned Surface Area Heuristic (SAH)
+ * The builder only works with the bounding boxes of the primitives, so any
+ * primitive type with finite bounds can be added. The nodes are stored
+ * depth-first in a single array with both children of a node next to each
+ * other, and the leaves refer to a range of `GetPrimitiveIndices()`.
+ */
+class Bvh
+{
+public:
+	Bvh() = default;
+	/**
+	 * @param primitiveBounds bounding box of every primitive
+	 */
+	explicit Bvh(const std::vector<Aabb>& primitiveBounds);
+
+	[[nodiscard]] inline const std::vector<BvhNode>& GetNodes() const { return m_Nodes; }
+	// indices into `primitiveBounds` (of the constructor), ordered by leaf
+	[[nodiscard]] inline const std::vector<uint32_t>& GetPrimitiveIndices() const { return m_PrimitiveIndices; }
+	// number of nodes from the root to the deepest leaf, at most `s_TraversalStackSize`
+	[[nodiscard]] inline uint32_t GetDepth() const { return m_Depth; }
+
+	// entries of the traversal stacks of the ray tracers (`BVH_STACK_SIZE` in `assets/shaders/raytracing.glsl`)
+	// every inner node on the way to a leaf pushes at most one child, so the tree is built at most this deep
+	static constexpr uint32_t s_TraversalStackSize = 64;
+
+private:
+	struct Split
+	{
+		int axis = -1; // -1 = no valid split
+		uint32_t bin = 0; // first bin of the right child
+		float cost = std::numeric_limits<float>::infinity();
+		float centroidMin = 0.0f;
+		float binScale = 0.0f; // bin count / centroid extent
+	};
+
+	void UpdateNodeBounds(BvhNode& node) const;
+	[[nodiscard]] Split FindBestSplit(const BvhNode& node) const;
+	// splits the node into two children if that's cheaper than keeping it as a leaf
+	bool Subdivide(uint32_t nodeIndex);
+
+	[[nodiscard]] inline uint32_t GetBin(const Split& split, uint32_t primitiveIndex) const
+	{
+		const float offset = m_Centroids[primitiveIndex][split.axis] - split.centroidMin;
+		return std::min(static_cast<uint32_t>(offset * split.binScale), s_BinCount - 1);
+	}
+
+private:
+	static constexpr uint32_t s_BinCount = 16;
+	// cost of traversing a node relative to intersecting a primitive
+	static constexpr float s_TraversalCost = 1.0f;
+
+	const std::vector<Aabb>* m_PrimitiveBounds = nullptr; // only valid during the build
+	std::vector<glm::vec3> m_Centroids;
+
+	std::vector<BvhNode> m_Nodes;
+	std::vector<uint32_t> m_PrimitiveIndices;
+	uint32_t m_Depth = 0;
+};
\ No newline at end of file
@@ -5,6 +5,7 @@
 #include <glm/gtx/quaternion.hpp>
 #include "imgui/imgui.h"
 #include "core/input.h"
+#include "core/profiler.h"
 
 
 Camera::Camera(float aspectRatio, glm::vec3 position, float yFov, float zNear, float zFar)
@@ -26,19 +27,13 @@ Camera::Camera(float aspectRatio, glm::vec3 position, float yFov, float zNear, f
 
 void Camera::OnUpdate(float deltatime)
 {
+	PROFILE_FUNCTION();
+
 	glm::vec2 mousePos = Input::GetMousePosition();
 	glm::vec2 deltaMousePos = (mousePos - m_LastMousePosition) * 0.01f;
 	m_LastMousePosition = mousePos;
 
-	// calc matrices
-	m_ViewMatrix = glm::lookAt(m_Position, m_Position + m_ForwardDirection, m_UpDirection);
-	m_ProjectionMatrix = glm::perspective(m_FOVy, m_AspectRatio, m_Near, m_Far);
-	m_ProjectionMatrix[1][1] *= -1; // flip y-coord
-	m_ViewProjectionMatrix = m_ProjectionMatrix * m_ViewMatrix;
-
-	m_InverseViewMatrix = glm::inverse(m_ViewMatrix);
-	m_InverseProjectionMatrix = glm::inverse(m_ProjectionMatrix);
-	m_InverseViewProjectionMatrix = glm::inverse(m_ViewProjectionMatrix);
+	UpdateMatrices();
 
 	// if ImGui is in focus, don't take keyboard input for camera
 	ImGuiIO& io = ImGui::GetIO();
@@ -92,4 +87,26 @@ void Camera::OnUpdate(float deltatime)
 			glm::cross(glm::angleAxis(-pitchDelta, m_RightDirection), glm::angleAxis(-yawDelta, m_UpDirection)));
 		m_ForwardDirection = glm::rotate(quaternion, m_ForwardDirection);
 	}
+}
+
+void Camera::LookAt(glm::vec3 position, glm::vec3 target)
+{
+	m_Position = position;
+	m_ForwardDirection = glm::normalize(target - position);
+	m_RightDirection = glm::normalize(glm::cross(m_ForwardDirection, m_UpDirection));
+}
+
+void Camera::UpdateMatrices()
+{
+	const glm::mat4 lastViewProjection = m_ViewProjectionMatrix;
+
+	m_ViewMatrix = glm::lookAt(m_Position, m_Position + m_ForwardDirection, m_UpDirection);
+	m_ProjectionMatrix = glm::perspective(m_FOVy, m_AspectRatio, m_Near, m_Far);
+	m_ProjectionMatrix[1][1] *= -1; // flip y-coord
+	m_ViewProjectionMatrix = m_ProjectionMatrix * m_ViewMatrix;
+	m_IsUpdated = m_ViewProjectionMatrix != lastViewProjection;
+
+	m_InverseViewMatrix = glm::inverse(m_ViewMatrix);
+	m_InverseProjectionMatrix = glm::inverse(m_ProjectionMatrix);
+	m_InverseViewProjectionMatrix = glm::inverse(m_ViewProjectionMatrix);
 }
\ No newline at end of file
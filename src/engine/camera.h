@@ -19,7 +19,11 @@ public:
 		float zFar = 100.0f);
 
 	void OnUpdate(float deltatime);
+	// recalculates the view and projection matrices without handling any input
+	void UpdateMatrices();
 
+	// true if the last update changed the view or projection
+	[[nodiscard]] inline bool IsUpdated() const { return m_IsUpdated; }
 	[[nodiscard]] inline glm::vec3 GetPosition() const { return m_Position; }
 	[[nodiscard]] inline glm::mat4 GetViewMatrix() const { return m_ViewMatrix; }
 	[[nodiscard]] inline glm::mat4 GetInverseViewMatrix() const { return m_InverseViewMatrix; }
@@ -30,6 +34,8 @@ public:
 
 	void SetAspectRatio(float aspectRatio) { m_AspectRatio = aspectRatio; }
 	void SetPosition(glm::vec3 position) { m_Position = position; }
+	// places the camera at `position`, facing `target`
+	void LookAt(glm::vec3 position, glm::vec3 target);
 
 private:
 	float m_AspectRatio;
@@ -51,6 +57,7 @@ private:
 	glm::mat4 m_InverseViewProjectionMatrix{};
 
 	glm::vec2 m_LastMousePosition{ 0.0f, 0.0f };
+	bool m_IsUpdated = true;
 
 	// for resetting the camera
 	const glm::vec3 m_BackupPosition;
@@ -0,0 +1,529 @@
+#include "engine/cpuRayTracer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include "core/core.h"
+#include "utils/utils.h"
+
+// everything in this namespace mirrors `assets/shaders/raytracing.glsl`,
+// keep them in sync when changing the shader
+namespace {
+
+constexpr float PI = 3.14159265359f;
+constexpr float MAX_FLOAT = std::numeric_limits<float>::infinity();
+constexpr float MIN_HIT_BIAS = 0.001f; // prevents shadow acne caused by lack of floating point precision
+
+constexpr uint32_t MAX_BOUNCES = 1 << 6; // 2^n
+
+// russian roulette, see `TraceRay()` in the shader
+constexpr uint32_t ROULETTE_START_BOUNCE = 3;
+constexpr float MAX_SURVIVAL_PROBABILITY = 0.95f;
+constexpr uint32_t BVH_STACK_SIZE = Bvh::s_TraversalStackSize;
+
+
+// ---------------------------------------
+
+// random number generator (PCG32)
+// every worker thread owns one and reseeds it for every pixel,
+// so the result doesn't depend on which thread traced which tile
+struct Rng
+{
+	uint64_t state = 0;
+
+	void Seed(uint64_t seed)
+	{
+		// splitmix64 to spread consecutive seeds
+		seed += 0x9e3779b97f4a7c15ULL;
+		seed = (seed ^ (seed >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		seed = (seed ^ (seed >> 27)) * 0x94d049bb133111ebULL;
+		state = seed ^ (seed >> 31);
+	}
+
+	uint32_t NextUint()
+	{
+		uint64_t oldState = state;
+		state = oldState * 6364136223846793005ULL + 1442695040888963407ULL;
+		uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18u) ^ oldState) >> 27u);
+		uint32_t rot = static_cast<uint32_t>(oldState >> 59u);
+		return (xorShifted >> rot) | (xorShifted << ((~rot + 1u) & 31u));
+	}
+
+	// random float within the range [0, 1)
+	float NextFloat() { return static_cast<float>(NextUint() >> 8) * (1.0f / 16777216.0f); }
+};
+
+/**
+ * @returns random vec3 within a unit sphere
+ */
+glm::vec3 RandUnitSphere(Rng& rng)
+{
+	float phi = 2.0f * PI * rng.NextFloat();
+	float cosTheta = 2.0f * rng.NextFloat() - 1.0f;
+	float u = rng.NextFloat();
+
+	float theta = std::acos(cosTheta);
+	float r = std::pow(u, 1.0f / 3.0f);
+
+	float x = r * std::sin(theta) * std::cos(phi);
+	float y = r * std::sin(theta) * std::sin(phi);
+	float z = r * std::cos(theta);
+
+	return glm::vec3(x, y, z);
+}
+
+/**
+ * @param `normal` normal of the surface
+ * @returns normalized random vec3 within a unit hemisphere
+ */
+glm::vec3 RandNormHemisphere(const glm::vec3& normal, Rng& rng)
+{
+	glm::vec3 onSphere = glm::normalize(RandUnitSphere(rng));
+	if (glm::dot(onSphere, normal) > 0.0f)
+		return onSphere;
+
+	// flip the points if not aligned with the normal
+	return -onSphere;
+}
+
+// ---------------------------------------
+
+// NOTE: Always normalize the direction when initializing
+struct Ray
+{
+	glm::vec3 origin;
+	glm::vec3 direction;
+};
+
+inline glm::vec3 RayAt(const Ray& r, float t)
+{
+	return r.origin + t * r.direction;
+}
+
+// --------- primitive objects ------------------
+
+// the material is only fetched for the final hit (see `TraceRay()`)
+struct HitRecord
+{
+	float closestT;
+	glm::vec3 normal;
+	glm::vec3 point; // point of hit
+	uint32_t materialIndex; // material of the object at point of hit
+};
+
+// ---------- hit functions for primitives ----------------
+
+bool HitSphere(const Sphere& sphere, const Ray& r, HitRecord& rec)
+{
+	glm::vec3 originToCenter = r.origin - sphere.center;
+	float h = glm::dot(r.direction, originToCenter); // ray direction is normalized so `a` is 1.0
+	float c = glm::dot(originToCenter, originToCenter) - sphere.radius * sphere.radius;
+
+	float discriminant = h * h - c;
+	if (discriminant < 0.0f)
+		return false;
+
+	float sqrtDiscriminant = std::sqrt(discriminant);
+	float t = -h - sqrtDiscriminant;
+	// the far root is useful if the camera is inside the sphere
+	if (t <= MIN_HIT_BIAS || t >= rec.closestT)
+		t = -h + sqrtDiscriminant;
+
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		rec.normal = (rec.point - sphere.center) / sphere.radius;
+		rec.materialIndex = sphere.materialIndex;
+		return true;
+	}
+
+	return false;
+}
+
+bool HitPlane(const Plane& plane, const Ray& r, HitRecord& rec)
+{
+	float numerator = glm::dot(plane.position - r.origin, plane.normal);
+	float denominator = glm::dot(r.direction, plane.normal);
+
+	// the ray did not intersect the plane
+	if (denominator == 0.0f)
+		return false;
+
+	float t = numerator / denominator;
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		rec.normal = plane.normal;
+		rec.materialIndex = plane.materialIndex;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * @returns distance to the entry point of the box, or `MAX_FLOAT` if the ray misses
+ * it or if the box is farther than the closest hit
+ */
+float HitAabb(const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax,
+	const Ray& r,
+	const glm::vec3& invDir,
+	float closestT)
+{
+	glm::vec3 t0 = (boundsMin - r.origin) * invDir;
+	glm::vec3 t1 = (boundsMax - r.origin) * invDir;
+	glm::vec3 tMin = glm::min(t0, t1);
+	glm::vec3 tMax = glm::max(t0, t1);
+	float tNear = std::max(std::max(tMin.x, tMin.y), tMin.z);
+	float tFar = std::min(std::min(tMax.x, tMax.y), tMax.z);
+
+	if (tFar >= std::max(tNear, 0.0f) && tNear < closestT)
+		return tNear;
+
+	return MAX_FLOAT;
+}
+
+// Moller-Trumbore intersection
+bool HitTriangle(const Scene& scene, const Triangle& triangle, const Ray& r, HitRecord& rec)
+{
+	const Vertex& v0 = scene.GetVertices()[triangle.indices[0]];
+	const Vertex& v1 = scene.GetVertices()[triangle.indices[1]];
+	const Vertex& v2 = scene.GetVertices()[triangle.indices[2]];
+
+	glm::vec3 edge1 = v1.pos - v0.pos;
+	glm::vec3 edge2 = v2.pos - v0.pos;
+	glm::vec3 p = glm::cross(r.direction, edge2);
+	float det = glm::dot(edge1, p);
+	// the ray is parallel to the triangle
+	if (det == 0.0f)
+		return false;
+
+	float invDet = 1.0f / det;
+	glm::vec3 originToV0 = r.origin - v0.pos;
+	float u = glm::dot(originToV0, p) * invDet;
+	if (u < 0.0f || u > 1.0f)
+		return false;
+
+	glm::vec3 q = glm::cross(originToV0, edge1);
+	float v = glm::dot(r.direction, q) * invDet;
+	if (v < 0.0f || u + v > 1.0f)
+		return false;
+
+	float t = glm::dot(edge2, q) * invDet;
+	if (t > MIN_HIT_BIAS && t < rec.closestT)
+	{
+		rec.closestT = t;
+		rec.point = RayAt(r, t);
+		// the vertices without a normal use the normal of the triangle
+		glm::vec3 normal = (1.0f - u - v) * v0.normal + u * v1.normal + v * v2.normal;
+		if (glm::dot(normal, normal) == 0.0f)
+			normal = glm::cross(edge1, edge2);
+		rec.normal = glm::normalize(normal);
+		rec.materialIndex = triangle.materialIndex;
+		return true;
+	}
+
+	return false;
+}
+
+bool HitPrimitive(const Scene& scene, uint32_t ref, const Ray& r, HitRecord& rec)
+{
+	const uint32_t index = Scene::GetPrimitiveIndex(ref);
+	switch (Scene::GetPrimitiveType(ref))
+	{
+	case PrimitiveType::SPHERE:
+		return HitSphere(scene.GetSpheres()[index], r, rec);
+	case PrimitiveType::TRIANGLE:
+		return HitTriangle(scene, scene.GetTriangles()[index], r, rec);
+	}
+
+	return false;
+}
+
+bool Hit(const Scene& scene, const Ray& r, HitRecord& rec)
+{
+	bool isHit = false;
+	rec.closestT = MAX_FLOAT;
+
+	// the planes are unbounded, so they are not part of the BVH
+	// testing them first also makes the BVH traversal skip everything behind them
+	for (const auto& plane : scene.GetPlanes())
+		isHit = HitPlane(plane, r, rec) || isHit;
+
+	const std::vector<BvhNode>& nodes = scene.GetBvh().GetNodes();
+	const std::vector<uint32_t>& primitiveRefs = scene.GetPrimitiveRefs();
+	if (nodes.empty())
+		return isHit;
+
+	const glm::vec3 invDir = 1.0f / r.direction;
+	std::array<uint32_t, BVH_STACK_SIZE> stack{};
+	uint32_t stackSize = 0;
+	uint32_t nodeIndex = 0;
+	while (true)
+	{
+		const BvhNode& node = nodes[nodeIndex];
+		if (node.IsLeaf())
+		{
+			for (uint32_t i = 0; i < node.primitiveCount; ++i)
+				isHit = HitPrimitive(scene, primitiveRefs[node.leftOrFirst + i], r, rec) || isHit;
+
+			if (stackSize == 0)
+				break;
+			nodeIndex = stack[--stackSize];
+			continue;
+		}
+
+		// visit the closer child first and push the other one
+		uint32_t nearChild = node.leftOrFirst;
+		uint32_t farChild = node.leftOrFirst + 1;
+		float tNear = HitAabb(nodes[nearChild].boundsMin, nodes[nearChild].boundsMax, r, invDir, rec.closestT);
+		float tFar = HitAabb(nodes[farChild].boundsMin, nodes[farChild].boundsMax, r, invDir, rec.closestT);
+		if (tNear > tFar)
+		{
+			std::swap(nearChild, farChild);
+			std::swap(tNear, tFar);
+		}
+
+		if (tNear == MAX_FLOAT)
+		{
+			if (stackSize == 0)
+				break;
+			nodeIndex = stack[--stackSize];
+			continue;
+		}
+
+		// at most one child per inner node on the way to the leaf, the tree isn't deeper than the stack
+		nodeIndex = nearChild;
+		if (tFar != MAX_FLOAT)
+			stack[stackSize++] = farChild;
+	}
+
+	return isHit;
+}
+
+// ----------  Ray scatter/reflect functions for materials ----------------
+
+inline glm::vec3 Diffuse(const glm::vec3& normal, Rng& rng)
+{
+	return normal + RandNormHemisphere(normal, rng);
+}
+
+inline glm::vec3 Reflect(const glm::vec3& rayDir, const glm::vec3& normal)
+{
+	return rayDir - 2.0f * glm::dot(rayDir, normal) * normal;
+}
+
+inline float Schlick(const float cosine, const float refractiveIndex)
+{
+	float r0 = (1.0f - refractiveIndex) / (1.0f + refractiveIndex);
+	r0 = r0 * r0;
+	return r0 + (1.0f - r0) * std::pow((1.0f - cosine), 5.0f);
+}
+
+glm::vec3 Refract(const glm::vec3& rayDir, const glm::vec3& normal, const float refractiveIndex, Rng& rng)
+{
+	glm::vec3 n{ 0.0f };
+	float ri = 0.0f;
+
+	// check if front face
+	if (glm::dot(rayDir, normal) > 0.0f) // back face
+	{
+		n = -normal;
+		ri = refractiveIndex;
+	}
+	else // front face
+	{
+		n = normal;
+		ri = 1.0f / refractiveIndex;
+	}
+
+	float cosTheta = std::min(glm::dot(-rayDir, n), 1.0f);
+	float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+
+	if ((ri * sinTheta) > 1.0f || (Schlick(cosTheta, ri) > rng.NextFloat())) // cannot refract
+		return Reflect(rayDir, n);
+
+	glm::vec3 rayOutPerp = ri * (rayDir + cosTheta * n);
+	glm::vec3 rayOutPara = -std::sqrt(std::abs(1.0f - glm::dot(rayOutPerp, rayOutPerp))) * n;
+	return rayOutPerp + rayOutPara;
+}
+
+// --------------------------------------------------------
+
+glm::vec3 TraceRay(const Scene& scene, Ray r, uint32_t maxBounces, Rng& rng, uint64_t& rayCount)
+{
+	glm::vec3 attenuation{ 1.0f };
+
+	HitRecord rec{};
+	for (uint32_t bounces = 0; bounces < maxBounces; ++bounces)
+	{
+		if (bounces >= ROULETTE_START_BOUNCE)
+		{
+			const float survival =
+				std::min(std::max(attenuation.r, std::max(attenuation.g, attenuation.b)), MAX_SURVIVAL_PROBABILITY);
+			if (rng.NextFloat() >= survival)
+				break;
+			attenuation /= survival;
+		}
+
+		++rayCount;
+
+		// if hit, then attenuate the color and
+		// cast the ray in a random direction
+		if (Hit(scene, r, rec))
+		{
+			const Material& mat = scene.GetMaterials()[rec.materialIndex];
+			if (mat.maxBounces != 0 && bounces >= mat.maxBounces)
+				break;
+			attenuation *= mat.albedo;
+			glm::vec3 direction{ 0.0f };
+
+			switch (mat.type)
+			{
+			case MaterialType::LAMBERTIAN:
+				direction = glm::normalize(Diffuse(rec.normal, rng));
+				break;
+
+			case MaterialType::METAL:
+				direction =
+					glm::normalize(Reflect(r.direction, rec.normal) + mat.roughness * RandUnitSphere(rng));
+				break;
+
+			case MaterialType::DIELECTRIC:
+				direction = glm::normalize(Refract(r.direction, rec.normal, mat.refractiveIndex, rng));
+				break;
+			}
+
+			r = Ray{ rec.point, direction };
+			continue;
+		}
+
+		// if the ray doesn't intesect anything while bouncing,
+		// return the attenuated ambient color
+		float a = 0.5f * (r.direction.y + 1.0f);
+		glm::vec3 skyGradient = (1.0f - a) * glm::vec3(1.0f) + a * glm::vec3(0.5f, 0.7f, 1.0f);
+		return attenuation * skyGradient;
+	}
+
+	return glm::vec3(0.0f);
+}
+
+} // namespace
+
+
+CpuRayTracer::CpuRayTracer(const Scene& scene, uint32_t width, uint32_t height, uint32_t threadCount)
+	: m_Scene{ scene },
+	  m_Width{ width },
+	  m_Height{ height },
+	  m_ThreadCount{ threadCount },
+	  m_TileCountX{ (width + s_TileSize - 1) / s_TileSize },
+	  m_TileCountY{ (height + s_TileSize - 1) / s_TileSize },
+	  m_Accumulation(static_cast<size_t>(width) * height, glm::vec3(0.0f))
+{
+	if (m_ThreadCount == 0)
+		m_ThreadCount = std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void CpuRayTracer::SetMaxBounces(uint32_t maxBounces)
+{
+	THROW(maxBounces == 0 || maxBounces > MAX_BOUNCES, "The paths have 1 to {} bounces!", MAX_BOUNCES)
+	m_MaxBounces = maxBounces;
+}
+
+void CpuRayTracer::Render(const Camera& camera)
+{
+	RenderTiles(camera.GetInverseViewProjectionMatrix(), camera.GetPosition());
+	++m_SampleCount;
+}
+
+void CpuRayTracer::Reset()
+{
+	std::fill(m_Accumulation.begin(), m_Accumulation.end(), glm::vec3(0.0f));
+	m_SampleCount = 0;
+	m_RayCount.store(0, std::memory_order_relaxed);
+}
+
+void CpuRayTracer::RenderTiles(const glm::mat4& invViewProj, const glm::vec3& cameraPos)
+{
+	const uint32_t tileCount = m_TileCountX * m_TileCountY;
+	const uint64_t sampleIndex = m_SampleCount;
+	m_NextTile.store(0, std::memory_order_relaxed);
+
+	auto worker = [&]() {
+		Rng rng{};
+		uint64_t rayCount = 0;
+
+		for (uint32_t tile = m_NextTile.fetch_add(1, std::memory_order_relaxed); tile < tileCount;
+			 tile = m_NextTile.fetch_add(1, std::memory_order_relaxed))
+		{
+			const uint32_t x0 = (tile % m_TileCountX) * s_TileSize;
+			const uint32_t y0 = (tile / m_TileCountX) * s_TileSize;
+			const uint32_t x1 = std::min(x0 + s_TileSize, m_Width);
+			const uint32_t y1 = std::min(y0 + s_TileSize, m_Height);
+
+			for (uint32_t y = y0; y < y1; ++y)
+			{
+				for (uint32_t x = x0; x < x1; ++x)
+				{
+					const size_t pixelIndex = static_cast<size_t>(y) * m_Width + x;
+					rng.Seed((sampleIndex << 32) ^ pixelIndex);
+
+					// jitter the sample within the pixel (the GPU gets this from MSAA sample shading)
+					// normalized device coords [-1, 1], the same as `inPosition` in the shader
+					const float u = (static_cast<float>(x) + rng.NextFloat()) / static_cast<float>(m_Width);
+					const float v = (static_cast<float>(y) + rng.NextFloat()) / static_cast<float>(m_Height);
+					glm::vec2 ndc{ u * 2.0f - 1.0f, v * 2.0f - 1.0f };
+
+					// same as `raytracing.vert`
+					glm::vec4 farPoint = invViewProj * glm::vec4(ndc, 1.0f, 1.0f);
+					farPoint /= farPoint.w;
+					glm::vec4 nearPoint = invViewProj * glm::vec4(ndc, 0.0f, 1.0f);
+					nearPoint /= nearPoint.w;
+
+					Ray ray{ cameraPos, glm::normalize(glm::vec3(farPoint) - glm::vec3(nearPoint)) };
+					m_Accumulation[pixelIndex] += TraceRay(m_Scene, ray, m_MaxBounces, rng, rayCount);
+				}
+			}
+		}
+
+		m_RayCount.fetch_add(rayCount, std::memory_order_relaxed);
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(m_ThreadCount);
+	for (uint32_t i = 0; i < m_ThreadCount; ++i)
+		threads.emplace_back(worker);
+
+	for (auto& thread : threads)
+		thread.join();
+}
+
+std::vector<uint8_t> CpuRayTracer::GetPixels() const
+{
+	std::vector<uint8_t> pixels(m_Accumulation.size() * 4);
+	const float invSampleCount = m_SampleCount > 0 ? 1.0f / static_cast<float>(m_SampleCount) : 0.0f;
+
+	for (size_t i = 0; i < m_Accumulation.size(); ++i)
+	{
+		// same gamma correction as the shader
+		glm::vec3 color = glm::sqrt(glm::clamp(m_Accumulation[i] * invSampleCount, 0.0f, 1.0f));
+		pixels[i * 4 + 0] = static_cast<uint8_t>(color.r * 255.0f + 0.5f);
+		pixels[i * 4 + 1] = static_cast<uint8_t>(color.g * 255.0f + 0.5f);
+		pixels[i * 4 + 2] = static_cast<uint8_t>(color.b * 255.0f + 0.5f);
+		pixels[i * 4 + 3] = 255;
+	}
+
+	return pixels;
+}
+
+void CpuRayTracer::SaveImage(const char* path) const
+{
+	std::vector<uint8_t> pixels = GetPixels();
+	utils::SaveImagePpm(path, m_Width, m_Height, pixels.data(), false);
+	Logger::Info("Saved the rendered image to \"{}\"", path);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "engine/camera.h"
+#include "engine/scene.h"
+
+/**
+ * CPU reference implementation of `assets/shaders/raytracing.glsl`
+ * Renders the same `Scene` with the same materials, split into tiles that are
+ * traced in parallel on all cores. Each call to `Render()` adds one sample per
+ * pixel to a running average, so it can be used as the ground truth for the
+ * GPU output and as a fallback when there is no usable Vulkan device.
+ */
+class CpuRayTracer
+{
+public:
+	/**
+	 * @param scene scene to render, has to outlive the ray tracer
+	 * @param width width of the image in pixels
+	 * @param height height of the image in pixels
+	 * @param threadCount number of worker threads (default = 0 = all hardware threads)
+	 */
+	CpuRayTracer(const Scene& scene, uint32_t width, uint32_t height, uint32_t threadCount = 0);
+
+	/**
+	 * traces one sample per pixel and accumulates it
+	 * @param camera camera whose matrices are used to generate the primary rays
+	 */
+	void Render(const Camera& camera);
+	void Reset();
+	// @param maxBounces of the paths (1 to 64), the accumulated samples should be reset after changing it
+	void SetMaxBounces(uint32_t maxBounces);
+	void SaveImage(const char* path) const;
+
+	[[nodiscard]] inline uint32_t GetWidth() const { return m_Width; }
+	[[nodiscard]] inline uint32_t GetHeight() const { return m_Height; }
+	[[nodiscard]] inline uint32_t GetThreadCount() const { return m_ThreadCount; }
+	[[nodiscard]] inline uint32_t GetSampleCount() const { return m_SampleCount; }
+	// total number of rays (primary rays and bounces) traced since the last reset
+	[[nodiscard]] inline uint64_t GetRayCount() const { return m_RayCount.load(std::memory_order_relaxed); }
+
+	// tonemapped (gamma 2) RGBA8 pixels of the accumulated image
+	[[nodiscard]] std::vector<uint8_t> GetPixels() const;
+
+private:
+	void RenderTiles(const glm::mat4& invViewProj, const glm::vec3& cameraPos);
+
+private:
+	static constexpr uint32_t s_TileSize = 16;
+
+	const Scene& m_Scene;
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_ThreadCount;
+	uint32_t m_TileCountX;
+	uint32_t m_TileCountY;
+
+	uint32_t m_MaxBounces = 64;
+	uint32_t m_SampleCount = 0;
+	std::vector<glm::vec3> m_Accumulation;
+
+	// lock-free tile queue; workers grab the next tile index until all tiles are taken
+	std::atomic<uint32_t> m_NextTile{ 0 };
+	std::atomic<uint64_t> m_RayCount{ 0 };
+};
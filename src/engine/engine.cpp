@@ -1,21 +1,82 @@
 #include "engine/engine.h"
 
+#include <algorithm>
+#include <numeric>
 #include <set>
 #include <glm/gtc/type_ptr.hpp>
 #include "core/core.h"
 #include "core/input.h"
+#include "core/profiler.h"
 #include "engine/initializers.h"
 #include "engine/shader.h"
 #include "ui/imGuiOverlay.h"
 #include "utils/utils.h"
 
+namespace {
+
+// shaders selectable in the fragment path
+struct FragmentProgram
+{
+	const char* name;
+	const char* vertexShader;
+	const char* fragmentShader;
+	uint32_t vertexCount;
+	// drawn into the multisampled pass with a depth buffer, instead of the single sampled fullscreen pass
+	bool rasterizesGeometry;
+};
+
+constexpr std::array<FragmentProgram, 4> s_FragmentPrograms{ {
+	{ "Ray tracing", "raytracing.vert", "raytracing.frag", 3, false },
+	{ "Shader", "shader.vert", "shader.frag", 3, false },
+	{ "Random", "shader.vert", "random.frag", 3, false },
+	{ "Hello triangle", "helloTriangle.vert", "helloTriangle.frag", 6, true },
+} };
+
+// present modes selectable in the ui
+struct PresentMode
+{
+	const char* name;
+	VkPresentModeKHR mode;
+};
+
+constexpr std::array<PresentMode, 4> s_PresentModes{ {
+	{ "Immediate", VK_PRESENT_MODE_IMMEDIATE_KHR },
+	{ "Mailbox", VK_PRESENT_MODE_MAILBOX_KHR },
+	{ "FIFO", VK_PRESENT_MODE_FIFO_KHR },
+	{ "FIFO relaxed", VK_PRESENT_MODE_FIFO_RELAXED_KHR },
+} };
+
+const char* GetPresentModeName(VkPresentModeKHR mode)
+{
+	for (const PresentMode& presentMode : s_PresentModes)
+	{
+		if (presentMode.mode == mode)
+			return presentMode.name;
+	}
+	return "Unknown";
+}
+
+// number of frames the latency is averaged over
+constexpr size_t s_LatencyHistorySize = 128;
+
+// GPU time of the scope in the last frame that has been read back, 0 if it hasn't been recorded
+float GetLastGpuTime(const std::vector<GpuScopeStatistics>& statistics, const char* name)
+{
+	auto it = std::find_if(statistics.begin(), statistics.end(), [name](const GpuScopeStatistics& scope) {
+		return scope.name == name;
+	});
+	return it != statistics.end() ? it->lastMs : 0.0f;
+}
+
+} // namespace
+
 
 Engine* Engine::s_Instance = nullptr;
 
-Engine::Engine(const char* title, const uint64_t width, const uint64_t height)
+Engine::Engine(const EngineProps& props)
 {
 	s_Instance = this;
-	Init(title, width, height);
+	Init(props);
 }
 
 Engine::~Engine()
@@ -23,112 +84,239 @@ Engine::~Engine()
 	Cleanup();
 }
 
-Engine* Engine::Create(const char* title, const uint64_t width, const uint64_t height)
+Engine* Engine::Create(const EngineProps& props)
 {
 	if (s_Instance == nullptr)
-		return new Engine(title, width, height);
+		return new Engine(props);
 
 	return s_Instance;
 }
 
-void Engine::Init(const char* title, const uint64_t width, const uint64_t height)
+void Engine::Init(const EngineProps& props)
 {
-	m_Window = std::make_unique<Window>(WindowProps{ title, width, height });
-	// set window event callbacks
-	m_Window->SetCloseEventCallbackFn(BIND_FN(Engine::OnCloseEvent));
-	m_Window->SetResizeEventCallbackFn(BIND_FN(Engine::OnResizeEvent));
-	m_Window->SetMouseEventCallbackFn(BIND_FN(Engine::OnMouseMoveEvent));
-	m_Window->SetKeyEventCallbackFn(BIND_FN(Engine::OnKeyEvent));
+	m_InitStartTime = std::chrono::high_resolution_clock::now();
+	m_Headless = props.headless;
+	m_HeadlessFrameCount = props.frameCount;
+	m_OutputPath = props.outputPath;
+	m_OnHeadlessFrame = props.onHeadlessFrame;
+	THROW(props.framesInFlight == 0 || props.framesInFlight > Config::maxFramesInFlight,
+		"The number of frames in flight has to be between 1 and {}!",
+		Config::maxFramesInFlight)
+	m_FramesInFlight = props.framesInFlight;
+	m_RequestedFramesInFlight = m_FramesInFlight;
+	m_PresentMode = props.presentMode;
+	m_RequestedPresentMode = m_PresentMode;
+	m_FixedTime = props.fixedTime;
+	m_ComputeRayTracing = props.computeRayTracing;
+	THROW(props.renderScale < ResolutionScaler::s_MinScale || props.renderScale > ResolutionScaler::s_MaxScale,
+		"The render scale has to be between {} and {}!",
+		ResolutionScaler::s_MinScale,
+		ResolutionScaler::s_MaxScale)
+	if (!m_ComputeRayTracing && (props.renderScale != 1.0f || props.targetFrameTime > 0.0f))
+		Logger::Warn("The fragment path always renders at the window resolution");
+	m_ResolutionScaler = std::make_unique<ResolutionScaler>(props.renderScale, props.targetFrameTime);
+	THROW(props.traceBudget < 0.0f, "The trace budget can't be negative!")
+	if (!m_ComputeRayTracing && props.traceBudget > 0.0f)
+		Logger::Warn("The fragment path always traces the whole image");
+	// every headless frame is saved or measured as a complete image
+	m_TileScheduler = std::make_unique<TileScheduler>(m_Headless ? 0.0f : props.traceBudget);
+	m_TracedTileCounts.assign(Config::maxFramesInFlight, 0);
+	THROW(props.denoiseIterations > s_MaxDenoiseIterations,
+		"The denoiser has at most {} iterations!",
+		s_MaxDenoiseIterations)
+	if (!m_ComputeRayTracing && props.denoiseIterations > 0)
+		Logger::Warn("Only the compute path is denoised");
+	m_DenoiseIterations = m_ComputeRayTracing ? props.denoiseIterations : 0;
+	m_Reprojection = props.reprojection;
+	THROW(props.maxBounces == 0 || props.maxBounces > s_MaxBounces, "The paths have 1 to {} bounces!", s_MaxBounces)
+	m_MaxBounces = props.maxBounces;
+	THROW(props.noiseThreshold < 0.0f, "The noise threshold can't be negative!")
+	if (!m_ComputeRayTracing && props.noiseThreshold > 0.0f)
+		Logger::Warn("Only the compute path samples adaptively");
+	m_NoiseThreshold = m_ComputeRayTracing ? props.noiseThreshold : 0.0f;
+	if (!m_ComputeRayTracing && props.wavefront)
+		Logger::Warn("Only the compute path traces wavefronts");
+	m_Wavefront = m_ComputeRayTracing && props.wavefront;
+	m_RandomSphereCount = props.sphereCount;
+	m_MeshPath = props.meshPath;
+	m_TracePath = props.tracePath;
+
+	if (!props.fragmentProgram.empty())
+	{
+		auto it = std::find_if(s_FragmentPrograms.begin(), s_FragmentPrograms.end(), [&props](const auto& program) {
+			return props.fragmentProgram + ".frag" == program.fragmentShader;
+		});
+		THROW(it == s_FragmentPrograms.end(), "Unknown fragment program: {}", props.fragmentProgram)
+		m_FragmentProgramIndex = static_cast<int>(it - s_FragmentPrograms.begin());
+	}
 
-	Logger::Info("{} application initialized!", title);
+	if (!m_Headless)
+	{
+		m_Window = std::make_unique<Window>(WindowProps{ props.title, props.width, props.height });
+		// set window event callbacks
+		m_Window->SetCloseEventCallbackFn(BIND_FN(Engine::OnCloseEvent));
+		m_Window->SetResizeEventCallbackFn(BIND_FN(Engine::OnResizeEvent));
+		m_Window->SetMouseEventCallbackFn(BIND_FN(Engine::OnMouseMoveEvent));
+		m_Window->SetKeyEventCallbackFn(BIND_FN(Engine::OnKeyEvent));
+	}
 
-	CreateVulkanInstance(title);
+	Logger::Info("{} application initialized{}!", props.title, m_Headless ? " (headless)" : "");
+
+	CreateVulkanInstance(props.title);
 	SetupDebugMessenger();
-	m_Window->CreateWindowSurface(m_VulkanInstance);
+	if (!m_Headless)
+		m_Window->CreateWindowSurface(m_VulkanInstance);
 
 	PickPhysicalDevice();
 	CreateLogicalDevice();
+	m_Allocator = std::make_unique<MemoryAllocator>(m_DeviceVk, m_PhysicalDevice);
+	m_UploadManager = std::make_unique<UploadManager>(m_DeviceVk,
+		*m_Allocator,
+		m_QueueFamilyIndices.transferFamily.value_or(m_QueueFamilyIndices.graphicsFamily.value()),
+		m_TransferQueue,
+		m_QueueFamilyIndices.graphicsFamily.value(),
+		s_UploadStagingSize);
 
 	CreateCommandPool();
 	CreateDescriptorPool();
 
-	CreateSwapchain();
-	CreateSwapchainImageViews();
+	// in headless mode, the offscreen target takes the place of the swapchain images
+	if (m_Headless)
+	{
+		CreateOffscreenTarget(props.width, props.height);
+	}
+	else
+	{
+		CreateSwapchain();
+		CreateSwapchainImageViews();
+	}
 	CreateRenderPass();
-	CreateColorResource();
-	CreateDepthResource();
+	// the multisampled color and depth images are only created once a program that rasterizes geometry is used
 	CreateFramebuffers();
+	CreateStorageImages();
 
-	CreateUniformBuffers();
+	// the layouts don't depend on the scene, so the pipeline is compiled while the scene is built
 	CreateDescriptorSetLayout();
-	CreateDescriptorSets();
 	CreatePipelineLayout();
+	m_PipelineCache =
+		std::make_unique<PipelineCache>(m_DeviceVk, m_PhysicalDeviceProperties, "assets/shaders/out/pipeline.cache");
+	CreatePipelines();
 
-	CreatePipeline("assets/shaders/out/shader.vert.spv", "assets/shaders/out/shader.frag.spv");
-	// CreatePipeline("assets/shaders/out/helloTriangle.vert.spv", "assets/shaders/out/helloTriangle.frag.spv");
-	// CreatePipeline("assets/shaders/out/shader.vert.spv", "assets/shaders/out/random.frag.spv");
-	// CreatePipeline("assets/shaders/out/raytracing.vert.spv", "assets/shaders/out/raytracing.frag.spv");
+	CreateUniformBuffers();
+	m_Scene = std::make_unique<Scene>(
+		Scene::CreateDefault(m_RandomSphereCount, m_MeshPath.empty() ? nullptr : m_MeshPath.c_str()));
+	CreateSceneBuffers();
+	CreateDescriptorSets();
 
 	CreateCommandBuffers();
 
 	CreateSyncObjects();
+	CreateGpuProfiler();
 
-	ImGuiOverlay::Init(m_VulkanInstance,
-		m_PhysicalDevice,
-		m_DeviceVk,
-		m_QueueFamilyIndices.graphicsFamily.value(),
-		m_GraphicsQueue,
-		m_MsaaSamples,
-		m_RenderPass,
-		m_CommandPool,
-		Config::maxFramesInFlight);
+	if (!m_Headless)
+	{
+		ImGuiOverlay::Init(m_VulkanInstance,
+			m_PhysicalDevice,
+			m_DeviceVk,
+			m_QueueFamilyIndices.graphicsFamily.value(),
+			m_GraphicsQueue,
+			VK_SAMPLE_COUNT_1_BIT,
+			m_RenderPass,
+			m_CommandPool,
+			Config::maxFramesInFlight);
+	}
 
 	m_Camera = std::make_unique<Camera>(
 		static_cast<float>(m_SwapchainExtent.width) / static_cast<float>(m_SwapchainExtent.height));
+
+	const MemoryStatistics memoryStats = m_Allocator->GetStatistics();
+	Logger::Info("Device memory: {} allocation(s) in {} block(s) + {} dedicated, {:.1f} MiB used, {:.1f} MiB wasted, "
+				 "{:.1f} MiB allocated",
+		memoryStats.allocationCount,
+		memoryStats.blockCount,
+		memoryStats.dedicatedAllocationCount,
+		static_cast<float>(memoryStats.bytesUsed) / (1024.0f * 1024.0f),
+		static_cast<float>(memoryStats.bytesWasted) / (1024.0f * 1024.0f),
+		static_cast<float>(memoryStats.bytesAllocated) / (1024.0f * 1024.0f));
 }
 
 void Engine::Cleanup()
 {
 	vkDeviceWaitIdle(m_DeviceVk);
 
-	ImGuiOverlay::Cleanup(m_DeviceVk);
+	if (!m_Headless)
+		ImGuiOverlay::Cleanup(m_DeviceVk);
 
 	for (size_t i = 0; i < Config::maxFramesInFlight; ++i)
 	{
 		vkDestroySemaphore(m_DeviceVk, m_ImageAvailableSemaphores[i], nullptr);
 		vkDestroySemaphore(m_DeviceVk, m_RenderFinishedSemaphores[i], nullptr);
-		vkDestroyFence(m_DeviceVk, m_InFlightFences[i], nullptr);
 	}
+	vkDestroySemaphore(m_DeviceVk, m_FrameTimeline, nullptr);
 
+	m_GpuProfiler.reset();
+
+	// stop watching before the pipelines are gone
+	m_ShaderHotReloader.reset();
+	// the window can be closed before the ray tracing pipeline is built
+	UpdatePipeline(true);
+	DestroyRetiredPipelines(true);
 	vkDestroyPipeline(m_DeviceVk, m_Pipeline, nullptr);
+	if (m_PlaceholderPipeline != m_Pipeline)
+		vkDestroyPipeline(m_DeviceVk, m_PlaceholderPipeline, nullptr);
+	vkDestroyPipeline(m_DeviceVk, m_UpscalePipeline, nullptr);
+	vkDestroyPipeline(m_DeviceVk, m_DenoisePipeline, nullptr);
+	vkDestroyPipeline(m_DeviceVk, m_AdaptivePipeline, nullptr);
+	for (VkPipeline pipeline : m_WavefrontPipelines)
+		vkDestroyPipeline(m_DeviceVk, pipeline, nullptr);
+	// saves the cache
+	m_PipelineCache.reset();
+	m_UploadManager.reset();
 	vkDestroyPipelineLayout(m_DeviceVk, m_PipelineLayout, nullptr);
 	vkDestroyDescriptorSetLayout(m_DeviceVk, m_DescriptorSetLayout, nullptr);
 
-	for (uint64_t i = 0; i < Config::maxFramesInFlight; ++i)
+	m_UniformRingBuffer.reset();
+
+	for (size_t i = 0; i < m_SceneBuffers.size(); ++i)
 	{
-		vkFreeMemory(m_DeviceVk, m_UniformBufferMemory[i], nullptr);
-		vkDestroyBuffer(m_DeviceVk, m_UniformBuffers[i], nullptr);
+		vkDestroyBuffer(m_DeviceVk, m_SceneBuffers[i], nullptr);
+		m_Allocator->Free(m_SceneBufferAllocations[i]);
 	}
 
+	CleanupStorageImages();
 	CleanupSwapchain();
 	vkDestroyRenderPass(m_DeviceVk, m_RenderPass, nullptr);
+	vkDestroyRenderPass(m_DeviceVk, m_GeometryRenderPass, nullptr);
+	vkDestroyRenderPass(m_DeviceVk, m_OverlayRenderPass, nullptr);
 
 	vkDestroyDescriptorPool(m_DeviceVk, m_DescriptorPool, nullptr);
 	vkDestroyCommandPool(m_DeviceVk, m_CommandPool, nullptr);
 
+	m_Allocator.reset();
 	vkDestroyDevice(m_DeviceVk, nullptr);
 
-	m_Window->DestroyWindowSurface(m_VulkanInstance);
+	if (!m_Headless)
+		m_Window->DestroyWindowSurface(m_VulkanInstance);
 	if (Config::enableValidationLayers)
 		initializers::DestroyDebugUtilsMessengerEXT(m_VulkanInstance, m_DebugMessenger, nullptr);
 	vkDestroyInstance(m_VulkanInstance, nullptr);
+
+	if (!m_TracePath.empty())
+		Profiler::ExportChromeTrace(m_TracePath.c_str());
 }
 
 void Engine::Run()
 {
+	if (m_Headless)
+	{
+		RunHeadless();
+		return;
+	}
+
 	m_LastFrameTime = std::chrono::high_resolution_clock::now();
 	while (m_IsRunning)
 	{
+		PROFILE_SCOPE("Engine::Run");
 		float deltatime = CalcFps();
 		m_Camera->OnUpdate(deltatime);
 
@@ -138,66 +326,234 @@ void Engine::Run()
 	}
 }
 
+void Engine::RunHeadless()
+{
+	// the frame times don't include the pipeline build
+	UpdatePipeline(true);
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> startTime = std::chrono::high_resolution_clock::now();
+	m_LastFrameTime = startTime;
+	for (uint32_t i = 0; i < m_HeadlessFrameCount; ++i)
+	{
+		PROFILE_SCOPE("Engine::RunHeadless");
+		// there is no input in headless mode, the camera stays at its initial position (unless it's moved by
+		// `m_OnHeadlessFrame`) and only the first frame is seen as a camera update, so the frames accumulate
+		if (m_OnHeadlessFrame)
+			m_OnHeadlessFrame(i, *m_Camera);
+		m_Camera->UpdateMatrices();
+
+		float deltatime = CalcFps();
+		Draw(deltatime);
+	}
+	vkDeviceWaitIdle(m_DeviceVk);
+	m_GpuProfiler->ReadPendingResults();
+	UpdateLatency();
+	UpdateTracedPixelCounts();
+
+	float elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+		std::chrono::high_resolution_clock::now() - startTime)
+						.count();
+	Logger::Info("Rendered {} frame(s) at {}x{} in {:.2f} ms ({:.3f} ms/frame, {:.2f} fps)",
+		m_HeadlessFrameCount,
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height,
+		elapsed,
+		elapsed / static_cast<float>(m_HeadlessFrameCount),
+		static_cast<float>(m_HeadlessFrameCount) * 1000.0f / elapsed);
+	if (m_RenderExtent.width != m_SwapchainExtent.width || m_RenderExtent.height != m_SwapchainExtent.height)
+	{
+		Logger::Info("Ray traced at {}x{} (render scale {:.2f}) and upscaled",
+			m_RenderExtent.width,
+			m_RenderExtent.height,
+			m_ResolutionScaler->GetScale());
+	}
+	if (!m_LatencyHistory.empty())
+	{
+		Logger::Info("Latency (submit to device done) of the last {} frame(s): {:.3f} ms avg, {:.3f} ms max",
+			m_LatencyHistory.size(),
+			std::accumulate(m_LatencyHistory.begin(), m_LatencyHistory.end(), 0.0f)
+				/ static_cast<float>(m_LatencyHistory.size()),
+			*std::max_element(m_LatencyHistory.begin(), m_LatencyHistory.end()));
+	}
+	for (const GpuScopeStatistics& scope : m_GpuProfiler->GetStatistics())
+	{
+		Logger::Info("GPU {:>{}}{}: {:.3f} ms avg, {:.3f} ms min, {:.3f} ms max",
+			"",
+			scope.depth * 2,
+			scope.name,
+			scope.averageMs,
+			scope.minMs,
+			scope.maxMs);
+	}
+
+	if (!m_OutputPath.empty())
+		SaveOffscreenTarget(m_OutputPath);
+}
+
 void Engine::Draw(float deltatime)
 {
+	ApplyFrameSettings();
+
+	// headless frames are saved, so they wait for the ray tracing pipeline instead of drawing the placeholder
+	UpdatePipeline(m_Headless);
+
+	// headless runs render the shaders they were started with
+	if (m_ShaderHotReloader && !m_PipelineFuture.valid())
+	{
+		if (auto shaderPaths = m_ShaderHotReloader->PollCompiled())
+			BuildPipelineAsync(std::move(*shaderPaths));
+	}
+
 	BeginScene();
+	// the frame slot has been waited on, so the retired pipelines of older frames might no longer be used
+	DestroyRetiredPipelines(false);
+	UpdateRenderExtent(deltatime);
 
-	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
-	vkCmdBindDescriptorSets(m_ActiveCommandBuffer,
-		VK_PIPELINE_BIND_POINT_GRAPHICS,
-		m_PipelineLayout,
-		0,
-		1,
-		&m_DescriptorSets[m_CurrentFrameIndex],
-		0,
-		nullptr);
-	vkCmdDraw(m_ActiveCommandBuffer, 6, 1, 0, 0);
+	// the placeholder doesn't read the scene, the ray tracing pipeline is only used once the scene is uploaded
+	if (!m_SceneBuffersAcquired && m_Pipeline != m_PlaceholderPipeline)
+	{
+		m_UploadManager->RecordAcquireBarriers(m_ActiveCommandBuffer,
+			m_SceneUploadTicket,
+			m_ComputeRayTracing ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			VK_ACCESS_SHADER_READ_BIT);
+		m_SceneBuffersAcquired = true;
+	}
 
+	// restart the accumulation whenever the view changes (unless the history is reprojected), and while the
+	// placeholder doesn't accumulate anything
+	if ((m_Camera->IsUpdated() && !m_Reprojection) || m_Pipeline == m_PlaceholderPipeline)
+		ResetAccumulation();
+	else if (m_Camera->IsUpdated())
+		m_TileScheduler->Restart(); // the tiles traced so far saw the previous view
+	// the dynamic offset of the uniform data is needed when the descriptor sets are bound
 	UpdateUniformBuffers();
 
-	OnUiRender();
+	// the fragment path traces the whole image every frame
+	bool passCompleted = true;
+	if (m_ComputeRayTracing)
+	{
+		// dispatches can't be recorded inside a render pass, the
+		// render pass only draws the ui on top of the traced image
+		passCompleted = DispatchRayTracing();
+		BeginRenderPass(m_RenderPass, m_SwapchainFramebuffers[m_NextFrameIndex]);
+	}
+	else
+	{
+		// the placeholder is a fullscreen program
+		const FragmentProgram* program = m_Pipeline != m_PlaceholderPipeline
+			? &s_FragmentPrograms[static_cast<size_t>(m_PipelineProgramIndex)]
+			: nullptr;
+		if (m_Headless)
+		{
+			const uint64_t pixelCount =
+				program ? static_cast<uint64_t>(m_SwapchainExtent.width) * m_SwapchainExtent.height : 0;
+			m_PendingPixelCounts.push_back({ m_FrameNumber + 1, m_CurrentFrameIndex, pixelCount, false });
+		}
+		const bool rasterizesGeometry = program && program->rasterizesGeometry;
+		// fullscreen programs draw a single triangle straight into the swapchain image
+		if (rasterizesGeometry)
+			BeginRenderPass(m_GeometryRenderPass, m_GeometryFramebuffers[m_NextFrameIndex]);
+		else
+			BeginRenderPass(m_RenderPass, m_SwapchainFramebuffers[m_NextFrameIndex]);
+		m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Ray tracing");
+		vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_Pipeline);
+		vkCmdBindDescriptorSets(m_ActiveCommandBuffer,
+			VK_PIPELINE_BIND_POINT_GRAPHICS,
+			m_PipelineLayout,
+			0,
+			1,
+			&m_DescriptorSets[m_CurrentFrameIndex],
+			1,
+			&m_UniformBufferOffset);
+		vkCmdDraw(m_ActiveCommandBuffer, program ? program->vertexCount : s_FullscreenVertexCount, 1, 0, 0);
+		m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+
+		// the multisampled image is resolved into the swapchain image, the ui is drawn single sampled on top of it
+		if (rasterizesGeometry)
+		{
+			m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Resolve");
+			vkCmdEndRenderPass(m_ActiveCommandBuffer);
+			m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+			BeginRenderPass(m_OverlayRenderPass, m_SwapchainFramebuffers[m_NextFrameIndex]);
+		}
+	}
+
+	if (!m_Headless)
+	{
+		m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "UI");
+		OnUiRender();
+		m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+	}
 	EndScene();
+
+	// a time sliced pass accumulates a sample once all its tiles have been traced
+	if (passCompleted)
+	{
+		++m_AccumulationFrameIndex;
+		// the view the history is reprojected from
+		m_HistoryViewProj = m_Camera->GetViewProjectionMatrix();
+		m_HistoryCameraPos = m_Camera->GetPosition();
+	}
+	++m_FrameNumber;
 }
 
 void Engine::UpdateUniformBuffers()
 {
+	PROFILE_FUNCTION();
 	static std::chrono::time_point<std::chrono::high_resolution_clock> startTime =
 		std::chrono::high_resolution_clock::now();
 	std::chrono::time_point<std::chrono::high_resolution_clock> currentTime = std::chrono::high_resolution_clock::now();
 
 	UniformBufferObject ubo{};
-	ubo.resolution = glm::vec3(m_SwapchainExtent.width, m_SwapchainExtent.height, 0.0f);
-	ubo.time = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count();
+	ubo.resolution = glm::vec3(m_RenderExtent.width, m_RenderExtent.height, 0.0f);
+	ubo.time = m_FixedTime.value_or(
+		std::chrono::duration<float, std::chrono::seconds::period>(currentTime - startTime).count());
 
 	ubo.cameraPos = m_Camera->GetPosition();
+	ubo.frameIndex = m_AccumulationFrameIndex;
 	ubo.model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, -0.2f));
 	ubo.viewProj = m_Camera->GetViewProjectionMatrix();
 	ubo.invView = m_Camera->GetInverseViewMatrix();
 	ubo.invProj = m_Camera->GetInverseProjectionMatrix();
 	ubo.invViewProj = m_Camera->GetInverseViewProjectionMatrix();
-
-	void* data = nullptr;
-	vkMapMemory(m_DeviceVk, m_UniformBufferMemory[m_CurrentFrameIndex], 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_DeviceVk, m_UniformBufferMemory[m_CurrentFrameIndex]);
+	ubo.prevViewProj = m_HistoryViewProj;
+	ubo.prevCameraPos = m_HistoryCameraPos;
+	ubo.viewChanged = m_Reprojection && ubo.viewProj != m_HistoryViewProj ? 1 : 0;
+	ubo.maxBounces = m_MaxBounces;
+
+	// the previous frame of the current slot has been waited on in `BeginScene()`, so its region can be overwritten
+	m_UniformRingBuffer->BeginFrame(m_CurrentFrameIndex);
+	m_UniformBufferOffset = m_UniformRingBuffer->Push(ubo);
 }
 
 void Engine::BeginScene()
 {
-	// wait for previous frame to signal the fence
-	vkWaitForFences(m_DeviceVk, 1, &m_InFlightFences[m_CurrentFrameIndex], VK_TRUE, UINT64_MAX);
+	PROFILE_FUNCTION();
 
-	VkResult result = vkAcquireNextImageKHR(m_DeviceVk,
-		m_Swapchain,
-		UINT64_MAX,
-		m_ImageAvailableSemaphores[m_CurrentFrameIndex],
-		VK_NULL_HANDLE,
-		&m_NextFrameIndex);
-	THROW(result != VK_SUCCESS, "Failed to acquire swapchain image!")
+	// wait until the device has finished the last frame recorded into this slot
+	{
+		PROFILE_SCOPE("vkWaitSemaphores");
+		WaitForFrame(m_FrameTimelineValues[m_CurrentFrameIndex]);
+	}
+	UpdateLatency();
+	UpdateTracedPixelCounts();
 
-	// resetting the fence has been set after the result has been checked to
-	// avoid a deadlock reset the fence to unsignaled state
-	vkResetFences(m_DeviceVk, 1, &m_InFlightFences[m_CurrentFrameIndex]);
+	// the offscreen target is the only "swapchain image" in headless mode
+	if (m_Headless)
+	{
+		m_NextFrameIndex = 0;
+	}
+	else
+	{
+		PROFILE_SCOPE("vkAcquireNextImageKHR");
+		VkResult result = vkAcquireNextImageKHR(m_DeviceVk,
+			m_Swapchain,
+			UINT64_MAX,
+			m_ImageAvailableSemaphores[m_CurrentFrameIndex],
+			VK_NULL_HANDLE,
+			&m_NextFrameIndex);
+		THROW(result != VK_SUCCESS, "Failed to acquire swapchain image!")
+	}
 
 	// begin command buffer
 	m_ActiveCommandBuffer = m_CommandBuffers[m_CurrentFrameIndex];
@@ -207,6 +563,32 @@ void Engine::BeginScene()
 	THROW(vkBeginCommandBuffer(m_CommandBuffers[m_CurrentFrameIndex], &cmdBuffBeginInfo) != VK_SUCCESS,
 		"Failed to begin recording command buffer!")
 
+	// the accumulation images written by the previous frame are read (and the other one is
+	// overwritten) by this frame, so the previous frame's shader writes have to finish first
+	const VkPipelineStageFlags rayTracingStage =
+		m_ComputeRayTracing ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	VkMemoryBarrier accumulationBarrier{};
+	accumulationBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	accumulationBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	accumulationBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		rayTracingStage,
+		rayTracingStage,
+		0,
+		1,
+		&accumulationBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+
+	// the queries of the frame are reset outside of the render pass
+	m_GpuProfiler->BeginFrame(m_ActiveCommandBuffer, m_CurrentFrameIndex);
+	m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Frame");
+}
+
+void Engine::BeginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer)
+{
 	// begin render pass
 	// clear values for each attachment
 	std::array<VkClearValue, 3> clearValues;
@@ -228,8 +610,8 @@ void Engine::BeginScene()
 
 	VkRenderPassBeginInfo renderPassBeginInfo{};
 	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderPass = m_RenderPass;
-	renderPassBeginInfo.framebuffer = m_SwapchainFramebuffers[m_NextFrameIndex];
+	renderPassBeginInfo.renderPass = renderPass;
+	renderPassBeginInfo.framebuffer = framebuffer;
 	renderPassBeginInfo.renderArea.offset = { 0, 0 };
 	renderPassBeginInfo.renderArea.extent = m_SwapchainExtent;
 	renderPassBeginInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
@@ -237,40 +619,584 @@ void Engine::BeginScene()
 	vkCmdBeginRenderPass(m_ActiveCommandBuffer, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
 }
 
+void Engine::UpdateRenderExtent(float deltatime)
+{
+	// the fragment path renders into the multisampled framebuffer, which has the swapchain extent
+	if (!m_ComputeRayTracing)
+	{
+		m_RenderExtent = m_SwapchainExtent;
+		return;
+	}
+
+	// the placeholder is much cheaper than the ray tracer, its frame times would raise the scale, and the
+	// time sliced frames take as long as the budget, whatever the scale
+	if (m_Pipeline != m_PlaceholderPipeline && !m_TileScheduler->IsEnabled())
+	{
+		// the GPU time of the frame doesn't include waiting for the vertical blank (FIFO), the CPU frame time does
+		const float gpuFrameTime = GetLastGpuTime(m_GpuProfiler->GetStatistics(), "Frame");
+		m_ResolutionScaler->Update(gpuFrameTime > 0.0f ? gpuFrameTime : deltatime);
+	}
+
+	const VkExtent2D renderExtent = m_ResolutionScaler->GetRenderExtent(m_SwapchainExtent);
+	// the accumulated samples were traced at the previous extent
+	if (renderExtent.width != m_RenderExtent.width || renderExtent.height != m_RenderExtent.height)
+		ResetAccumulation();
+	m_RenderExtent = renderExtent;
+}
+
+bool Engine::DispatchRayTracing()
+{
+	VkImage swapchainImage = m_SwapchainImages[m_NextFrameIndex];
+	const bool isUpscaled =
+		m_RenderExtent.width != m_SwapchainExtent.width || m_RenderExtent.height != m_SwapchainExtent.height;
+
+	// the placeholder is cheap, it covers the whole image with a single slice
+	const bool isPlaceholder = m_Pipeline == m_PlaceholderPipeline;
+	// the timestamps read in `BeginScene()` are the ones of the last frame recorded into this slot
+	m_TileScheduler->Update(GetLastGpuTime(m_GpuProfiler->GetStatistics(), "Ray tracing"),
+		m_TracedTileCounts[m_CurrentFrameIndex]);
+	const TileScheduler::Slice slice = m_TileScheduler->NextSlice(m_RenderExtent);
+	m_TracedTileCounts[m_CurrentFrameIndex] = isPlaceholder ? 0 : slice.tileCount;
+	const bool passCompleted = isPlaceholder || slice.completesPass;
+
+	// the previous frame's blit (or upscale) has to finish reading the output image before it is overwritten
+	VkImageMemoryBarrier outputBarrier = initializers::ImageMemoryBarrier(
+		m_OutputImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT);
+	// the image is only discarded if this frame traces all of it, a time sliced pass keeps the tiles of the previous
+	// frames (the output image is left in `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL` at the end of every frame)
+	if (!passCompleted || slice.firstTile > 0)
+		outputBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&outputBarrier);
+
+	m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Ray tracing");
+	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+	vkCmdBindDescriptorSets(m_ActiveCommandBuffer,
+		VK_PIPELINE_BIND_POINT_COMPUTE,
+		m_PipelineLayout,
+		0,
+		1,
+		&m_DescriptorSets[m_CurrentFrameIndex],
+		1,
+		&m_UniformBufferOffset);
+	if (isPlaceholder)
+	{
+		if (m_Headless)
+			m_PendingPixelCounts.push_back({ m_FrameNumber + 1, m_CurrentFrameIndex, 0, false });
+
+		// one work group per 8x8 pixels, the edge work groups are clipped in the shader
+		vkCmdDispatch(m_ActiveCommandBuffer,
+			(m_RenderExtent.width + s_ComputeTileSize - 1) / s_ComputeTileSize,
+			(m_RenderExtent.height + s_ComputeTileSize - 1) / s_ComputeTileSize,
+			1);
+	}
+	else
+	{
+		// every pixel is sampled until there is an average to measure the noise of
+		const bool isAdaptive = m_NoiseThreshold > 0.0f && m_AccumulationFrameIndex > 0;
+		const TraceTiles tiles{ slice.firstTile, TileScheduler::s_TileSize, isAdaptive ? m_NoiseThreshold : 0.0f };
+		vkCmdPushConstants(
+			m_ActiveCommandBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(TraceTiles), &tiles);
+		if (isAdaptive)
+			DispatchAdaptiveSampling(slice);
+		// the pixels listed by `adaptive.comp` are only known once the frame has finished
+		if (m_Headless)
+		{
+			const uint64_t pixelCount = isAdaptive ? 0 : TileScheduler::GetPixelCount(slice, m_RenderExtent);
+			m_PendingPixelCounts.push_back({ m_FrameNumber + 1, m_CurrentFrameIndex, pixelCount, isAdaptive });
+		}
+
+		if (m_Wavefront)
+		{
+			DispatchWavefront(slice, isAdaptive);
+		}
+		else if (isAdaptive)
+		{
+			// one work group per 64 listed pixels
+			vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+			vkCmdDispatchIndirect(m_ActiveCommandBuffer, m_AdaptivePixelBuffer, 0);
+		}
+		else
+		{
+			// the work groups of a tile in x and y, one tile per z
+			vkCmdDispatch(m_ActiveCommandBuffer,
+				TileScheduler::s_TileSize / s_ComputeTileSize,
+				TileScheduler::s_TileSize / s_ComputeTileSize,
+				slice.tileCount);
+		}
+	}
+	m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+
+	// the average is only complete once all the tiles of the pass have been traced
+	if (m_DenoiseIterations > 0 && !isPlaceholder && passCompleted)
+		DispatchDenoiser();
+
+	// while a pass is incomplete, the last complete image stays on screen (or the unfinished pass, until there is one)
+	const bool showsPresentedImage = !passCompleted && m_HasPresentedImage;
+	// the next pass is probably time sliced too, so the image is kept until it has been completed
+	const bool keepsPresentedImage = passCompleted && m_TileScheduler->IsSliced();
+	VkImage blitSource = m_OutputImage;
+	if (showsPresentedImage)
+	{
+		blitSource = m_PresentedImage;
+	}
+	else if (isUpscaled)
+	{
+		// output image written -> read, the previous frame's blit has to finish reading the upscaled image
+		std::array<VkImageMemoryBarrier, 2> upscaleBarriers{
+			initializers::ImageMemoryBarrier(m_OutputImage,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_IMAGE_LAYOUT_GENERAL,
+				VK_ACCESS_SHADER_WRITE_BIT,
+				VK_ACCESS_SHADER_READ_BIT),
+			initializers::ImageMemoryBarrier(
+				m_UpscaledImage, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL, 0, VK_ACCESS_SHADER_WRITE_BIT),
+		};
+		vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			static_cast<uint32_t>(upscaleBarriers.size()),
+			upscaleBarriers.data());
+
+		// the upscale pipeline has the same layout, so the descriptor set stays bound
+		m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Upscale");
+		vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_UpscalePipeline);
+		vkCmdDispatch(m_ActiveCommandBuffer,
+			(m_SwapchainExtent.width + s_ComputeTileSize - 1) / s_ComputeTileSize,
+			(m_SwapchainExtent.height + s_ComputeTileSize - 1) / s_ComputeTileSize,
+			1);
+		m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+		blitSource = m_UpscaledImage;
+	}
+
+	// blit source -> transfer src (the presented image already is), swapchain image -> transfer dst,
+	// the output image is also transitioned if it isn't the blit source, the next slice expects it there
+	std::vector<VkImageMemoryBarrier> blitBarriers{
+		initializers::ImageMemoryBarrier(swapchainImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0,
+			VK_ACCESS_TRANSFER_WRITE_BIT),
+	};
+	if (blitSource != m_PresentedImage)
+	{
+		blitBarriers.push_back(initializers::ImageMemoryBarrier(blitSource,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT));
+	}
+	if (blitSource != m_OutputImage)
+	{
+		blitBarriers.push_back(initializers::ImageMemoryBarrier(m_OutputImage,
+			VK_IMAGE_LAYOUT_GENERAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_SHADER_WRITE_BIT,
+			0));
+	}
+	if (keepsPresentedImage)
+	{
+		// the previous frame's blit has to finish reading it
+		blitBarriers.push_back(initializers::ImageMemoryBarrier(m_PresentedImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0,
+			VK_ACCESS_TRANSFER_WRITE_BIT));
+	}
+	// the swapchain image is acquired at the transfer stage (see `EndScene()`)
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		static_cast<uint32_t>(blitBarriers.size()),
+		blitBarriers.data());
+
+	m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Blit");
+	// blit instead of copy, because the swapchain format (BGRA) differs from the output format (RGBA)
+	VkImageBlit blitRegion{};
+	blitRegion.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blitRegion.srcOffsets[0] = { 0, 0, 0 };
+	blitRegion.srcOffsets[1] = {
+		static_cast<int32_t>(m_SwapchainExtent.width), static_cast<int32_t>(m_SwapchainExtent.height), 1
+	};
+	blitRegion.dstSubresource = blitRegion.srcSubresource;
+	blitRegion.dstOffsets[0] = blitRegion.srcOffsets[0];
+	blitRegion.dstOffsets[1] = blitRegion.srcOffsets[1];
+	vkCmdBlitImage(m_ActiveCommandBuffer,
+		blitSource,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		swapchainImage,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1,
+		&blitRegion,
+		VK_FILTER_NEAREST);
+
+	if (keepsPresentedImage)
+	{
+		// same format and extent, the blit source is already in `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL`
+		VkImageCopy copyRegion{};
+		copyRegion.srcSubresource = blitRegion.srcSubresource;
+		copyRegion.dstSubresource = blitRegion.srcSubresource;
+		copyRegion.extent = { m_SwapchainExtent.width, m_SwapchainExtent.height, 1 };
+		vkCmdCopyImage(m_ActiveCommandBuffer,
+			blitSource,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			m_PresentedImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1,
+			&copyRegion);
+
+		// read by the blits of the next frames
+		VkImageMemoryBarrier presentedBarrier = initializers::ImageMemoryBarrier(m_PresentedImage,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			VK_ACCESS_TRANSFER_WRITE_BIT,
+			VK_ACCESS_TRANSFER_READ_BIT);
+		vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			1,
+			&presentedBarrier);
+		m_HasPresentedImage = true;
+	}
+	m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+
+	// the render pass expects the swapchain image in `VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL`
+	// and its subpass dependency waits for the blit
+	return passCompleted;
+}
+
+void Engine::DispatchAdaptiveSampling(const TileScheduler::Slice& slice)
+{
+	// the previous frame's dispatch has to finish reading the list before it's reset
+	VkBufferMemoryBarrier resetBarrier{};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask =
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	resetBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	resetBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	resetBarrier.buffer = m_AdaptivePixelBuffer;
+	resetBarrier.offset = 0;
+	resetBarrier.size = sizeof(AdaptivePixelsHeader);
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		1,
+		&resetBarrier,
+		0,
+		nullptr);
+	// no pixels, and no work groups in x (the dispatch is empty if every pixel has converged)
+	const AdaptivePixelsHeader header{ { 0, 1, 1 }, 0 };
+	vkCmdUpdateBuffer(m_ActiveCommandBuffer, m_AdaptivePixelBuffer, 0, sizeof(header), &header);
+
+	// the list (and its header) is appended to by every invocation
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0,
+		1,
+		&barrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+
+	// the noisy pixels of the tiles are listed, the converged ones carry their average over
+	// (the pipeline has the same layout, so the descriptor set and the push constants stay bound)
+	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_AdaptivePipeline);
+	vkCmdDispatch(m_ActiveCommandBuffer,
+		TileScheduler::s_TileSize / s_ComputeTileSize,
+		TileScheduler::s_TileSize / s_ComputeTileSize,
+		slice.tileCount);
+
+	// the list is read as the indirect dispatch and by the ray tracer (the images are written for different
+	// pixels, the converged ones by `adaptive.comp` and the listed ones by the ray tracer or the wavefront),
+	// and its pixel count is read back
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask =
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_READ_BIT;
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		1,
+		&barrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+
+	// the traced pixels of the headless frames are counted (see `GetTracedPixelCounts()`)
+	if (m_Headless)
+	{
+		const VkBufferCopy region{ offsetof(AdaptivePixelsHeader, pixelCount),
+			m_CurrentFrameIndex * sizeof(uint32_t),
+			sizeof(uint32_t) };
+		vkCmdCopyBuffer(m_ActiveCommandBuffer, m_AdaptivePixelBuffer, m_TracedPixelReadbackBuffer, 1, &region);
+		// read on the host once the frame has finished
+		VkMemoryBarrier readbackBarrier{};
+		readbackBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		readbackBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		readbackBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_HOST_BIT,
+			0,
+			1,
+			&readbackBarrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
+	}
+}
+
+void Engine::DispatchWavefront(const TileScheduler::Slice& slice, bool isAdaptive)
+{
+	// the previous frame's stages have to finish with the queues before they are reset
+	VkMemoryBarrier resetBarrier{};
+	resetBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	resetBarrier.srcAccessMask =
+		VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+	resetBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+		VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		1,
+		&resetBarrier,
+		0,
+		nullptr,
+		0,
+		nullptr);
+	// no paths, and no work groups in x (the stages of the bounces no path reaches are empty dispatches)
+	const std::vector<WavefrontQueueHeader> headers(
+		static_cast<size_t>(m_MaxBounces) * s_WavefrontQueueCount, WavefrontQueueHeader{ { 0, 1, 1 }, 0 });
+	vkCmdUpdateBuffer(m_ActiveCommandBuffer,
+		m_WavefrontQueueBuffer,
+		0,
+		headers.size() * sizeof(WavefrontQueueHeader),
+		headers.data());
+
+	// every stage appends to the queues read by the next ones, and reads the paths they have written
+	const auto stageBarrier = [this](VkAccessFlags srcAccessMask, VkPipelineStageFlags srcStageMask) {
+		VkMemoryBarrier barrier{};
+		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		barrier.srcAccessMask = srcAccessMask;
+		barrier.dstAccessMask =
+			VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+		vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+			srcStageMask,
+			VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1,
+			&barrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
+	};
+	stageBarrier(VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+	// only the stages of the first bounce are profiled, the scopes of every bounce wouldn't fit into a frame
+	static constexpr std::array<const char*, s_WavefrontStageCount> s_StageNames{
+		"Ray generation", "Intersection", "Lambertian", "Metal", "Dielectric", "Miss"
+	};
+	const auto pushBounce = [this](uint32_t bounce) {
+		vkCmdPushConstants(m_ActiveCommandBuffer,
+			m_PipelineLayout,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			offsetof(WavefrontPass, bounce),
+			sizeof(bounce),
+			&bounce);
+	};
+
+	// the paths start at the first bounce
+	pushBounce(0);
+	m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, s_StageNames[0]);
+	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_WavefrontPipelines[0]);
+	if (isAdaptive)
+	{
+		// one work group per 64 listed pixels, like the ray tracer
+		vkCmdDispatchIndirect(m_ActiveCommandBuffer, m_AdaptivePixelBuffer, 0);
+	}
+	else
+	{
+		// the work groups of a tile in x, one tile per z
+		vkCmdDispatch(m_ActiveCommandBuffer,
+			TileScheduler::s_TileSize * TileScheduler::s_TileSize / s_WavefrontGroupSize,
+			1,
+			slice.tileCount);
+	}
+	m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+	stageBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+	// the intersection, then the materials and the miss (they shade different paths and pixels, so they run
+	// without barriers in between), each over its queue of the bounce
+	for (uint32_t bounce = 0; bounce < m_MaxBounces; ++bounce)
+	{
+		if (bounce > 0)
+			pushBounce(bounce);
+		for (uint32_t stage = 1; stage < s_WavefrontStageCount; ++stage)
+		{
+			// the intersection reads the rays (queue 0), the other stages the queues after it
+			const VkDeviceSize queue = stage - 1;
+			const VkDeviceSize headerOffset =
+				(static_cast<VkDeviceSize>(bounce) * s_WavefrontQueueCount + queue) * sizeof(WavefrontQueueHeader);
+			if (bounce == 0)
+				m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, s_StageNames[stage]);
+			vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_WavefrontPipelines[stage]);
+			vkCmdDispatchIndirect(m_ActiveCommandBuffer, m_WavefrontQueueBuffer, headerOffset);
+			if (bounce == 0)
+				m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+
+			if (stage == 1 || stage + 1 == s_WavefrontStageCount)
+				stageBarrier(VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		}
+	}
+}
+
+void Engine::DispatchDenoiser()
+{
+	// every iteration reads what the previous dispatch (the ray tracer or the previous iteration) has written
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	// the denoise pipeline has the same layout, so the descriptor set stays bound
+	m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Denoise");
+	vkCmdBindPipeline(m_ActiveCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_DenoisePipeline);
+	for (uint32_t i = 0; i < m_DenoiseIterations; ++i)
+	{
+		vkCmdPipelineBarrier(m_ActiveCommandBuffer,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			0,
+			1,
+			&barrier,
+			0,
+			nullptr,
+			0,
+			nullptr);
+
+		const DenoiseIteration iteration{ i, m_DenoiseIterations };
+		vkCmdPushConstants(m_ActiveCommandBuffer,
+			m_PipelineLayout,
+			VK_SHADER_STAGE_COMPUTE_BIT,
+			0,
+			sizeof(DenoiseIteration),
+			&iteration);
+		vkCmdDispatch(m_ActiveCommandBuffer,
+			(m_RenderExtent.width + s_ComputeTileSize - 1) / s_ComputeTileSize,
+			(m_RenderExtent.height + s_ComputeTileSize - 1) / s_ComputeTileSize,
+			1);
+	}
+	m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+}
+
+void Engine::ResetAccumulation()
+{
+	m_AccumulationFrameIndex = 0;
+	// the tiles traced so far belong to the previous pass
+	m_TileScheduler->Restart();
+}
+
 void Engine::EndScene()
 {
+	PROFILE_FUNCTION();
+
+	// the pass the ui has been drawn in
+	m_GpuProfiler->BeginScope(m_ActiveCommandBuffer, "Render pass end");
 	vkCmdEndRenderPass(m_ActiveCommandBuffer);
+	m_GpuProfiler->EndScope(m_ActiveCommandBuffer);
+	m_GpuProfiler->EndScope(m_ActiveCommandBuffer); // frame
 	THROW(vkEndCommandBuffer(m_CommandBuffers[m_CurrentFrameIndex]) != VK_SUCCESS, "Failed to record command buffer!");
 
-	std::array<VkPipelineStageFlags, 1> waitStages{ VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	// the compute path writes to the swapchain image with a blit (transfer stage)
+	std::array<VkPipelineStageFlags, 1> waitStages{ m_ComputeRayTracing
+														? VK_PIPELINE_STAGE_TRANSFER_BIT
+														: VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	VkSubmitInfo submitInfo{};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &m_ImageAvailableSemaphores[m_CurrentFrameIndex];
-	submitInfo.pWaitDstStageMask = waitStages.data();
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &m_CommandBuffers[m_CurrentFrameIndex];
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &m_RenderFinishedSemaphores[m_CurrentFrameIndex];
-
-	// signals the fence after executing the command buffer
-	THROW(vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_InFlightFences[m_CurrentFrameIndex]) != VK_SUCCESS,
-		"Failed to submit draw command buffer!")
+	// the timeline semaphore is signaled with the frame number + 1 when the device has finished the frame,
+	// the render finished semaphore is a binary semaphore for the presentation (its value is ignored)
+	const uint64_t timelineValue = m_FrameNumber + 1;
+	std::array<VkSemaphore, 2> signalSemaphores{ m_FrameTimeline, m_RenderFinishedSemaphores[m_CurrentFrameIndex] };
+	std::array<uint64_t, 2> signalValues{ timelineValue, 0 };
+	VkTimelineSemaphoreSubmitInfo timelineInfo{};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	// there is nothing to acquire or present in headless mode, so only the timeline semaphore is needed
+	timelineInfo.signalSemaphoreValueCount = m_Headless ? 1 : 2;
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.signalSemaphoreCount = timelineInfo.signalSemaphoreValueCount;
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+	if (!m_Headless)
+	{
+		submitInfo.waitSemaphoreCount = 1;
+		submitInfo.pWaitSemaphores = &m_ImageAvailableSemaphores[m_CurrentFrameIndex];
+		submitInfo.pWaitDstStageMask = waitStages.data();
+	}
 
-	std::array<VkSwapchainKHR, 1> swapchains{ m_Swapchain };
-	VkPresentInfoKHR presentInfo{};
-	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = &m_RenderFinishedSemaphores[m_CurrentFrameIndex];
-	presentInfo.swapchainCount = static_cast<uint32_t>(swapchains.size());
-	presentInfo.pSwapchains = swapchains.data();
-	presentInfo.pImageIndices = &m_NextFrameIndex;
-	presentInfo.pResults = nullptr;
+	{
+		PROFILE_SCOPE("vkQueueSubmit");
+		m_PendingFrames.emplace_back(timelineValue, std::chrono::high_resolution_clock::now());
+		THROW(vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS,
+			"Failed to submit draw command buffer!")
+		m_FrameTimelineValues[m_CurrentFrameIndex] = timelineValue;
+	}
 
-	vkQueuePresentKHR(m_PresentQueue, &presentInfo);
+	if (!m_Headless)
+	{
+		std::array<VkSwapchainKHR, 1> swapchains{ m_Swapchain };
+		VkPresentInfoKHR presentInfo{};
+		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+		presentInfo.waitSemaphoreCount = 1;
+		presentInfo.pWaitSemaphores = &m_RenderFinishedSemaphores[m_CurrentFrameIndex];
+		presentInfo.swapchainCount = static_cast<uint32_t>(swapchains.size());
+		presentInfo.pSwapchains = swapchains.data();
+		presentInfo.pImageIndices = &m_NextFrameIndex;
+		presentInfo.pResults = nullptr;
+
+		PROFILE_SCOPE("vkQueuePresentKHR");
+		vkQueuePresentKHR(m_PresentQueue, &presentInfo);
+	}
 
 	// update current frame index
-	m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % Config::maxFramesInFlight;
+	m_CurrentFrameIndex = (m_CurrentFrameIndex + 1) % m_FramesInFlight;
 }
 
 void Engine::OnUiRender()
@@ -279,6 +1205,129 @@ void Engine::OnUiRender()
 
 	ImGui::Begin("Profiler");
 	ImGui::Text("%.2f ms/frame (%d fps)", (1000.0f / m_LastFps), m_LastFps);
+	ImGui::Text("Ray tracing: %s shader", m_ComputeRayTracing ? "compute" : "fragment");
+	// the shaders are compiled and swapped in by the hot reloader
+	if (!m_ComputeRayTracing)
+	{
+		std::array<const char*, s_FragmentPrograms.size()> programNames{};
+		for (size_t i = 0; i < s_FragmentPrograms.size(); ++i)
+			programNames[i] = s_FragmentPrograms[i].name;
+		if (ImGui::Combo(
+				"Shader", &m_FragmentProgramIndex, programNames.data(), static_cast<int>(programNames.size())))
+			m_ShaderHotReloader->Watch(GetShaderSources(), true);
+	}
+	ImGui::Text("Accumulated frames: %u", m_AccumulationFrameIndex);
+
+	// applied at the start of the next frame (see `ApplyFrameSettings()`)
+	int presentModeIndex = 0;
+	std::array<const char*, s_PresentModes.size()> presentModeNames{};
+	for (size_t i = 0; i < s_PresentModes.size(); ++i)
+	{
+		presentModeNames[i] = s_PresentModes[i].name;
+		if (s_PresentModes[i].mode == m_PresentMode)
+			presentModeIndex = static_cast<int>(i);
+	}
+	if (ImGui::Combo(
+			"Present mode", &presentModeIndex, presentModeNames.data(), static_cast<int>(presentModeNames.size())))
+		m_RequestedPresentMode = s_PresentModes[static_cast<size_t>(presentModeIndex)].mode;
+	if (m_SwapchainPresentMode != m_PresentMode)
+		ImGui::Text("(not supported, using %s)", GetPresentModeName(m_SwapchainPresentMode));
+	auto framesInFlight = static_cast<int>(m_FramesInFlight);
+	if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, static_cast<int>(Config::maxFramesInFlight)))
+		m_RequestedFramesInFlight = static_cast<uint32_t>(framesInFlight);
+	if (!m_LatencyHistory.empty())
+	{
+		ImGui::Text("Latency: %.2f ms avg, %.2f ms max (submit to device done)",
+			std::accumulate(m_LatencyHistory.begin(), m_LatencyHistory.end(), 0.0f)
+				/ static_cast<float>(m_LatencyHistory.size()),
+			*std::max_element(m_LatencyHistory.begin(), m_LatencyHistory.end()));
+	}
+
+	// keep the accumulated samples while the camera moves
+	ImGui::Checkbox("Reproject history", &m_Reprojection);
+	// the samples accumulated so far were traced with the previous limit
+	auto maxBounces = static_cast<int>(m_MaxBounces);
+	if (ImGui::SliderInt("Max bounces", &maxBounces, 1, static_cast<int>(s_MaxBounces)))
+	{
+		m_MaxBounces = static_cast<uint32_t>(maxBounces);
+		ResetAccumulation();
+	}
+
+	// dynamic resolution (compute path), 0 ms keeps the render scale fixed
+	if (m_ComputeRayTracing)
+	{
+		float targetFrameTime = m_ResolutionScaler->GetTargetFrameTime();
+		if (ImGui::SliderFloat("Target frame time", &targetFrameTime, 0.0f, 50.0f, "%.1f ms"))
+			m_ResolutionScaler->SetTargetFrameTime(targetFrameTime);
+		float renderScale = m_ResolutionScaler->GetScale();
+		// adapted to the target frame time if there is one
+		if (!m_ResolutionScaler->IsDynamic()
+			&& ImGui::SliderFloat(
+				"Render scale", &renderScale, ResolutionScaler::s_MinScale, ResolutionScaler::s_MaxScale, "%.2f"))
+		{
+			m_ResolutionScaler->SetScale(renderScale);
+		}
+		ImGui::Text("Render resolution: %ux%u (%.2f)", m_RenderExtent.width, m_RenderExtent.height, renderScale);
+
+		// time slicing, 0 ms traces the whole image every frame (the slices are sized with the GPU timings)
+		float traceBudget = m_TileScheduler->GetBudget();
+		if (m_GpuProfiler->IsSupported() && ImGui::SliderFloat("Trace budget", &traceBudget, 0.0f, 50.0f, "%.1f ms"))
+			m_TileScheduler->SetBudget(traceBudget);
+
+		// adaptive sampling, 0 samples every pixel
+		ImGui::SliderFloat("Noise threshold", &m_NoiseThreshold, 0.0f, 0.05f, "%.3f");
+
+		// filters the accumulated image, 0 iterations disable the denoiser
+		auto denoiseIterations = static_cast<int>(m_DenoiseIterations);
+		if (ImGui::SliderInt("Denoiser iterations", &denoiseIterations, 0, static_cast<int>(s_MaxDenoiseIterations)))
+			m_DenoiseIterations = static_cast<uint32_t>(denoiseIterations);
+		if (m_TileScheduler->IsSliced())
+		{
+			ImGui::Text("Traced tiles: %u / %u (%ux%u pixels)",
+				m_TileScheduler->GetProgress(),
+				m_TileScheduler->GetTileCount(),
+				TileScheduler::s_TileSize,
+				TileScheduler::s_TileSize);
+		}
+	}
+
+	const MemoryStatistics memoryStats = m_Allocator->GetStatistics();
+	ImGui::Text("Device memory: %.1f / %.1f MiB (%.1f MiB wasted)",
+		static_cast<float>(memoryStats.bytesUsed) / (1024.0f * 1024.0f),
+		static_cast<float>(memoryStats.bytesAllocated) / (1024.0f * 1024.0f),
+		static_cast<float>(memoryStats.bytesWasted) / (1024.0f * 1024.0f));
+	ImGui::Text("Memory blocks: %u (+ %u dedicated)", memoryStats.blockCount, memoryStats.dedicatedAllocationCount);
+
+	if (m_GpuProfiler->IsSupported() && ImGui::BeginTable("GPU timings", 5))
+	{
+		ImGui::TableSetupColumn("GPU scope");
+		ImGui::TableSetupColumn("avg ms");
+		ImGui::TableSetupColumn("min ms");
+		ImGui::TableSetupColumn("max ms");
+		ImGui::TableSetupColumn("last ms");
+		ImGui::TableHeadersRow();
+		for (const GpuScopeStatistics& scope : m_GpuProfiler->GetStatistics())
+		{
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::Text("%*s%s", static_cast<int>(scope.depth * 2), "", scope.name.c_str());
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.averageMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.minMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.maxMs);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", scope.lastMs);
+		}
+		ImGui::EndTable();
+	}
+	// the scopes of the last frames, for chrome://tracing or Perfetto
+	if (m_GpuProfiler->IsSupported() && ImGui::Button("Export GPU trace"))
+		m_GpuProfiler->ExportChromeTrace("gpu_trace.json");
+	// the scopes of all the threads, also exported with F12
+	if (ImGui::Button("Export CPU trace"))
+		Profiler::ExportChromeTrace("cpu_trace.json");
 	ImGui::End();
 
 	ImGuiOverlay::End(m_ActiveCommandBuffer);
@@ -322,13 +1371,14 @@ void Engine::CreateVulkanInstance(const char* title)
 	appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
 	appInfo.pEngineName = "No Engine";
 	appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-	appInfo.apiVersion = VK_API_VERSION_1_0; // the highest version the application is designed to use
+	// the highest version the application is designed to use (1.2 for timeline semaphores)
+	appInfo.apiVersion = VK_API_VERSION_1_2;
 
 	VkInstanceCreateInfo instanceInfo{};
 	instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
 	instanceInfo.pApplicationInfo = &appInfo;
 	// get required extensions
-	std::vector<const char*> extensions = utils::GetRequiredExtensions();
+	std::vector<const char*> extensions = utils::GetRequiredExtensions(m_Headless);
 	instanceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 	instanceInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -378,7 +1428,7 @@ void Engine::PickPhysicalDevice()
 
 	for (const auto& device : physicalDevices)
 	{
-		if (utils::IsDeviceSuitable(device, m_Window->GetWindowSurface()))
+		if (utils::IsDeviceSuitable(device, GetWindowSurface()))
 		{
 			m_PhysicalDevice = device;
 			vkGetPhysicalDeviceProperties(m_PhysicalDevice, &m_PhysicalDeviceProperties);
@@ -398,12 +1448,14 @@ void Engine::PickPhysicalDevice()
 void Engine::CreateLogicalDevice()
 {
 	// create queue
-	m_QueueFamilyIndices = utils::FindQueueFamilies(m_PhysicalDevice, m_Window->GetWindowSurface());
+	m_QueueFamilyIndices = utils::FindQueueFamilies(m_PhysicalDevice, GetWindowSurface());
 
 	// we have multiple queues so we create a set of unique queue families
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
 	std::set<uint32_t> uniqueQueueFamilies = { m_QueueFamilyIndices.graphicsFamily.value(),
 		m_QueueFamilyIndices.presentFamily.value() };
+	if (m_QueueFamilyIndices.transferFamily.has_value())
+		uniqueQueueFamilies.insert(m_QueueFamilyIndices.transferFamily.value());
 
 	float queuePriority = 1.0f;
 	for (const auto& queueFamily : uniqueQueueFamilies)
@@ -419,19 +1471,30 @@ void Engine::CreateLogicalDevice()
 	// specify used device features
 	VkPhysicalDeviceFeatures deviceFeatures{};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
-	deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading
+	deviceFeatures.fragmentStoresAndAtomics = VK_TRUE; // the fragment shader writes the accumulation images
+	VkPhysicalDeviceVulkan12Features vulkan12Features{};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE; // tracks the frames in flight
 
 	// create logical device
 	VkDeviceCreateInfo deviceInfo{};
 	deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	deviceInfo.pNext = &vulkan12Features;
 	deviceInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	deviceInfo.pQueueCreateInfos = queueCreateInfos.data();
 	deviceInfo.pEnabledFeatures = &deviceFeatures;
 
 	// these are similar to create instance but they are device specific this
-	// time
-	deviceInfo.enabledExtensionCount = static_cast<uint32_t>(Config::deviceExtensions.size());
-	deviceInfo.ppEnabledExtensionNames = Config::deviceExtensions.data();
+	// time (the swapchain extension is not needed in headless mode)
+	if (m_Headless)
+	{
+		deviceInfo.enabledExtensionCount = 0;
+	}
+	else
+	{
+		deviceInfo.enabledExtensionCount = static_cast<uint32_t>(Config::deviceExtensions.size());
+		deviceInfo.ppEnabledExtensionNames = Config::deviceExtensions.data();
+	}
 
 	if (Config::enableValidationLayers)
 	{
@@ -449,6 +1512,11 @@ void Engine::CreateLogicalDevice()
 	// get the queue handle
 	vkGetDeviceQueue(m_DeviceVk, m_QueueFamilyIndices.graphicsFamily.value(), 0, &m_GraphicsQueue);
 	vkGetDeviceQueue(m_DeviceVk, m_QueueFamilyIndices.presentFamily.value(), 0, &m_PresentQueue);
+	m_TransferQueue = m_GraphicsQueue;
+	if (m_QueueFamilyIndices.transferFamily.has_value())
+		vkGetDeviceQueue(m_DeviceVk, m_QueueFamilyIndices.transferFamily.value(), 0, &m_TransferQueue);
+	Logger::Info("Uploads run on {} queue",
+		m_QueueFamilyIndices.transferFamily.has_value() ? "a dedicated transfer" : "the graphics");
 }
 
 VkSampleCountFlagBits Engine::GetMaxUsableSampleCount()
@@ -456,18 +1524,7 @@ VkSampleCountFlagBits Engine::GetMaxUsableSampleCount()
 	VkSampleCountFlags counts = m_PhysicalDeviceProperties.limits.framebufferColorSampleCounts
 								& m_PhysicalDeviceProperties.limits.framebufferDepthSampleCounts;
 
-	if (counts & VK_SAMPLE_COUNT_64_BIT)
-		return VK_SAMPLE_COUNT_64_BIT;
-
-	if (counts & VK_SAMPLE_COUNT_32_BIT)
-		return VK_SAMPLE_COUNT_32_BIT;
-
-	if (counts & VK_SAMPLE_COUNT_16_BIT)
-		return VK_SAMPLE_COUNT_16_BIT;
-
-	if (counts & VK_SAMPLE_COUNT_8_BIT)
-		return VK_SAMPLE_COUNT_8_BIT;
-
+	// only the passes that rasterize geometry are multisampled, more than 4x costs a lot of bandwidth for little gain
 	if (counts & VK_SAMPLE_COUNT_4_BIT)
 		return VK_SAMPLE_COUNT_4_BIT;
 
@@ -511,7 +1568,10 @@ void Engine::CreateSwapchain()
 	SwapchainSupportDetails swapchainSupport =
 		utils::QuerySwapchainSupport(m_PhysicalDevice, m_Window->GetWindowSurface());
 	VkSurfaceFormatKHR surfaceFormat = utils::ChooseSurfaceFormat(swapchainSupport.formats);
-	VkPresentModeKHR presentMode = utils::ChoosePresentMode(swapchainSupport.presentModes);
+	VkPresentModeKHR presentMode = utils::ChoosePresentMode(swapchainSupport.presentModes, m_PresentMode);
+	if (presentMode != m_PresentMode)
+		Logger::Warn("The requested present mode isn't supported by the surface, using FIFO");
+	m_SwapchainPresentMode = presentMode;
 	VkExtent2D extent = utils::ChooseExtent(swapchainSupport.capabilities, BIND_FN(m_Window->GetFramebufferSize));
 
 	uint32_t imageCount = swapchainSupport.capabilities.minImageCount + 1;
@@ -525,6 +1585,14 @@ void Engine::CreateSwapchain()
 	swapchainDetails.imageCount = imageCount;
 	swapchainDetails.windowSurface = m_Window->GetWindowSurface();
 	swapchainDetails.currentTransform = swapchainSupport.capabilities.currentTransform;
+	// the compute ray tracer blits its output to the swapchain images
+	swapchainDetails.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	if (m_ComputeRayTracing)
+	{
+		THROW(!(swapchainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT),
+			"Swapchain images cannot be used as a transfer destination!")
+		swapchainDetails.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	}
 	swapchainDetails.queueFamilyIndices = m_QueueFamilyIndices;
 
 	VkSwapchainCreateInfoKHR swapchainInfo = initializers::SwapchainCreateInfo(swapchainDetails);
@@ -562,20 +1630,34 @@ void Engine::RecreateSwapchain()
 
 	CreateSwapchain();
 	CreateSwapchainImageViews();
-	CreateColorResource();
-	CreateDepthResource();
 	CreateFramebuffers();
+	if (m_GeometryRenderPass != VK_NULL_HANDLE)
+		CreateGeometryResources();
+
+	// the accumulated samples are only valid for the old extent, and the readback buffer holds the pixel counts of
+	// the last frames (the device is idle)
+	UpdateTracedPixelCounts();
+	CleanupStorageImages();
+	CreateStorageImages();
+	WriteStorageImageDescriptors();
+	ResetAccumulation();
 }
 
 void Engine::CleanupSwapchain()
 {
-	vkDestroyImageView(m_DeviceVk, m_DepthImageView, nullptr);
-	vkDestroyImage(m_DeviceVk, m_DepthImage, nullptr);
-	vkFreeMemory(m_DeviceVk, m_DepthImageMemory, nullptr);
+	if (m_GeometryRenderPass != VK_NULL_HANDLE)
+	{
+		vkDestroyImageView(m_DeviceVk, m_DepthImageView, nullptr);
+		vkDestroyImage(m_DeviceVk, m_DepthImage, nullptr);
+		m_Allocator->Free(m_DepthImageAllocation);
+
+		vkDestroyImageView(m_DeviceVk, m_ColorImageView, nullptr);
+		vkDestroyImage(m_DeviceVk, m_ColorImage, nullptr);
+		m_Allocator->Free(m_ColorImageAllocation);
 
-	vkDestroyImageView(m_DeviceVk, m_ColorImageView, nullptr);
-	vkDestroyImage(m_DeviceVk, m_ColorImage, nullptr);
-	vkFreeMemory(m_DeviceVk, m_ColorImageMemory, nullptr);
+		for (const auto& framebuffer : m_GeometryFramebuffers)
+			vkDestroyFramebuffer(m_DeviceVk, framebuffer, nullptr);
+	}
 
 	for (const auto& framebuffer : m_SwapchainFramebuffers)
 		vkDestroyFramebuffer(m_DeviceVk, framebuffer, nullptr);
@@ -583,11 +1665,115 @@ void Engine::CleanupSwapchain()
 	for (const auto& imageView : m_SwapchainImageViews)
 		vkDestroyImageView(m_DeviceVk, imageView, nullptr);
 
+	if (m_Headless)
+	{
+		vkDestroyImage(m_DeviceVk, m_OffscreenImage, nullptr);
+		m_Allocator->Free(m_OffscreenImageAllocation);
+		return;
+	}
+
 	// swapchain images are destroyed with `vkDestroySwapchainKHR()`
 	vkDestroySwapchainKHR(m_DeviceVk, m_Swapchain, nullptr);
 }
 
+void Engine::CreateOffscreenTarget(const uint64_t width, const uint64_t height)
+{
+	// same format as the one preferred for the swapchain, so the shaders behave the same
+	m_SwapchainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	m_SwapchainExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+	utils::CreateImage(m_DeviceVk,
+		*m_Allocator,
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height,
+		1,
+		VK_SAMPLE_COUNT_1_BIT,
+		m_SwapchainImageFormat,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_OffscreenImage,
+		m_OffscreenImageAllocation);
+
+	// the rest of the engine treats the offscreen image as a single swapchain image
+	m_SwapchainImages = { m_OffscreenImage };
+	m_SwapchainImageViews = { utils::CreateImageView(
+		m_DeviceVk, m_OffscreenImage, m_SwapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT, 1) };
+}
+
+void Engine::SaveOffscreenTarget(const std::string& path)
+{
+	const VkDeviceSize imageSize =
+		static_cast<VkDeviceSize>(m_SwapchainExtent.width) * static_cast<VkDeviceSize>(m_SwapchainExtent.height) * 4;
+
+	VkBuffer stagingBuffer;
+	Allocation stagingBufferAllocation;
+	utils::CreateBuffer(m_DeviceVk,
+		*m_Allocator,
+		imageSize,
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		stagingBuffer,
+		stagingBufferAllocation);
+
+	// the render pass leaves the offscreen image in `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL`
+	utils::CopyImageToBuffer(m_DeviceVk,
+		m_CommandPool,
+		m_GraphicsQueue,
+		m_OffscreenImage,
+		stagingBuffer,
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height);
+
+	utils::SaveImagePpm(path.c_str(),
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height,
+		static_cast<const uint8_t*>(stagingBufferAllocation.mappedData),
+		m_SwapchainImageFormat == VK_FORMAT_B8G8R8A8_UNORM);
+
+	vkDestroyBuffer(m_DeviceVk, stagingBuffer, nullptr);
+	m_Allocator->Free(stagingBufferAllocation);
+
+	Logger::Info("Saved the rendered image to \"{}\"", path);
+}
+
 void Engine::CreateRenderPass()
+{
+	// in headless mode the final image is copied to the host instead of being presented
+	const VkImageLayout finalLayout =
+		m_Headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// single sampled pass without a depth buffer, which draws the ui on top of the blitted image (compute path),
+	// or a fullscreen program that writes every pixel (fragment path)
+	VkAttachmentDescription colorAttachment = initializers::AttachmentDescription(m_SwapchainImageFormat,
+		VK_SAMPLE_COUNT_1_BIT,
+		m_ComputeRayTracing ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+		finalLayout);
+	colorAttachment.loadOp = m_ComputeRayTracing ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	VkAttachmentReference colorRef = initializers::AttachmentReference(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+
+	VkSubpassDescription subpass = initializers::SubpassDescription(1, &colorRef, nullptr, nullptr);
+	// wait for the acquired swapchain image, or for the blit in the compute path
+	VkSubpassDependency subpassDependency = initializers::SubpassDependency(VK_SUBPASS_EXTERNAL,
+		0,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		0,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	if (m_ComputeRayTracing)
+	{
+		subpassDependency.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+		subpassDependency.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		subpassDependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+	}
+
+	VkRenderPassCreateInfo renderPassInfo =
+		initializers::RenderPassCreateInfo(1, &colorAttachment, 1, &subpass, 1, &subpassDependency);
+	THROW(vkCreateRenderPass(m_DeviceVk, &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS,
+		"Failed to create render pass!");
+}
+
+void Engine::CreateGeometryRenderPasses()
 {
 	VkFormat depthFormat = utils::FindDepthFormat();
 
@@ -597,9 +1783,11 @@ void Engine::CreateRenderPass()
 	// depth attachment description
 	VkAttachmentDescription depthAttachment = initializers::AttachmentDescription(
 		depthFormat, m_MsaaSamples, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
-	// color resolve attachment description (Multisample)
-	VkAttachmentDescription colorResolveAttachment = initializers::AttachmentDescription(
-		m_SwapchainImageFormat, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	// color resolve attachment description (Multisample), the overlay pass draws the ui on top of it
+	VkAttachmentDescription colorResolveAttachment = initializers::AttachmentDescription(m_SwapchainImageFormat,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
 
 	// attachment refrences
 	VkAttachmentReference colorRef = initializers::AttachmentReference(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
@@ -622,17 +1810,57 @@ void Engine::CreateRenderPass()
 	// render pass
 	VkRenderPassCreateInfo renderPassInfo = initializers::RenderPassCreateInfo(
 		static_cast<uint32_t>(attachments.size()), attachments.data(), 1, &subpass, 1, &subpassDependency);
-	THROW(vkCreateRenderPass(m_DeviceVk, &renderPassInfo, nullptr, &m_RenderPass) != VK_SUCCESS,
+	THROW(vkCreateRenderPass(m_DeviceVk, &renderPassInfo, nullptr, &m_GeometryRenderPass) != VK_SUCCESS,
+		"Failed to create render pass!");
+
+	// compatible with `m_RenderPass` (same attachment), so it uses the same framebuffers and ui pipeline
+	VkAttachmentDescription overlayAttachment = initializers::AttachmentDescription(m_SwapchainImageFormat,
+		VK_SAMPLE_COUNT_1_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+		m_Headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	overlayAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+	VkAttachmentReference overlayRef =
+		initializers::AttachmentReference(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	VkSubpassDescription overlaySubpass = initializers::SubpassDescription(1, &overlayRef, nullptr, nullptr);
+	// wait for the resolve
+	VkSubpassDependency overlayDependency = initializers::SubpassDependency(VK_SUBPASS_EXTERNAL,
+		0,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT);
+	VkRenderPassCreateInfo overlayInfo =
+		initializers::RenderPassCreateInfo(1, &overlayAttachment, 1, &overlaySubpass, 1, &overlayDependency);
+	THROW(vkCreateRenderPass(m_DeviceVk, &overlayInfo, nullptr, &m_OverlayRenderPass) != VK_SUCCESS,
 		"Failed to create render pass!");
 }
 
+void Engine::CreateGeometryResources()
+{
+	CreateColorResource();
+	CreateDepthResource();
+
+	m_GeometryFramebuffers.resize(m_SwapchainImages.size());
+	for (size_t i = 0; i < m_SwapchainImages.size(); ++i)
+	{
+		std::array<VkImageView, 3> fbAttachments{ m_ColorImageView, m_DepthImageView, m_SwapchainImageViews[i] };
+		VkFramebufferCreateInfo framebufferInfo = initializers::FramebufferCreateInfo(m_GeometryRenderPass,
+			static_cast<uint32_t>(fbAttachments.size()),
+			fbAttachments.data(),
+			m_SwapchainExtent.width,
+			m_SwapchainExtent.height);
+		THROW(vkCreateFramebuffer(m_DeviceVk, &framebufferInfo, nullptr, &m_GeometryFramebuffers[i]) != VK_SUCCESS,
+			"Failed to create framebuffer!")
+	}
+}
+
 void Engine::CreateColorResource()
 {
 	VkFormat colorFormat = m_SwapchainImageFormat;
 	uint32_t miplevels = 1;
 
 	utils::CreateImage(m_DeviceVk,
-		m_PhysicalDevice,
+		*m_Allocator,
 		m_SwapchainExtent.width,
 		m_SwapchainExtent.height,
 		miplevels,
@@ -642,7 +1870,7 @@ void Engine::CreateColorResource()
 		VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		m_ColorImage,
-		m_ColorImageMemory);
+		m_ColorImageAllocation);
 
 	m_ColorImageView =
 		utils::CreateImageView(m_DeviceVk, m_ColorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
@@ -654,7 +1882,7 @@ void Engine::CreateDepthResource()
 	uint32_t miplevels = 1;
 
 	utils::CreateImage(m_DeviceVk,
-		m_PhysicalDevice,
+		*m_Allocator,
 		m_SwapchainExtent.width,
 		m_SwapchainExtent.height,
 		miplevels,
@@ -664,7 +1892,7 @@ void Engine::CreateDepthResource()
 		VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
 		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
 		m_DepthImage,
-		m_DepthImageMemory);
+		m_DepthImageAllocation);
 
 	m_DepthImageView =
 		utils::CreateImageView(m_DeviceVk, m_DepthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, miplevels);
@@ -676,12 +1904,9 @@ void Engine::CreateFramebuffers()
 
 	for (size_t i = 0; i < m_SwapchainImages.size(); ++i)
 	{
-		std::array<VkImageView, 3> fbAttachments{ m_ColorImageView, m_DepthImageView, m_SwapchainImageViews[i] };
-		VkFramebufferCreateInfo framebufferInfo = initializers::FramebufferCreateInfo(m_RenderPass,
-			static_cast<uint32_t>(fbAttachments.size()),
-			fbAttachments.data(),
-			m_SwapchainExtent.width,
-			m_SwapchainExtent.height);
+		// also used by the overlay pass of the programs that rasterize geometry (compatible render pass)
+		VkFramebufferCreateInfo framebufferInfo = initializers::FramebufferCreateInfo(
+			m_RenderPass, 1, &m_SwapchainImageViews[i], m_SwapchainExtent.width, m_SwapchainExtent.height);
 		THROW(vkCreateFramebuffer(m_DeviceVk, &framebufferInfo, nullptr, &m_SwapchainFramebuffers[i]) != VK_SUCCESS,
 			"Failed to create framebuffer!")
 	}
@@ -689,29 +1914,498 @@ void Engine::CreateFramebuffers()
 
 void Engine::CreateUniformBuffers()
 {
-	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-	m_UniformBuffers.resize(Config::maxFramesInFlight);
-	m_UniformBufferMemory.resize(Config::maxFramesInFlight);
+	m_UniformRingBuffer = std::make_unique<UniformRingBuffer>(m_DeviceVk,
+		*m_Allocator,
+		m_PhysicalDeviceProperties.limits,
+		s_UniformFrameSize,
+		Config::maxFramesInFlight);
+}
 
-	for (uint64_t i = 0; i < Config::maxFramesInFlight; ++i)
+void Engine::CreateSceneBuffers()
+{
+	// same order as the bindings (3 - 9) in `raytracing.glsl`
+	std::array<std::vector<uint8_t>, 7> bufferData{ m_Scene->GetMaterialBufferData(),
+		m_Scene->GetSphereBufferData(),
+		m_Scene->GetPlaneBufferData(),
+		m_Scene->GetBvhNodeBufferData(),
+		m_Scene->GetPrimitiveRefBufferData(),
+		m_Scene->GetVertexBufferData(),
+		m_Scene->GetTriangleBufferData() };
+
+	// the copies run on the transfer queue while the placeholder is drawn, see `UpdatePipeline()`
+	for (size_t i = 0; i < m_SceneBuffers.size(); ++i)
 	{
+		const VkDeviceSize bufferSize = bufferData[i].size();
 		utils::CreateBuffer(m_DeviceVk,
-			m_PhysicalDevice,
+			*m_Allocator,
 			bufferSize,
-			VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
-			VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-			m_UniformBuffers[i],
-			m_UniformBufferMemory[i]);
+			VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_SceneBuffers[i],
+			m_SceneBufferAllocations[i]);
+		m_UploadManager->UploadBuffer(m_SceneBuffers[i], bufferData[i].data(), bufferSize);
+	}
+	m_SceneUploadTicket = m_UploadManager->Submit();
+	m_SceneBuffersAcquired = false;
+
+	Logger::Info("Scene: {} material(s), {} sphere(s), {} plane(s), {} triangle(s)",
+		m_Scene->GetMaterials().size(),
+		m_Scene->GetSpheres().size(),
+		m_Scene->GetPlanes().size(),
+		m_Scene->GetTriangles().size());
+	Logger::Info("BVH: {} node(s), depth {}", m_Scene->GetBvh().GetNodes().size(), m_Scene->GetBvh().GetDepth());
+}
+
+void Engine::CreateStorageImages()
+{
+	const VkFormat format = VK_FORMAT_R32G32B32A32_SFLOAT;
+	const uint32_t miplevels = 1;
+
+	for (size_t i = 0; i < m_AccumulationImages.size(); ++i)
+	{
+		utils::CreateImage(m_DeviceVk,
+			*m_Allocator,
+			m_SwapchainExtent.width,
+			m_SwapchainExtent.height,
+			miplevels,
+			VK_SAMPLE_COUNT_1_BIT,
+			format,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_AccumulationImages[i],
+			m_AccumulationImageAllocations[i]);
+
+		m_AccumulationImageViews[i] =
+			utils::CreateImageView(m_DeviceVk, m_AccumulationImages[i], format, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
+
+		// storage images stay in the general layout
+		utils::TransitionImageLayout(m_DeviceVk,
+			m_CommandPool,
+			m_GraphicsQueue,
+			m_AccumulationImages[i],
+			format,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			miplevels);
+
+		// same format, the sample count and the depth need more than 16 bits
+		utils::CreateImage(m_DeviceVk,
+			*m_Allocator,
+			m_SwapchainExtent.width,
+			m_SwapchainExtent.height,
+			miplevels,
+			VK_SAMPLE_COUNT_1_BIT,
+			format,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_HistoryImages[i],
+			m_HistoryImageAllocations[i]);
+		m_HistoryImageViews[i] =
+			utils::CreateImageView(m_DeviceVk, m_HistoryImages[i], format, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
+		utils::TransitionImageLayout(m_DeviceVk,
+			m_CommandPool,
+			m_GraphicsQueue,
+			m_HistoryImages[i],
+			format,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			miplevels);
+	}
+
+	if (!m_ComputeRayTracing)
+		return;
+
+	// RGBA8 is a required storage image format, the swapchain formats aren't
+	const VkFormat outputFormat = VK_FORMAT_R8G8B8A8_UNORM;
+	utils::CreateImage(m_DeviceVk,
+		*m_Allocator,
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height,
+		miplevels,
+		VK_SAMPLE_COUNT_1_BIT,
+		outputFormat,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_OutputImage,
+		m_OutputImageAllocation);
+
+	// the layout is transitioned every frame in `DispatchRayTracing()`
+	m_OutputImageView =
+		utils::CreateImageView(m_DeviceVk, m_OutputImage, outputFormat, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
+
+	// the first pass of a time sliced trace is drawn while its tiles are traced,
+	// so the tiles that haven't been traced yet are cleared to black
+	{
+		VkCommandBuffer cmdBuff = utils::BeginSingleTimeCommands(m_DeviceVk, m_CommandPool);
+		VkImageMemoryBarrier clearBarrier = initializers::ImageMemoryBarrier(m_OutputImage,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			0,
+			VK_ACCESS_TRANSFER_WRITE_BIT);
+		vkCmdPipelineBarrier(cmdBuff,
+			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			1,
+			&clearBarrier);
+		const VkClearColorValue black{ { 0.0f, 0.0f, 0.0f, 1.0f } };
+		const VkImageSubresourceRange range{ VK_IMAGE_ASPECT_COLOR_BIT, 0, miplevels, 0, 1 };
+		vkCmdClearColorImage(cmdBuff, m_OutputImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &black, 1, &range);
+		// the layout the output image has at the end of every frame
+		clearBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		clearBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		clearBarrier.dstAccessMask = 0;
+		vkCmdPipelineBarrier(cmdBuff,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0,
+			nullptr,
+			0,
+			nullptr,
+			1,
+			&clearBarrier);
+		utils::EndSingleTimeCommands(cmdBuff, m_DeviceVk, m_CommandPool, m_GraphicsQueue);
+	}
+
+	// the images have the swapchain extent, so changing the render extent doesn't recreate them
+	utils::CreateImage(m_DeviceVk,
+		*m_Allocator,
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height,
+		miplevels,
+		VK_SAMPLE_COUNT_1_BIT,
+		outputFormat,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_UpscaledImage,
+		m_UpscaledImageAllocation);
+	m_UpscaledImageView =
+		utils::CreateImageView(m_DeviceVk, m_UpscaledImage, outputFormat, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
+
+	// only copied to and blitted from, see `DispatchRayTracing()`
+	utils::CreateImage(m_DeviceVk,
+		*m_Allocator,
+		m_SwapchainExtent.width,
+		m_SwapchainExtent.height,
+		miplevels,
+		VK_SAMPLE_COUNT_1_BIT,
+		outputFormat,
+		VK_IMAGE_TILING_OPTIMAL,
+		VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_PresentedImage,
+		m_PresentedImageAllocation);
+	m_HasPresentedImage = false;
+
+	// the features of the denoiser, and the ping-pong images of its iterations (in the general layout like the
+	// accumulation images), RGBA16F is precise enough for normals, depths and the filtered illumination
+	auto createFeatureImage = [this, miplevels](VkFormat imageFormat, VkImage& image, Allocation& allocation) {
+		utils::CreateImage(m_DeviceVk,
+			*m_Allocator,
+			m_SwapchainExtent.width,
+			m_SwapchainExtent.height,
+			miplevels,
+			VK_SAMPLE_COUNT_1_BIT,
+			imageFormat,
+			VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_STORAGE_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			image,
+			allocation);
+		utils::TransitionImageLayout(m_DeviceVk,
+			m_CommandPool,
+			m_GraphicsQueue,
+			image,
+			imageFormat,
+			VK_IMAGE_LAYOUT_UNDEFINED,
+			VK_IMAGE_LAYOUT_GENERAL,
+			miplevels);
+		return utils::CreateImageView(m_DeviceVk, image, imageFormat, VK_IMAGE_ASPECT_COLOR_BIT, miplevels);
+	};
+	const VkFormat featureFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+	m_AlbedoImageView = createFeatureImage(outputFormat, m_AlbedoImage, m_AlbedoImageAllocation);
+	m_NormalDepthImageView = createFeatureImage(featureFormat, m_NormalDepthImage, m_NormalDepthImageAllocation);
+	for (size_t i = 0; i < m_DenoiseImages.size(); ++i)
+		m_DenoiseImageViews[i] = createFeatureImage(featureFormat, m_DenoiseImages[i], m_DenoiseImageAllocations[i]);
+
+	// a header (the indirect dispatch and the pixel count) and room for every pixel, reset in `DispatchRayTracing()`
+	utils::CreateBuffer(m_DeviceVk,
+		*m_Allocator,
+		sizeof(AdaptivePixelsHeader)
+			+ static_cast<VkDeviceSize>(m_SwapchainExtent.width) * m_SwapchainExtent.height * sizeof(uint32_t),
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_AdaptivePixelBuffer,
+		m_AdaptivePixelBufferAllocation);
+	// the pixel count of the list, copied by every frame slot
+	utils::CreateBuffer(m_DeviceVk,
+		*m_Allocator,
+		Config::maxFramesInFlight * sizeof(uint32_t),
+		VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_TracedPixelReadbackBuffer,
+		m_TracedPixelReadbackBufferAllocation);
+
+	if (m_Wavefront)
+	{
+		const VkDeviceSize pixelCount = static_cast<VkDeviceSize>(m_SwapchainExtent.width) * m_SwapchainExtent.height;
+		utils::CreateBuffer(m_DeviceVk,
+			*m_Allocator,
+			pixelCount * s_WavefrontPathSize,
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_WavefrontPathBuffer,
+			m_WavefrontPathBufferAllocation);
+		// the headers of every bounce, reset in `DispatchWavefront()`, and the ranges of the entries
+		utils::CreateBuffer(m_DeviceVk,
+			*m_Allocator,
+			sizeof(WavefrontQueueHeader) * s_MaxBounces * s_WavefrontQueueCount
+				+ pixelCount * s_WavefrontQueueRanges * sizeof(uint32_t),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			m_WavefrontQueueBuffer,
+			m_WavefrontQueueBufferAllocation);
+	}
+}
+
+void Engine::CleanupStorageImages()
+{
+	for (size_t i = 0; i < m_AccumulationImages.size(); ++i)
+	{
+		vkDestroyImageView(m_DeviceVk, m_AccumulationImageViews[i], nullptr);
+		vkDestroyImage(m_DeviceVk, m_AccumulationImages[i], nullptr);
+		m_Allocator->Free(m_AccumulationImageAllocations[i]);
+		vkDestroyImageView(m_DeviceVk, m_HistoryImageViews[i], nullptr);
+		vkDestroyImage(m_DeviceVk, m_HistoryImages[i], nullptr);
+		m_Allocator->Free(m_HistoryImageAllocations[i]);
+	}
+
+	if (!m_ComputeRayTracing)
+		return;
+
+	vkDestroyImageView(m_DeviceVk, m_OutputImageView, nullptr);
+	vkDestroyImage(m_DeviceVk, m_OutputImage, nullptr);
+	m_Allocator->Free(m_OutputImageAllocation);
+
+	vkDestroyImageView(m_DeviceVk, m_UpscaledImageView, nullptr);
+	vkDestroyImage(m_DeviceVk, m_UpscaledImage, nullptr);
+	m_Allocator->Free(m_UpscaledImageAllocation);
+
+	vkDestroyImage(m_DeviceVk, m_PresentedImage, nullptr);
+	m_Allocator->Free(m_PresentedImageAllocation);
+
+	vkDestroyImageView(m_DeviceVk, m_AlbedoImageView, nullptr);
+	vkDestroyImage(m_DeviceVk, m_AlbedoImage, nullptr);
+	m_Allocator->Free(m_AlbedoImageAllocation);
+	vkDestroyImageView(m_DeviceVk, m_NormalDepthImageView, nullptr);
+	vkDestroyImage(m_DeviceVk, m_NormalDepthImage, nullptr);
+	m_Allocator->Free(m_NormalDepthImageAllocation);
+	for (size_t i = 0; i < m_DenoiseImages.size(); ++i)
+	{
+		vkDestroyImageView(m_DeviceVk, m_DenoiseImageViews[i], nullptr);
+		vkDestroyImage(m_DeviceVk, m_DenoiseImages[i], nullptr);
+		m_Allocator->Free(m_DenoiseImageAllocations[i]);
+	}
+
+	vkDestroyBuffer(m_DeviceVk, m_AdaptivePixelBuffer, nullptr);
+	m_Allocator->Free(m_AdaptivePixelBufferAllocation);
+	vkDestroyBuffer(m_DeviceVk, m_TracedPixelReadbackBuffer, nullptr);
+	m_Allocator->Free(m_TracedPixelReadbackBufferAllocation);
+	vkDestroyBuffer(m_DeviceVk, m_WavefrontPathBuffer, nullptr);
+	m_Allocator->Free(m_WavefrontPathBufferAllocation);
+	vkDestroyBuffer(m_DeviceVk, m_WavefrontQueueBuffer, nullptr);
+	m_Allocator->Free(m_WavefrontQueueBufferAllocation);
+}
+
+void Engine::WriteStorageImageDescriptors()
+{
+	std::array<VkDescriptorImageInfo, 2> imageInfos{};
+	std::array<VkDescriptorImageInfo, 2> historyImageInfos{};
+	for (size_t i = 0; i < imageInfos.size(); ++i)
+	{
+		imageInfos[i].imageView = m_AccumulationImageViews[i];
+		imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		imageInfos[i].sampler = VK_NULL_HANDLE;
+		historyImageInfos[i].imageView = m_HistoryImageViews[i];
+		historyImageInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		historyImageInfos[i].sampler = VK_NULL_HANDLE;
+	}
+
+	for (const auto& descriptorSet : m_DescriptorSets)
+	{
+		std::array<VkWriteDescriptorSet, 2> descWrites{
+			initializers::WriteDescriptorSet(descriptorSet,
+				1,
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				static_cast<uint32_t>(imageInfos.size()),
+				nullptr,
+				imageInfos.data()),
+			initializers::WriteDescriptorSet(descriptorSet,
+				s_HistoryImagesBinding,
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				static_cast<uint32_t>(historyImageInfos.size()),
+				nullptr,
+				historyImageInfos.data()),
+		};
+		vkUpdateDescriptorSets(m_DeviceVk, static_cast<uint32_t>(descWrites.size()), descWrites.data(), 0, nullptr);
+
+		if (!m_ComputeRayTracing)
+			continue;
+
+		VkDescriptorImageInfo outputImageInfo{};
+		outputImageInfo.imageView = m_OutputImageView;
+		outputImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		outputImageInfo.sampler = VK_NULL_HANDLE;
+		VkWriteDescriptorSet outputDescWrites = initializers::WriteDescriptorSet(
+			descriptorSet, 2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, nullptr, &outputImageInfo);
+		vkUpdateDescriptorSets(m_DeviceVk, 1, &outputDescWrites, 0, nullptr);
+
+		VkDescriptorImageInfo upscaledImageInfo{};
+		upscaledImageInfo.imageView = m_UpscaledImageView;
+		upscaledImageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		upscaledImageInfo.sampler = VK_NULL_HANDLE;
+		VkWriteDescriptorSet upscaledDescWrites = initializers::WriteDescriptorSet(descriptorSet,
+			s_UpscaledImageBinding,
+			VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+			1,
+			nullptr,
+			&upscaledImageInfo);
+		vkUpdateDescriptorSets(m_DeviceVk, 1, &upscaledDescWrites, 0, nullptr);
+
+		// the albedo and normal/depth images, followed by the two denoise images
+		std::array<VkDescriptorImageInfo, 4> denoiseImageInfos{};
+		denoiseImageInfos[0].imageView = m_AlbedoImageView;
+		denoiseImageInfos[1].imageView = m_NormalDepthImageView;
+		denoiseImageInfos[2].imageView = m_DenoiseImageViews[0];
+		denoiseImageInfos[3].imageView = m_DenoiseImageViews[1];
+		for (VkDescriptorImageInfo& imageInfo : denoiseImageInfos)
+			imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		std::array<VkWriteDescriptorSet, 3> denoiseDescWrites{
+			initializers::WriteDescriptorSet(descriptorSet,
+				s_AlbedoImageBinding,
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				1,
+				nullptr,
+				&denoiseImageInfos[0]),
+			initializers::WriteDescriptorSet(descriptorSet,
+				s_NormalDepthImageBinding,
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				1,
+				nullptr,
+				&denoiseImageInfos[1]),
+			initializers::WriteDescriptorSet(descriptorSet,
+				s_DenoiseImagesBinding,
+				VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+				2,
+				nullptr,
+				&denoiseImageInfos[2]),
+		};
+		vkUpdateDescriptorSets(
+			m_DeviceVk, static_cast<uint32_t>(denoiseDescWrites.size()), denoiseDescWrites.data(), 0, nullptr);
+
+		// sized like the images, so it's recreated with them
+		VkDescriptorBufferInfo adaptiveBufferInfo =
+			initializers::DescriptorBufferInfo(m_AdaptivePixelBuffer, 0, VK_WHOLE_SIZE);
+		VkWriteDescriptorSet adaptiveDescWrites = initializers::WriteDescriptorSet(descriptorSet,
+			s_AdaptivePixelsBinding,
+			VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+			1,
+			&adaptiveBufferInfo,
+			nullptr);
+		vkUpdateDescriptorSets(m_DeviceVk, 1, &adaptiveDescWrites, 0, nullptr);
+
+		if (m_Wavefront)
+		{
+			VkDescriptorBufferInfo pathBufferInfo =
+				initializers::DescriptorBufferInfo(m_WavefrontPathBuffer, 0, VK_WHOLE_SIZE);
+			VkDescriptorBufferInfo queueBufferInfo =
+				initializers::DescriptorBufferInfo(m_WavefrontQueueBuffer, 0, VK_WHOLE_SIZE);
+			std::array<VkWriteDescriptorSet, 2> wavefrontDescWrites{
+				initializers::WriteDescriptorSet(descriptorSet,
+					s_WavefrontPathsBinding,
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					1,
+					&pathBufferInfo,
+					nullptr),
+				initializers::WriteDescriptorSet(descriptorSet,
+					s_WavefrontQueuesBinding,
+					VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+					1,
+					&queueBufferInfo,
+					nullptr),
+			};
+			vkUpdateDescriptorSets(m_DeviceVk,
+				static_cast<uint32_t>(wavefrontDescWrites.size()),
+				wavefrontDescWrites.data(),
+				0,
+				nullptr);
+		}
 	}
 }
 
 void Engine::CreateDescriptorSetLayout()
 {
-	VkDescriptorSetLayoutBinding layoutBinding =
-		initializers::DescriptorSetLayoutBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_ALL_GRAPHICS);
+	const VkShaderStageFlags rayTracingStage =
+		m_ComputeRayTracing ? VK_SHADER_STAGE_COMPUTE_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	std::vector<VkDescriptorSetLayoutBinding> layoutBindings{
+		initializers::DescriptorSetLayoutBinding(0,
+			VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC,
+			1,
+			VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT),
+		// accumulation images, and the history images of their samples
+		initializers::DescriptorSetLayoutBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, rayTracingStage),
+		initializers::DescriptorSetLayoutBinding(
+			s_HistoryImagesBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, rayTracingStage),
+	};
+	// output image of the compute ray tracer
+	if (m_ComputeRayTracing)
+	{
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			2, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+	}
+	// scene buffers (materials, spheres, planes, BVH nodes, primitive refs, vertices, triangles)
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_SceneBuffers.size()); ++i)
+	{
+		layoutBindings.push_back(
+			initializers::DescriptorSetLayoutBinding(3 + i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, rayTracingStage));
+	}
+	// upscaled image, written by `upscale.comp` which shares the layout with the ray tracer, and the
+	// images of `denoise.comp` (first hit features and the ping-pong images of its iterations)
+	if (m_ComputeRayTracing)
+	{
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_UpscaledImageBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_AlbedoImageBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_NormalDepthImageBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_DenoiseImagesBinding, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2, VK_SHADER_STAGE_COMPUTE_BIT));
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_AdaptivePixelsBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+	}
+	// path states and queues of `wavefront.comp`
+	if (m_Wavefront)
+	{
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_WavefrontPathsBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+		layoutBindings.push_back(initializers::DescriptorSetLayoutBinding(
+			s_WavefrontQueuesBinding, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT));
+	}
 
-	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo =
-		initializers::DescriptorSetLayoutCreateInfo(1, &layoutBinding);
+	VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo = initializers::DescriptorSetLayoutCreateInfo(
+		static_cast<uint32_t>(layoutBindings.size()), layoutBindings.data());
 	THROW(vkCreateDescriptorSetLayout(m_DeviceVk, &descriptorSetLayoutInfo, nullptr, &m_DescriptorSetLayout)
 			  != VK_SUCCESS,
 		"Failed to create descriptor set layout!")
@@ -729,23 +2423,194 @@ void Engine::CreateDescriptorSets()
 
 	for (uint64_t i = 0; i < Config::maxFramesInFlight; ++i)
 	{
-		VkDescriptorBufferInfo bufferInfo =
-			initializers::DescriptorBufferInfo(m_UniformBuffers[i], 0, sizeof(UniformBufferObject));
+		// the offset into the ring buffer is given when the set is bound
+		VkDescriptorBufferInfo bufferInfo = initializers::DescriptorBufferInfo(
+			m_UniformRingBuffer->GetBuffer(), 0, sizeof(UniformBufferObject));
 		VkWriteDescriptorSet descWrites = initializers::WriteDescriptorSet(
-			m_DescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, &bufferInfo, nullptr);
+			m_DescriptorSets[i], 0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, &bufferInfo, nullptr);
 		vkUpdateDescriptorSets(m_DeviceVk, 1, &descWrites, 0, nullptr);
+
+		for (uint32_t j = 0; j < static_cast<uint32_t>(m_SceneBuffers.size()); ++j)
+		{
+			VkDescriptorBufferInfo sceneBufferInfo =
+				initializers::DescriptorBufferInfo(m_SceneBuffers[j], 0, VK_WHOLE_SIZE);
+			VkWriteDescriptorSet sceneDescWrites = initializers::WriteDescriptorSet(
+				m_DescriptorSets[i], 3 + j, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, &sceneBufferInfo, nullptr);
+			vkUpdateDescriptorSets(m_DeviceVk, 1, &sceneDescWrites, 0, nullptr);
+		}
 	}
+
+	WriteStorageImageDescriptors();
 }
 
 void Engine::CreatePipelineLayout()
 {
+	// the tiles traced by a dispatch of `raytracing.comp` (and `adaptive.comp`), the tiles and bounce of a stage of
+	// `wavefront.comp`, or the iteration of `denoise.comp`
+	VkPushConstantRange pushConstantRange{ VK_SHADER_STAGE_COMPUTE_BIT,
+		0,
+		static_cast<uint32_t>(std::max({ sizeof(TraceTiles), sizeof(WavefrontPass), sizeof(DenoiseIteration) })) };
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo =
-		initializers::PipelineLayoutCreateInfo(1, &m_DescriptorSetLayout, 0, nullptr);
+		initializers::PipelineLayoutCreateInfo(1, &m_DescriptorSetLayout, 1, &pushConstantRange);
 	THROW(vkCreatePipelineLayout(m_DeviceVk, &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS,
 		"Failed to create pipeline layout!")
 }
 
-void Engine::CreatePipeline(const char* vertShaderPath, const char* fragShaderPath)
+void Engine::CreatePipelines()
+{
+	// headless mode waits for the ray tracing pipeline, it never draws the placeholder
+	if (!m_Headless)
+	{
+		m_PlaceholderPipeline = m_ComputeRayTracing
+			? CreateComputePipeline("assets/shaders/out/placeholder.comp.spv")
+			: CreatePipeline(
+				"assets/shaders/out/raytracing.vert.spv", "assets/shaders/out/placeholder.frag.spv", false);
+		m_Pipeline = m_PlaceholderPipeline;
+	}
+	// cheap to build, and not hot reloaded
+	if (m_ComputeRayTracing)
+	{
+		m_UpscalePipeline = CreateComputePipeline("assets/shaders/out/upscale.comp.spv");
+		m_DenoisePipeline = CreateComputePipeline("assets/shaders/out/denoise.comp.spv");
+		m_AdaptivePipeline = CreateComputePipeline("assets/shaders/out/adaptive.comp.spv");
+	}
+	// one pipeline per stage, the stage is the specialization constant of the shader
+	if (m_Wavefront)
+	{
+		const VkSpecializationMapEntry stageEntry{ 0, 0, sizeof(uint32_t) };
+		for (uint32_t stage = 0; stage < s_WavefrontStageCount; ++stage)
+		{
+			VkSpecializationInfo specializationInfo{ 1, &stageEntry, sizeof(stage), &stage };
+			m_WavefrontPipelines[stage] =
+				CreateComputePipeline("assets/shaders/out/wavefront.comp.spv", &specializationInfo);
+		}
+	}
+
+	// the shaders built by CMake are used until a source changes
+	const std::vector<std::string> sources = GetShaderSources();
+	std::vector<std::string> shaderPaths;
+	for (const std::string& source : sources)
+		shaderPaths.push_back("assets/shaders/out/" + source + ".spv");
+	BuildPipelineAsync(std::move(shaderPaths));
+
+	if (!m_Headless)
+	{
+		m_ShaderHotReloader = std::make_unique<ShaderHotReloader>("assets/shaders", "assets/shaders/out/cache");
+		m_ShaderHotReloader->Watch(sources, false);
+	}
+}
+
+std::vector<std::string> Engine::GetShaderSources() const
+{
+	if (m_ComputeRayTracing)
+		return { "raytracing.comp" };
+
+	const FragmentProgram& program = s_FragmentPrograms[static_cast<size_t>(m_FragmentProgramIndex)];
+	return { program.vertexShader, program.fragmentShader };
+}
+
+void Engine::BuildPipelineAsync(std::vector<std::string> shaderPaths)
+{
+	// the first build happens while the placeholder is drawn, the pipeline cache only matters for it
+	const bool isReload = m_Pipeline != VK_NULL_HANDLE && m_Pipeline != m_PlaceholderPipeline;
+
+	// the pipeline is built against the multisampled pass, which is created the first time it's needed
+	m_PendingProgramIndex = m_FragmentProgramIndex;
+	const bool rasterizesGeometry =
+		!m_ComputeRayTracing && s_FragmentPrograms[static_cast<size_t>(m_PendingProgramIndex)].rasterizesGeometry;
+	if (rasterizesGeometry && m_GeometryRenderPass == VK_NULL_HANDLE)
+	{
+		CreateGeometryRenderPasses();
+		CreateGeometryResources();
+	}
+
+	m_PipelineFuture = std::async(
+		std::launch::async, [this, shaderPaths = std::move(shaderPaths), isReload, rasterizesGeometry]() {
+			PROFILE_SCOPE("Engine::BuildPipelineAsync");
+			const auto startTime = std::chrono::high_resolution_clock::now();
+			VkPipeline pipeline = m_ComputeRayTracing
+				? CreateComputePipeline(shaderPaths[0].c_str())
+				: CreatePipeline(shaderPaths[0].c_str(), shaderPaths[1].c_str(), rasterizesGeometry);
+
+			const float elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+									  .count();
+			if (isReload)
+				Logger::Info("Pipeline rebuilt with the reloaded shaders in {:.2f} ms", elapsed);
+			else
+				Logger::Info("Ray tracing pipeline built in {:.2f} ms ({} start)",
+					elapsed,
+					m_PipelineCache->IsWarm() ? "warm" : "cold");
+			return pipeline;
+		});
+}
+
+void Engine::UpdatePipeline(bool wait)
+{
+	if (!m_PipelineFuture.valid())
+		return;
+	if (!wait && m_PipelineFuture.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+		return;
+
+	const bool isReload = m_Pipeline != VK_NULL_HANDLE && m_Pipeline != m_PlaceholderPipeline;
+	// the placeholder is also drawn until the scene has been uploaded
+	if (!isReload)
+	{
+		if (wait)
+			m_UploadManager->Wait(m_SceneUploadTicket);
+		else if (!m_UploadManager->IsComplete(m_SceneUploadTicket))
+			return;
+	}
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	try
+	{
+		pipeline = m_PipelineFuture.get();
+	}
+	catch (const std::exception&)
+	{
+		// a shader that doesn't match the pipeline layout keeps the previous pipeline (the error is logged)
+		if (!isReload)
+			throw;
+		return;
+	}
+
+	if (!isReload)
+	{
+		Logger::Info("Ray tracing pipeline in use {:.2f} ms after startup",
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - m_InitStartTime)
+				.count());
+	}
+	else
+	{
+		// the frames in flight might still use the previous pipeline, it's destroyed once they're done
+		m_RetiredPipelines.emplace_back(m_Pipeline, m_FrameNumber);
+	}
+	// the accumulated samples were rendered by the previous shaders (the placeholder doesn't write a history)
+	ResetAccumulation();
+	// the placeholder is kept until `Cleanup()`, the frames in flight might still use it
+	m_Pipeline = pipeline;
+	m_PipelineProgramIndex = m_PendingProgramIndex;
+}
+
+void Engine::DestroyRetiredPipelines(bool all)
+{
+	// the second element is the timeline value of the last frame that might use the pipeline
+	const uint64_t completedValue = all ? 0 : GetCompletedFrameValue();
+	auto isUnused = [completedValue, all](const std::pair<VkPipeline, uint64_t>& retired) {
+		return all || completedValue >= retired.second;
+	};
+	for (const auto& retired : m_RetiredPipelines)
+	{
+		if (isUnused(retired))
+			vkDestroyPipeline(m_DeviceVk, retired.first, nullptr);
+	}
+	m_RetiredPipelines.erase(std::remove_if(m_RetiredPipelines.begin(), m_RetiredPipelines.end(), isUnused),
+		m_RetiredPipelines.end());
+}
+
+VkPipeline Engine::CreatePipeline(const char* vertShaderPath, const char* fragShaderPath, bool rasterizesGeometry)
 {
 	// shader stages
 	Shader vertexShader{ m_DeviceVk, vertShaderPath, ShaderType::VERTEX };
@@ -761,8 +2626,10 @@ void Engine::CreatePipeline(const char* vertShaderPath, const char* fragShaderPa
 	VkPipelineViewportStateCreateInfo viewportStateInfo = initializers::PipelineViewportStateCreateInfo(1, 1);
 	VkPipelineRasterizationStateCreateInfo rasterizationStateInfo =
 		initializers::PipelineRasterizationStateCreateInfo(VK_CULL_MODE_NONE, VK_FRONT_FACE_COUNTER_CLOCKWISE);
-	VkPipelineMultisampleStateCreateInfo multisampleStateInfo =
-		initializers::PipelineMultisampleStateCreateInfo(VK_TRUE, m_MsaaSamples, 0.2f);
+	// the fullscreen programs write every pixel once, so they need neither multisampling nor a depth test
+	// (the ray tracer anti-aliases by jittering the rays within the pixels)
+	VkPipelineMultisampleStateCreateInfo multisampleStateInfo = initializers::PipelineMultisampleStateCreateInfo(
+		VK_FALSE, rasterizesGeometry ? m_MsaaSamples : VK_SAMPLE_COUNT_1_BIT, 0.0f);
 	VkPipelineDepthStencilStateCreateInfo depthStencilStateInfo =
 		initializers::PipelineDepthStencilStateCreateInfo(VK_TRUE, VK_TRUE);
 
@@ -789,18 +2656,41 @@ void Engine::CreatePipeline(const char* vertShaderPath, const char* fragShaderPa
 	graphicsPipelineInfo.pViewportState = &viewportStateInfo;
 	graphicsPipelineInfo.pRasterizationState = &rasterizationStateInfo;
 	graphicsPipelineInfo.pMultisampleState = &multisampleStateInfo;
-	graphicsPipelineInfo.pDepthStencilState = &depthStencilStateInfo;
+	graphicsPipelineInfo.pDepthStencilState = rasterizesGeometry ? &depthStencilStateInfo : nullptr;
 	graphicsPipelineInfo.pColorBlendState = &colorBlendStateInfo;
 	graphicsPipelineInfo.pDynamicState = &dynamicStateInfo;
 	graphicsPipelineInfo.layout = m_PipelineLayout;
-	graphicsPipelineInfo.renderPass = m_RenderPass;
+	graphicsPipelineInfo.renderPass = rasterizesGeometry ? m_GeometryRenderPass : m_RenderPass;
 	graphicsPipelineInfo.subpass = 0; // index of subpass
 	graphicsPipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	graphicsPipelineInfo.basePipelineIndex = -1;
 
-	THROW(vkCreateGraphicsPipelines(m_DeviceVk, VK_NULL_HANDLE, 1, &graphicsPipelineInfo, nullptr, &m_Pipeline)
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	THROW(vkCreateGraphicsPipelines(
+			  m_DeviceVk, m_PipelineCache->GetHandle(), 1, &graphicsPipelineInfo, nullptr, &pipeline)
 			  != VK_SUCCESS,
 		"Failed to create graphics pipeline!");
+	return pipeline;
+}
+
+VkPipeline Engine::CreateComputePipeline(const char* compShaderPath, const VkSpecializationInfo* specializationInfo)
+{
+	Shader computeShader{ m_DeviceVk, compShaderPath, ShaderType::COMPUTE };
+
+	VkComputePipelineCreateInfo computePipelineInfo{};
+	computePipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	computePipelineInfo.stage = computeShader.GetShaderStage();
+	computePipelineInfo.stage.pSpecializationInfo = specializationInfo;
+	computePipelineInfo.layout = m_PipelineLayout;
+	computePipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	computePipelineInfo.basePipelineIndex = -1;
+
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	THROW(vkCreateComputePipelines(
+			  m_DeviceVk, m_PipelineCache->GetHandle(), 1, &computePipelineInfo, nullptr, &pipeline)
+			  != VK_SUCCESS,
+		"Failed to create compute pipeline!");
+	return pipeline;
 }
 
 void Engine::CreateCommandBuffers()
@@ -816,24 +2706,121 @@ void Engine::CreateSyncObjects()
 {
 	m_ImageAvailableSemaphores.resize(Config::maxFramesInFlight);
 	m_RenderFinishedSemaphores.resize(Config::maxFramesInFlight);
-	m_InFlightFences.resize(Config::maxFramesInFlight);
+	// the first frame of every slot doesn't have to wait (the timeline starts at 0)
+	m_FrameTimelineValues.assign(Config::maxFramesInFlight, 0);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-	// create the fence in signaled state so that the first frame doesnt have to wait
-	VkFenceCreateInfo fenceInfo{};
-	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
 	for (uint32_t i = 0; i < Config::maxFramesInFlight; ++i)
 	{
 		THROW(
 			vkCreateSemaphore(m_DeviceVk, &semaphoreInfo, nullptr, &m_ImageAvailableSemaphores[i]) != VK_SUCCESS
-				|| vkCreateSemaphore(m_DeviceVk, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS
-				|| vkCreateFence(m_DeviceVk, &fenceInfo, nullptr, &m_InFlightFences[i]) != VK_SUCCESS,
+				|| vkCreateSemaphore(m_DeviceVk, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphores[i]) != VK_SUCCESS,
 			"Failed to create synchronization objects!")
 	}
+
+	VkSemaphoreTypeCreateInfo semaphoreTypeInfo{};
+	semaphoreTypeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	semaphoreTypeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	semaphoreTypeInfo.initialValue = 0;
+	semaphoreInfo.pNext = &semaphoreTypeInfo;
+	THROW(vkCreateSemaphore(m_DeviceVk, &semaphoreInfo, nullptr, &m_FrameTimeline) != VK_SUCCESS,
+		"Failed to create the frame timeline semaphore!")
+}
+
+void Engine::WaitForFrame(uint64_t value)
+{
+	VkSemaphoreWaitInfo waitInfo{};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &m_FrameTimeline;
+	waitInfo.pValues = &value;
+	THROW(vkWaitSemaphores(m_DeviceVk, &waitInfo, UINT64_MAX) != VK_SUCCESS, "Failed to wait for a frame!")
+}
+
+uint64_t Engine::GetCompletedFrameValue() const
+{
+	uint64_t value = 0;
+	THROW(vkGetSemaphoreCounterValue(m_DeviceVk, m_FrameTimeline, &value) != VK_SUCCESS,
+		"Failed to get the frame timeline value!")
+	return value;
+}
+
+void Engine::UpdateLatency()
+{
+	// the completion is seen when the next frame waits for its slot, which is when the device finishes
+	// the frame if the queue is full (otherwise the latency is an upper bound)
+	const uint64_t completedValue = GetCompletedFrameValue();
+	const auto now = std::chrono::high_resolution_clock::now();
+	while (!m_PendingFrames.empty() && m_PendingFrames.front().first <= completedValue)
+	{
+		m_LatencyHistory.push_back(
+			std::chrono::duration<float, std::chrono::milliseconds::period>(now - m_PendingFrames.front().second)
+				.count());
+		if (m_LatencyHistory.size() > s_LatencyHistorySize)
+			m_LatencyHistory.pop_front();
+		m_PendingFrames.pop_front();
+	}
+}
+
+void Engine::UpdateTracedPixelCounts()
+{
+	const uint64_t completedValue = GetCompletedFrameValue();
+	while (!m_PendingPixelCounts.empty() && m_PendingPixelCounts.front().timelineValue <= completedValue)
+	{
+		const PendingPixelCount& pending = m_PendingPixelCounts.front();
+		// the slot isn't reused before its frame has finished, so its element still holds the count of the frame
+		const uint64_t pixelCount = pending.isReadBack
+			? static_cast<const uint32_t*>(m_TracedPixelReadbackBufferAllocation.mappedData)[pending.frameIndex]
+			: pending.pixelCount;
+		// the timeline value of a frame is its frame number + 1
+		m_TracedPixelCounts.resize(std::max<size_t>(m_TracedPixelCounts.size(), pending.timelineValue), 0);
+		m_TracedPixelCounts[pending.timelineValue - 1] = pixelCount;
+		m_PendingPixelCounts.pop_front();
+	}
+}
+
+void Engine::ApplyFrameSettings()
+{
+	if (m_RequestedFramesInFlight == m_FramesInFlight && m_RequestedPresentMode == m_PresentMode)
+		return;
+
+	// the frame slots are renumbered, so all the frames in flight have to be finished
+	vkDeviceWaitIdle(m_DeviceVk);
+	UpdateLatency();
+	UpdateTracedPixelCounts();
+	m_FramesInFlight = m_RequestedFramesInFlight;
+	m_CurrentFrameIndex = 0;
+	if (m_RequestedPresentMode != m_PresentMode)
+	{
+		m_PresentMode = m_RequestedPresentMode;
+		RecreateSwapchain();
+	}
+	Logger::Info("{} frame(s) in flight, {} present mode",
+		m_FramesInFlight,
+		m_Headless ? "no" : GetPresentModeName(m_SwapchainPresentMode));
+}
+
+void Engine::CreateGpuProfiler()
+{
+	// the frames are recorded in command buffers of the graphics queue family
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_PhysicalDevice, &queueFamilyCount, queueFamilies.data());
+
+	m_GpuProfiler = std::make_unique<GpuProfiler>(m_DeviceVk,
+		m_PhysicalDeviceProperties.limits.timestampPeriod,
+		queueFamilies[m_QueueFamilyIndices.graphicsFamily.value()].timestampValidBits,
+		Config::maxFramesInFlight);
+
+	// the time slices are sized by the measured GPU time of the previous ones
+	if (!m_GpuProfiler->IsSupported() && m_TileScheduler->IsEnabled())
+	{
+		Logger::Warn("The trace budget needs timestamps, the whole image is traced every frame");
+		m_TileScheduler->SetBudget(0.0f);
+	}
 }
 
 
@@ -864,6 +2851,10 @@ void Engine::OnKeyEvent(int key, int scancode, int action, int mods)
 	if (Input::IsKeyPressed(Key::LEFT_CONTROL) && Input::IsKeyPressed(Key::Q))
 		m_IsRunning = false;
 
+	// captures the CPU scopes of the last seconds, e.g. right after a hitch
+	if (key == static_cast<int>(Key::F12) && action == GLFW_PRESS)
+		Profiler::ExportChromeTrace("cpu_trace.json");
+
 	ImGuiIO& io = ImGui::GetIO();
 	if (io.WantCaptureKeyboard)
 		return;
@@ -1,12 +1,84 @@
 #pragma once
 
 #include <cstdint>
+#include <deque>
 #include <memory>
 #include <chrono>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
 #include <vulkan/vulkan.h>
 #include "core/window.h"
 #include "engine/types.h"
 #include "engine/camera.h"
+#include "engine/gpuProfiler.h"
+#include "engine/scene.h"
+#include "engine/memoryAllocator.h"
+#include "engine/pipelineCache.h"
+#include "engine/resolutionScaler.h"
+#include "engine/shaderHotReloader.h"
+#include "engine/tileScheduler.h"
+#include "engine/uploadManager.h"
+#include "engine/uniformRingBuffer.h"
+
+struct EngineProps
+{
+public:
+	const char* title;
+	uint64_t width;
+	uint64_t height;
+
+	// headless mode renders into an offscreen image instead of a window/swapchain
+	bool headless = false;
+	uint32_t frameCount = 1; // number of frames rendered in headless mode
+	std::string outputPath = "output.ppm"; // the last headless frame is written here (nothing is written if empty)
+	// called before every headless frame, e.g. to move the camera along a path
+	std::function<void(uint32_t frameIndex, Camera& camera)> onHeadlessFrame;
+
+	// number of frames recorded while the device works on the previous ones (1 to `Config::maxFramesInFlight`)
+	uint32_t framesInFlight = 2;
+	// used if the surface supports it, FIFO otherwise
+	VkPresentModeKHR presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+	// trace rays in a compute shader instead of a fullscreen fragment pass
+	bool computeRayTracing = true;
+	// resolution of the ray traced image relative to the window (compute path only), upscaled to the window
+	float renderScale = 1.0f;
+	// in ms, the render scale adapts to it (starting at `renderScale`), 0 keeps the render scale fixed
+	float targetFrameTime = 0.0f;
+	// in ms, GPU time of the ray tracing per frame (compute path, not in headless mode), an image that takes longer
+	// is traced in tiles over several frames, 0 traces the whole image every frame
+	float traceBudget = 0.0f;
+	// iterations of the a-trous denoiser (compute path), up to `Engine::s_MaxDenoiseIterations`, 0 disables it
+	uint32_t denoiseIterations = 0;
+	// reproject the accumulated samples when the camera moves, the accumulation restarts instead if false
+	bool reprojection = true;
+	// bounces of the ray traced paths, up to `Engine::s_MaxBounces` (most paths end earlier, russian roulette)
+	uint32_t maxBounces = 64;
+	// adaptive sampling (compute path): a pixel is no longer sampled once the standard error of its displayed
+	// luminance is below it, 0 samples every pixel every frame
+	float noiseThreshold = 0.0f;
+	// trace the paths (compute path) in stages, with one kernel per material, instead of one shader per pixel
+	bool wavefront = false;
+	// program of the fragment path, named after its fragment shader (e.g. "random"), the ray tracer if empty
+	std::string fragmentProgram;
+	// `ubo.time` of every frame in seconds (instead of the elapsed time), so the frames are deterministic
+	std::optional<float> fixedTime;
+
+	uint32_t sphereCount = 0; // number of random spheres added to the default scene
+	std::string meshPath; // optional .obj mesh added to the default scene
+
+	// the CPU scopes are exported here (Chrome trace) when the engine is destroyed, nothing is exported if empty
+	std::string tracePath;
+
+public:
+	explicit EngineProps(const char* title, const uint64_t width = 1280, const uint64_t height = 720)
+		: title{ title },
+		  width{ width },
+		  height{ height }
+	{}
+};
 
 class Engine
 {
@@ -15,24 +87,52 @@ public:
 	Engine& operator=(const Engine&) = delete;
 	~Engine();
 
-	[[nodiscard]] static Engine* Create(const char* title, const uint64_t width = 1280, const uint64_t height = 720);
+	[[nodiscard]] static Engine* Create(const EngineProps& props);
 	[[nodiscard]] static inline Engine* GetInstance() { return s_Instance; }
 	[[nodiscard]] static inline GLFWwindow* GetWindowHandle() { return s_Instance->m_Window->GetWindowHandle(); }
 	[[nodiscard]] static inline VkPhysicalDevice GetPhysicalDevice() { return s_Instance->m_PhysicalDevice; }
 
 	void Run();
 
+	// pixels traced by every frame (headless mode), by frame number, adaptive sampling skips the converged ones
+	// and the placeholder traces none, complete once `Run()` has returned
+	[[nodiscard]] inline const std::vector<uint64_t>& GetTracedPixelCounts() const { return m_TracedPixelCounts; }
+
 private:
-	explicit Engine(const char* title, const uint64_t width = 1280, const uint64_t height = 720);
+	explicit Engine(const EngineProps& props);
 
-	void Init(const char* title, const uint64_t width, const uint64_t height);
+	void Init(const EngineProps& props);
 	void Cleanup();
+	void RunHeadless();
 	void Draw(float deltatime);
 	void BeginScene();
+	void BeginRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer);
+	// picks the extent of the ray traced image for the frame, from the time of the last finished frame
+	void UpdateRenderExtent(float deltatime);
+	// @returns true if the last tiles of the accumulation pass have been traced
+	[[nodiscard]] bool DispatchRayTracing();
+	// lists the pixels of the slice that are still noisy, the ray tracer is then dispatched indirectly over them
+	void DispatchAdaptiveSampling(const TileScheduler::Slice& slice);
+	/**
+	 * traces the slice with the stages of `wavefront.comp`, the push constants of the tiles have to be pushed
+	 * @param isAdaptive generates the paths of the pixels listed by `DispatchAdaptiveSampling()`
+	 */
+	void DispatchWavefront(const TileScheduler::Slice& slice, bool isAdaptive);
+	// filters the accumulated image into the output image, guided by the first hit features
+	void DispatchDenoiser();
+	// restarts the progressive accumulation (and the time sliced pass)
+	void ResetAccumulation();
 	void EndScene();
 	void OnUiRender();
+	// switches to the frames in flight and present mode selected in the ui
+	void ApplyFrameSettings();
 	float CalcFps();
 
+	[[nodiscard]] inline VkSurfaceKHR GetWindowSurface() const
+	{
+		return m_Headless ? VK_NULL_HANDLE : m_Window->GetWindowSurface();
+	}
+
 	void CreateVulkanInstance(const char* title);
 	void SetupDebugMessenger();
 
@@ -48,23 +148,61 @@ private:
 	void RecreateSwapchain();
 	void CleanupSwapchain();
 
+	// headless mode
+	void CreateOffscreenTarget(const uint64_t width, const uint64_t height);
+	void SaveOffscreenTarget(const std::string& path);
+
 	void CreateRenderPass();
+	void CreateFramebuffers();
+	// multisampled pass with a depth buffer for the programs that rasterize geometry, and the pass of its ui
+	void CreateGeometryRenderPasses();
+	// multisampled color and depth images, and their framebuffers
+	void CreateGeometryResources();
 	void CreateColorResource();
 	void CreateDepthResource();
-	void CreateFramebuffers();
 
 	void CreateUniformBuffers();
 	void UpdateUniformBuffers();
+	void CreateSceneBuffers();
+
+	// accumulation images (and the output image of the compute ray tracer)
+	void CreateStorageImages();
+	void CleanupStorageImages();
+	void WriteStorageImageDescriptors();
 
 	void CreateDescriptorSetLayout();
 	void CreateDescriptorSets();
 	void CreatePipelineLayout();
 
-	void CreatePipeline(const char* vertShaderPath, const char* fragShaderPath);
+	// creates the placeholder pipeline and starts building the ray tracing pipeline on a worker thread
+	void CreatePipelines();
+	// file names of the shader stages of the ray tracing pipeline (in `assets/shaders`)
+	[[nodiscard]] std::vector<std::string> GetShaderSources() const;
+	// @param shaderPaths SPIR-V of the stages, in the order of `GetShaderSources()`
+	void BuildPipelineAsync(std::vector<std::string> shaderPaths);
+	// switches to the pipeline built by `BuildPipelineAsync()` once it's ready
+	void UpdatePipeline(bool wait);
+	// @param all destroy all of them, instead of only the ones the frames in flight no longer use
+	void DestroyRetiredPipelines(bool all);
+	// @param rasterizesGeometry builds the pipeline for the multisampled pass instead of the fullscreen pass
+	[[nodiscard]] VkPipeline CreatePipeline(const char* vertShaderPath,
+		const char* fragShaderPath,
+		bool rasterizesGeometry);
+	// @param specializationInfo constants of the shader, none if null
+	[[nodiscard]] VkPipeline CreateComputePipeline(const char* compShaderPath,
+		const VkSpecializationInfo* specializationInfo = nullptr);
 
 	void CreateCommandBuffers();
 
 	void CreateSyncObjects();
+	// @param value timeline value of the frame (its frame number + 1)
+	void WaitForFrame(uint64_t value);
+	[[nodiscard]] uint64_t GetCompletedFrameValue() const;
+	// latency of the frames the device has finished since the last call
+	void UpdateLatency();
+	// collects the pixels traced by the frames the device has finished (headless mode)
+	void UpdateTracedPixelCounts();
+	void CreateGpuProfiler();
 
 
 	// event callbacks
@@ -78,6 +216,50 @@ private:
 	static Engine* s_Instance;
 	std::unique_ptr<Window> m_Window;
 
+	bool m_Headless = false;
+	uint32_t m_HeadlessFrameCount = 1;
+	std::string m_OutputPath;
+	std::function<void(uint32_t frameIndex, Camera& camera)> m_OnHeadlessFrame;
+	std::optional<float> m_FixedTime;
+
+	bool m_ComputeRayTracing = true;
+	uint32_t m_RandomSphereCount = 0;
+	std::string m_MeshPath;
+	std::string m_TracePath;
+	// the fullscreen passes draw a single triangle covering the viewport
+	static constexpr uint32_t s_FullscreenVertexCount = 3;
+	// work group size of `raytracing.comp`, `upscale.comp` and `denoise.comp`
+	static constexpr uint32_t s_ComputeTileSize = 8;
+	// binding of the upscaled image in `upscale.comp`, after the scene buffers
+	static constexpr uint32_t s_UpscaledImageBinding = 10;
+	// bindings of the first hit features (albedo, normal and depth) and the ping-pong images of `denoise.comp`
+	static constexpr uint32_t s_AlbedoImageBinding = 11;
+	static constexpr uint32_t s_NormalDepthImageBinding = 12;
+	static constexpr uint32_t s_DenoiseImagesBinding = 13;
+	// binding of the history images (both paths)
+	static constexpr uint32_t s_HistoryImagesBinding = 14;
+	// the taps of the last iteration are 16 pixels apart, so the filter covers 65x65 pixels
+	static constexpr uint32_t s_MaxDenoiseIterations = 5;
+	// `MAX_BOUNCES` in `raytracing.glsl`
+	static constexpr uint32_t s_MaxBounces = 64;
+	// binding of the list of pixels of `adaptive.comp` that are still sampled (and the indirect dispatch)
+	static constexpr uint32_t s_AdaptivePixelsBinding = 15;
+	// bindings of the path states and the queues of `wavefront.comp`
+	static constexpr uint32_t s_WavefrontPathsBinding = 16;
+	static constexpr uint32_t s_WavefrontQueuesBinding = 17;
+	// `STAGE_*` in `wavefront.comp`: ray generation, intersection, the 3 materials and the miss
+	static constexpr uint32_t s_WavefrontStageCount = 6;
+	// `QUEUE_COUNT` (the rays, one per material and the misses) per bounce, and `QUEUE_RANGES` of entries
+	static constexpr uint32_t s_WavefrontQueueCount = 5;
+	static constexpr uint32_t s_WavefrontQueueRanges = 6;
+	// `sizeof(PathState)` in `wavefront.comp`, and its work group size
+	static constexpr VkDeviceSize s_WavefrontPathSize = 64;
+	static constexpr uint32_t s_WavefrontGroupSize = 64;
+	// uniform data every frame can push into the ring buffer (per-frame and per-pass data)
+	static constexpr VkDeviceSize s_UniformFrameSize = 16 * 1024;
+	// staging ring buffer of the upload manager, larger uploads get their own staging buffer
+	static constexpr VkDeviceSize s_UploadStagingSize = 32 * 1024 * 1024;
+
 	VkInstance m_VulkanInstance;
 	VkDebugUtilsMessengerEXT m_DebugMessenger;
 
@@ -87,37 +269,139 @@ private:
 	VkDevice m_DeviceVk;
 	VkPhysicalDeviceProperties m_PhysicalDeviceProperties;
 
+	// all the buffers and images are allocated from it
+	std::unique_ptr<MemoryAllocator> m_Allocator;
+	std::unique_ptr<UploadManager> m_UploadManager;
+
 	VkQueue m_GraphicsQueue;
 	VkQueue m_PresentQueue;
+	VkQueue m_TransferQueue; // the graphics queue if there is no dedicated transfer queue
 
-	VkSampleCountFlagBits m_MsaaSamples;
+	VkSampleCountFlagBits m_MsaaSamples; // of the passes that rasterize geometry
 
 	VkCommandPool m_CommandPool;
 	VkDescriptorPool m_DescriptorPool;
 
 	VkSwapchainKHR m_Swapchain;
+	VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_MAILBOX_KHR; // requested, the swapchain falls back to FIFO
+	VkPresentModeKHR m_SwapchainPresentMode = VK_PRESENT_MODE_FIFO_KHR;
 	std::vector<VkImage> m_SwapchainImages;
 	VkFormat m_SwapchainImageFormat;
 	VkExtent2D m_SwapchainExtent;
+	// extent of the ray traced image, smaller than the swapchain extent with dynamic resolution
+	VkExtent2D m_RenderExtent{};
+	std::unique_ptr<ResolutionScaler> m_ResolutionScaler;
+	std::unique_ptr<TileScheduler> m_TileScheduler;
+	// per frame slot, the number of tiles traced by the last frame recorded into it (0 for the placeholder)
+	std::vector<uint32_t> m_TracedTileCounts;
 	std::vector<VkImageView> m_SwapchainImageViews;
 
+	// replaces the swapchain image in headless mode
+	VkImage m_OffscreenImage;
+	Allocation m_OffscreenImageAllocation;
+
+	// single sampled pass without a depth buffer, in the compute path it only draws the ui on top of the blitted image
 	VkRenderPass m_RenderPass;
+	std::vector<VkFramebuffer> m_SwapchainFramebuffers;
 
+	// only created once a program that rasterizes geometry is used (fragment path), the ui is drawn
+	// in the overlay pass after the multisampled image has been resolved
+	VkRenderPass m_GeometryRenderPass = VK_NULL_HANDLE;
+	VkRenderPass m_OverlayRenderPass = VK_NULL_HANDLE;
+	std::vector<VkFramebuffer> m_GeometryFramebuffers;
 	VkImage m_ColorImage;
-	VkDeviceMemory m_ColorImageMemory;
+	Allocation m_ColorImageAllocation;
 	VkImageView m_ColorImageView;
 	VkImage m_DepthImage;
-	VkDeviceMemory m_DepthImageMemory;
+	Allocation m_DepthImageAllocation;
 	VkImageView m_DepthImageView;
-	std::vector<VkFramebuffer> m_SwapchainFramebuffers;
 
 	VkDescriptorSetLayout m_DescriptorSetLayout;
 	VkPipelineLayout m_PipelineLayout;
 	std::vector<VkDescriptorSet> m_DescriptorSets;
-	std::vector<VkBuffer> m_UniformBuffers;
-	std::vector<VkDeviceMemory> m_UniformBufferMemory;
-
-	VkPipeline m_Pipeline;
+	// per-frame uniform data, bound with a dynamic offset
+	std::unique_ptr<UniformRingBuffer> m_UniformRingBuffer;
+	uint32_t m_UniformBufferOffset = 0; // dynamic offset of the `UniformBufferObject` of the current frame
+
+	// storage buffers with the materials and primitives of the scene, and its BVH
+	std::unique_ptr<Scene> m_Scene;
+	std::array<VkBuffer, 7> m_SceneBuffers;
+	std::array<Allocation, 7> m_SceneBufferAllocations;
+	UploadTicket m_SceneUploadTicket = 0;
+	bool m_SceneBuffersAcquired = false; // by the graphics queue family
+
+	std::unique_ptr<PipelineCache> m_PipelineCache;
+	VkPipeline m_Pipeline = VK_NULL_HANDLE; // bound pipeline, the placeholder until the ray tracing pipeline is built
+	VkPipeline m_PlaceholderPipeline = VK_NULL_HANDLE;
+	VkPipeline m_UpscalePipeline = VK_NULL_HANDLE; // compute path only
+	VkPipeline m_DenoisePipeline = VK_NULL_HANDLE; // compute path only
+	VkPipeline m_AdaptivePipeline = VK_NULL_HANDLE; // compute path only
+	std::array<VkPipeline, s_WavefrontStageCount> m_WavefrontPipelines{}; // wavefront mode only
+	std::future<VkPipeline> m_PipelineFuture;
+	// replaced pipelines and the frame number they were replaced in
+	std::vector<std::pair<VkPipeline, uint64_t>> m_RetiredPipelines;
+	std::unique_ptr<ShaderHotReloader> m_ShaderHotReloader;
+	int m_FragmentProgramIndex = 0; // selected shaders of the fragment path
+	int m_PendingProgramIndex = 0; // of the pipeline that is being built
+	int m_PipelineProgramIndex = 0; // of `m_Pipeline`, unless it's the placeholder
+	std::chrono::time_point<std::chrono::high_resolution_clock> m_InitStartTime;
+
+	// ping-pong images holding the running average of the ray traced samples
+	std::array<VkImage, 2> m_AccumulationImages;
+	std::array<Allocation, 2> m_AccumulationImageAllocations;
+	std::array<VkImageView, 2> m_AccumulationImageViews;
+	uint32_t m_AccumulationFrameIndex = 0; // number of passes accumulated since the last reset
+	// ping-pong images holding the sample count and the first hit of every pixel of the accumulation images
+	std::array<VkImage, 2> m_HistoryImages;
+	std::array<Allocation, 2> m_HistoryImageAllocations;
+	std::array<VkImageView, 2> m_HistoryImageViews;
+	// reproject the accumulated samples when the camera moves instead of restarting the accumulation
+	bool m_Reprojection = true;
+	uint32_t m_MaxBounces = s_MaxBounces; // of the ray traced paths
+	// view of the last completed pass, the accumulated samples are reprojected from it
+	glm::mat4 m_HistoryViewProj{ 1.0f };
+	glm::vec3 m_HistoryCameraPos{ 0.0f };
+
+	// written by the compute ray tracer and blitted to the swapchain image
+	VkImage m_OutputImage;
+	Allocation m_OutputImageAllocation;
+	VkImageView m_OutputImageView;
+	// the output image upscaled to the swapchain extent, blitted instead of it if the render extent is smaller
+	VkImage m_UpscaledImage;
+	Allocation m_UpscaledImageAllocation;
+	VkImageView m_UpscaledImageView;
+	// first hit features of the pixel centers, written by the ray tracer with the first sample after a reset
+	VkImage m_AlbedoImage;
+	Allocation m_AlbedoImageAllocation;
+	VkImageView m_AlbedoImageView;
+	VkImage m_NormalDepthImage;
+	Allocation m_NormalDepthImageAllocation;
+	VkImageView m_NormalDepthImageView;
+	// ping-pong images of the denoiser iterations, the last one writes to the output image
+	std::array<VkImage, 2> m_DenoiseImages;
+	std::array<Allocation, 2> m_DenoiseImageAllocations;
+	std::array<VkImageView, 2> m_DenoiseImageViews;
+	uint32_t m_DenoiseIterations = 0; // 0 if the denoiser is disabled
+	// last complete image (swapchain extent), blitted while the tiles of a time sliced pass are traced
+	VkImage m_PresentedImage;
+	Allocation m_PresentedImageAllocation;
+	bool m_HasPresentedImage = false;
+	// the indirect dispatch of the ray tracer (`VkDispatchIndirectCommand`), the number of pixels and the pixels
+	// that are still sampled (compute path, one per pixel of the swapchain extent)
+	VkBuffer m_AdaptivePixelBuffer;
+	Allocation m_AdaptivePixelBufferAllocation;
+	float m_NoiseThreshold = 0.0f; // 0 if adaptive sampling is disabled
+	// the number of listed pixels of the adaptive pixel buffer, copied for every frame slot (host visible)
+	VkBuffer m_TracedPixelReadbackBuffer;
+	Allocation m_TracedPixelReadbackBufferAllocation;
+	// trace with the stages of `wavefront.comp` instead of `m_Pipeline` (compute path)
+	bool m_Wavefront = false;
+	// the state of the path of every pixel, and the queue headers of every bounce followed by their entries
+	// (wavefront mode, one path and entry per queue range for every pixel of the swapchain extent)
+	VkBuffer m_WavefrontPathBuffer = VK_NULL_HANDLE;
+	Allocation m_WavefrontPathBufferAllocation;
+	VkBuffer m_WavefrontQueueBuffer = VK_NULL_HANDLE;
+	Allocation m_WavefrontQueueBufferAllocation;
 
 	std::vector<VkCommandBuffer> m_CommandBuffers;
 
@@ -126,13 +410,40 @@ private:
 	std::vector<VkSemaphore> m_ImageAvailableSemaphores;
 	// signaled when command buffers have finished execution
 	std::vector<VkSemaphore> m_RenderFinishedSemaphores;
-	std::vector<VkFence> m_InFlightFences;
+	// signaled with the frame number + 1 when the device has finished a frame
+	VkSemaphore m_FrameTimeline;
+	// per frame slot, the timeline value of the last frame recorded into it
+	std::vector<uint64_t> m_FrameTimelineValues;
+	uint32_t m_FramesInFlight = 2;
+	// selected in the ui, applied at the start of the next frame
+	uint32_t m_RequestedFramesInFlight = 2;
+	VkPresentModeKHR m_RequestedPresentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+
+	// submitted frames (timeline value, submit time) whose completion hasn't been seen yet
+	std::deque<std::pair<uint64_t, std::chrono::time_point<std::chrono::high_resolution_clock>>> m_PendingFrames;
+	// time from submitting a frame until the device has finished it (in ms), of the last frames
+	std::deque<float> m_LatencyHistory;
+	// submitted headless frames whose traced pixels haven't been collected, the adaptively sampled ones are read back
+	// from the frame slot's element of `m_TracedPixelReadbackBuffer`
+	struct PendingPixelCount
+	{
+		uint64_t timelineValue;
+		uint32_t frameIndex;
+		uint64_t pixelCount; // unless it's read back
+		bool isReadBack;
+	};
+	std::deque<PendingPixelCount> m_PendingPixelCounts;
+	std::vector<uint64_t> m_TracedPixelCounts;
+
+	// timestamps of the passes of every frame, shown in the Profiler window
+	std::unique_ptr<GpuProfiler> m_GpuProfiler;
 
 	std::unique_ptr<Camera> m_Camera;
 	// glm::vec3 m_CameraPos{ 0.0f, 0.0f, 3.0f };
 
 	VkCommandBuffer m_ActiveCommandBuffer;
 	uint32_t m_CurrentFrameIndex = 0;
+	uint64_t m_FrameNumber = 0; // number of frames drawn
 	uint32_t m_NextFrameIndex = 0; // acquired from swapchain
 	bool m_FramebufferResized = false;
 
@@ -0,0 +1,193 @@
+#include "engine/gpuProfiler.h"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include "core/core.h"
+
+
+GpuProfiler::GpuProfiler(VkDevice deviceVk, float timestampPeriod, uint32_t timestampValidBits, uint32_t frameCount)
+	: m_DeviceVk{ deviceVk },
+	  m_TimestampPeriod{ timestampPeriod },
+	  m_TimestampMask{ timestampValidBits >= 64 ? ~0ull : (1ull << timestampValidBits) - 1 },
+	  m_FrameScopes(frameCount)
+{
+	if (timestampValidBits == 0)
+	{
+		Logger::Warn("The graphics queue doesn't support timestamps, GPU profiling is disabled");
+		return;
+	}
+
+	VkQueryPoolCreateInfo queryPoolInfo{};
+	queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolInfo.queryCount = frameCount * s_MaxScopesPerFrame * 2;
+	THROW(vkCreateQueryPool(m_DeviceVk, &queryPoolInfo, nullptr, &m_QueryPool) != VK_SUCCESS,
+		"Failed to create timestamp query pool!")
+}
+
+GpuProfiler::~GpuProfiler()
+{
+	vkDestroyQueryPool(m_DeviceVk, m_QueryPool, nullptr);
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmdBuff, uint32_t frameIndex)
+{
+	if (!IsSupported())
+		return;
+
+	m_FrameIndex = frameIndex;
+	ReadResults(frameIndex);
+	m_FrameScopes[frameIndex].clear();
+	m_OpenScopes.clear();
+
+	vkCmdResetQueryPool(cmdBuff, m_QueryPool, frameIndex * s_MaxScopesPerFrame * 2, s_MaxScopesPerFrame * 2);
+}
+
+void GpuProfiler::BeginScope(VkCommandBuffer cmdBuff, const char* name)
+{
+	if (!IsSupported())
+		return;
+
+	std::vector<Scope>& scopes = m_FrameScopes[m_FrameIndex];
+	if (scopes.size() == s_MaxScopesPerFrame)
+	{
+		// keeps `EndScope()` balanced
+		m_OpenScopes.push_back(UINT32_MAX);
+		return;
+	}
+
+	Scope scope{};
+	scope.statisticsIndex = GetStatisticsIndex(name, static_cast<uint32_t>(m_OpenScopes.size()));
+	scope.beginQuery = (m_FrameIndex * s_MaxScopesPerFrame + static_cast<uint32_t>(scopes.size())) * 2;
+	vkCmdWriteTimestamp(cmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_QueryPool, scope.beginQuery);
+
+	m_OpenScopes.push_back(static_cast<uint32_t>(scopes.size()));
+	scopes.push_back(scope);
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer cmdBuff)
+{
+	if (!IsSupported())
+		return;
+
+	THROW(m_OpenScopes.empty(), "GPU profiler scope ended without being begun!")
+	const uint32_t scopeIndex = m_OpenScopes.back();
+	m_OpenScopes.pop_back();
+	if (scopeIndex == UINT32_MAX)
+		return;
+
+	const Scope& scope = m_FrameScopes[m_FrameIndex][scopeIndex];
+	vkCmdWriteTimestamp(cmdBuff, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_QueryPool, scope.beginQuery + 1);
+}
+
+void GpuProfiler::ReadPendingResults()
+{
+	if (!IsSupported())
+		return;
+
+	// oldest frame first, the current frame is the newest one
+	const auto frameCount = static_cast<uint32_t>(m_FrameScopes.size());
+	for (uint32_t i = 1; i <= frameCount; ++i)
+	{
+		const uint32_t frameIndex = (m_FrameIndex + i) % frameCount;
+		ReadResults(frameIndex);
+		m_FrameScopes[frameIndex].clear();
+	}
+}
+
+void GpuProfiler::ExportChromeTrace(const char* path) const
+{
+	std::ofstream file{ path };
+	THROW(!file.is_open(), "Error opening trace file: {}", path)
+
+	// the timestamps are relative to the first one, in microseconds
+	uint64_t originNs = UINT64_MAX;
+	for (const auto& events : m_TraceFrames)
+	{
+		for (const TraceEvent& event : events)
+			originNs = std::min(originNs, event.beginNs);
+	}
+
+	file << "{\"traceEvents\":[";
+	bool isFirst = true;
+	for (const auto& events : m_TraceFrames)
+	{
+		for (const TraceEvent& event : events)
+		{
+			// complete events ("X") with a duration, nested by their time ranges
+			file << (isFirst ? "" : ",") << "\n{\"name\":\"" << m_Statistics[event.statisticsIndex].name
+				 << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":"
+				 << static_cast<double>(event.beginNs - originNs) / 1000.0
+				 << ",\"dur\":" << static_cast<double>(event.endNs - event.beginNs) / 1000.0 << "}";
+			isFirst = false;
+		}
+	}
+	file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	Logger::Info("Exported the GPU timings of {} frame(s) to \"{}\"", m_TraceFrames.size(), path);
+}
+
+void GpuProfiler::ReadResults(uint32_t frameIndex)
+{
+	const std::vector<Scope>& scopes = m_FrameScopes[frameIndex];
+	if (scopes.empty())
+		return;
+
+	// the previous frame of the slot has been waited on, so all the queries are available
+	std::vector<uint64_t> timestamps(scopes.size() * 2);
+	const VkResult result = vkGetQueryPoolResults(m_DeviceVk,
+		m_QueryPool,
+		scopes.front().beginQuery,
+		static_cast<uint32_t>(timestamps.size()),
+		timestamps.size() * sizeof(uint64_t),
+		timestamps.data(),
+		sizeof(uint64_t),
+		VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS)
+		return;
+
+	std::vector<TraceEvent> events;
+	for (size_t i = 0; i < scopes.size(); ++i)
+	{
+		const uint64_t begin = timestamps[i * 2] & m_TimestampMask;
+		const uint64_t end = timestamps[i * 2 + 1] & m_TimestampMask;
+		// the counter can wrap around between the two timestamps
+		const uint64_t ticks = (end - begin) & m_TimestampMask;
+		const auto beginNs = static_cast<uint64_t>(static_cast<double>(begin) * m_TimestampPeriod);
+		const auto durationNs = static_cast<uint64_t>(static_cast<double>(ticks) * m_TimestampPeriod);
+		events.push_back({ scopes[i].statisticsIndex, beginNs, beginNs + durationNs });
+
+		std::deque<float>& history = m_History[scopes[i].statisticsIndex];
+		history.push_back(static_cast<float>(durationNs) / 1e6f);
+		if (history.size() > s_HistorySize)
+			history.pop_front();
+
+		GpuScopeStatistics& statistics = m_Statistics[scopes[i].statisticsIndex];
+		statistics.lastMs = history.back();
+		statistics.averageMs =
+			std::accumulate(history.begin(), history.end(), 0.0f) / static_cast<float>(history.size());
+		statistics.minMs = *std::min_element(history.begin(), history.end());
+		statistics.maxMs = *std::max_element(history.begin(), history.end());
+	}
+
+	m_TraceFrames.push_back(std::move(events));
+	if (m_TraceFrames.size() > s_TraceFrameCount)
+		m_TraceFrames.pop_front();
+}
+
+uint32_t GpuProfiler::GetStatisticsIndex(const char* name, uint32_t depth)
+{
+	auto it = std::find_if(m_Statistics.begin(), m_Statistics.end(), [name](const GpuScopeStatistics& statistics) {
+		return statistics.name == name;
+	});
+	if (it != m_Statistics.end())
+		return static_cast<uint32_t>(it - m_Statistics.begin());
+
+	GpuScopeStatistics statistics{};
+	statistics.name = name;
+	statistics.depth = depth;
+	m_Statistics.push_back(std::move(statistics));
+	m_History.emplace_back();
+	return static_cast<uint32_t>(m_Statistics.size() - 1);
+}
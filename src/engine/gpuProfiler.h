@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// GPU time of a named scope over the last `GpuProfiler::s_HistorySize` frames
+struct GpuScopeStatistics
+{
+	std::string name;
+	uint32_t depth = 0; // nesting level
+	float averageMs = 0.0f;
+	float minMs = 0.0f;
+	float maxMs = 0.0f;
+	float lastMs = 0.0f;
+};
+
+/**
+ * GPU timing with timestamp queries
+ * Every frame in flight has its own range of queries in one query pool, which is read
+ * back when the frame's slot has been waited on (no stalls). The scopes can be nested
+ * and are identified by their name. The results are kept as rolling statistics, and the
+ * scopes of the last frames can be exported as a Chrome trace (chrome://tracing, Perfetto).
+ */
+class GpuProfiler
+{
+public:
+	/**
+	 * @param timestampPeriod nanoseconds per timestamp tick (`VkPhysicalDeviceLimits::timestampPeriod`)
+	 * @param timestampValidBits of the queue family the frames are submitted to (0 = no timestamp support)
+	 * @param frameCount number of frames in flight
+	 */
+	GpuProfiler(VkDevice deviceVk, float timestampPeriod, uint32_t timestampValidBits, uint32_t frameCount);
+	~GpuProfiler();
+
+	GpuProfiler(const GpuProfiler&) = delete;
+	GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+	/**
+	 * Reads the results of the previous use of `frameIndex` and resets its queries
+	 * Has to be recorded outside of a render pass, after the previous frame of the slot has been waited on.
+	 */
+	void BeginFrame(VkCommandBuffer cmdBuff, uint32_t frameIndex);
+	// the scopes are dropped when a frame has more than `s_MaxScopesPerFrame`
+	void BeginScope(VkCommandBuffer cmdBuff, const char* name);
+	void EndScope(VkCommandBuffer cmdBuff);
+	// reads the results of the frames that are still in flight, the device has to be idle
+	void ReadPendingResults();
+
+	[[nodiscard]] inline bool IsSupported() const { return m_QueryPool != VK_NULL_HANDLE; }
+	// in the order the scopes were first recorded
+	[[nodiscard]] inline const std::vector<GpuScopeStatistics>& GetStatistics() const { return m_Statistics; }
+
+	// writes the scopes of the last `s_TraceFrameCount` frames in the Chrome trace event format
+	void ExportChromeTrace(const char* path) const;
+
+private:
+	struct Scope
+	{
+		uint32_t statisticsIndex;
+		uint32_t beginQuery; // the end query follows it
+	};
+
+	struct TraceEvent
+	{
+		uint32_t statisticsIndex;
+		uint64_t beginNs;
+		uint64_t endNs;
+	};
+
+	void ReadResults(uint32_t frameIndex);
+	uint32_t GetStatisticsIndex(const char* name, uint32_t depth);
+
+private:
+	static constexpr uint32_t s_MaxScopesPerFrame = 32;
+	static constexpr size_t s_HistorySize = 128;
+	static constexpr size_t s_TraceFrameCount = 256;
+
+	VkDevice m_DeviceVk;
+	float m_TimestampPeriod;
+	uint64_t m_TimestampMask;
+	VkQueryPool m_QueryPool = VK_NULL_HANDLE;
+
+	uint32_t m_FrameIndex = 0;
+	// recorded scopes of every frame in flight, and the open scopes of the current frame
+	std::vector<std::vector<Scope>> m_FrameScopes;
+	std::vector<uint32_t> m_OpenScopes;
+
+	std::vector<GpuScopeStatistics> m_Statistics;
+	std::vector<std::deque<float>> m_History; // durations in ms, per statistics entry
+	std::deque<std::vector<TraceEvent>> m_TraceFrames;
+};
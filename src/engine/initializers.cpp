@@ -79,7 +79,7 @@ VkSwapchainCreateInfoKHR SwapchainCreateInfo(const SwapchainCreateDetails& detai
 	info.imageColorSpace = details.surfaceFormat.colorSpace;
 	info.imageExtent = details.extent;
 	info.imageArrayLayers = 1;
-	info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	info.imageUsage = details.imageUsage;
 	if (details.queueFamilyIndices.graphicsFamily.value() != details.queueFamilyIndices.presentFamily.value())
 	{
 		uint32_t indicesArr[]{ details.queueFamilyIndices.graphicsFamily.value(),
@@ -417,5 +417,29 @@ VkCommandBufferAllocateInfo CommandBufferAllocateInfo(VkCommandPool commandPool,
 	return info;
 }
 
+VkImageMemoryBarrier ImageMemoryBarrier(VkImage image,
+	VkImageLayout oldLayout,
+	VkImageLayout newLayout,
+	VkAccessFlags srcAccessMask,
+	VkAccessFlags dstAccessMask)
+{
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.oldLayout = oldLayout;
+	barrier.newLayout = newLayout;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+	barrier.srcAccessMask = srcAccessMask;
+	barrier.dstAccessMask = dstAccessMask;
+
+	return barrier;
+}
+
 
 } // namespace initializers
\ No newline at end of file
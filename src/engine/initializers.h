@@ -114,5 +114,12 @@ VkPipelineDynamicStateCreateInfo PipelineDynamicStateCreateInfo(uint32_t dynamic
 // command buffer
 VkCommandBufferAllocateInfo CommandBufferAllocateInfo(VkCommandPool commandPool, uint32_t commandBufferCount);
 
+// barrier for the whole color aspect of a single mip level image
+VkImageMemoryBarrier ImageMemoryBarrier(VkImage image,
+	VkImageLayout oldLayout,
+	VkImageLayout newLayout,
+	VkAccessFlags srcAccessMask,
+	VkAccessFlags dstAccessMask);
+
 
 } // namespace initializers
\ No newline at end of file
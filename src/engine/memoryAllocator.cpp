@@ -0,0 +1,237 @@
+#include "engine/memoryAllocator.h"
+
+#include <algorithm>
+#include <set>
+#include "core/core.h"
+
+// block of device memory, sub-allocated with a buddy allocator
+struct MemoryBlock
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	void* mappedData = nullptr;
+	uint32_t poolIndex = 0;
+	uint32_t allocationCount = 0;
+
+	// offsets of the free ranges of every order
+	std::vector<std::set<VkDeviceSize>> freeLists;
+};
+
+
+MemoryAllocator::MemoryAllocator(VkDevice deviceVk, VkPhysicalDevice physicalDevice)
+	: m_DeviceVk{ deviceVk }
+{
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_MemoryProperties);
+	m_Pools.resize(static_cast<size_t>(m_MemoryProperties.memoryTypeCount) * 2);
+
+	// small heaps (e.g. the host visible device local heap of some GPUs) get smaller blocks
+	VkDeviceSize smallestHeap = s_DefaultBlockSize * 8;
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryHeapCount; ++i)
+		smallestHeap = std::min(smallestHeap, m_MemoryProperties.memoryHeaps[i].size);
+
+	m_BlockSize = s_DefaultBlockSize;
+	while (m_BlockSize > s_MinAllocationSize * 1024 && m_BlockSize * 8 > smallestHeap)
+		m_BlockSize /= 2;
+	m_MaxOrder = GetOrder(m_BlockSize);
+}
+
+MemoryAllocator::~MemoryAllocator()
+{
+	if (m_Statistics.allocationCount > 0)
+		Logger::Warn("{} device memory allocation(s) were not freed!", m_Statistics.allocationCount);
+
+	for (auto& pool : m_Pools)
+	{
+		for (auto& block : pool)
+			FreeDeviceMemory(block->memory, block->mappedData);
+	}
+}
+
+Allocation MemoryAllocator::Allocate(const VkMemoryRequirements& requirements,
+	VkMemoryPropertyFlags properties,
+	ResourceTiling tiling)
+{
+	const uint32_t memoryTypeIndex = FindMemoryType(requirements.memoryTypeBits, properties);
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	// the buddy offsets are multiples of the (power of 2) size, which covers the alignment
+	const VkDeviceSize size = std::max(requirements.size, requirements.alignment);
+	if (size > m_BlockSize / 2)
+		return AllocateDedicated(requirements.size, memoryTypeIndex);
+
+	const uint32_t order = GetOrder(size);
+	const uint32_t poolIndex = memoryTypeIndex * 2 + static_cast<uint32_t>(tiling);
+	auto& pool = m_Pools[poolIndex];
+
+	// first block with a free range of at least `order`
+	MemoryBlock* block = nullptr;
+	uint32_t freeOrder = order;
+	for (auto& candidate : pool)
+	{
+		for (freeOrder = order; freeOrder <= m_MaxOrder; ++freeOrder)
+		{
+			if (!candidate->freeLists[freeOrder].empty())
+				break;
+		}
+		if (freeOrder <= m_MaxOrder)
+		{
+			block = candidate.get();
+			break;
+		}
+	}
+
+	if (!block)
+	{
+		auto newBlock = std::make_unique<MemoryBlock>();
+		newBlock->memory = AllocateDeviceMemory(m_BlockSize, memoryTypeIndex, &newBlock->mappedData);
+		newBlock->poolIndex = poolIndex;
+		newBlock->freeLists.resize(m_MaxOrder + 1);
+		newBlock->freeLists[m_MaxOrder].insert(0);
+
+		block = newBlock.get();
+		freeOrder = m_MaxOrder;
+		pool.push_back(std::move(newBlock));
+		++m_Statistics.blockCount;
+		m_Statistics.bytesAllocated += m_BlockSize;
+	}
+
+	// split the free range until it has the requested size, the upper halves stay free
+	auto first = block->freeLists[freeOrder].begin();
+	const VkDeviceSize offset = *first;
+	block->freeLists[freeOrder].erase(first);
+	for (uint32_t i = freeOrder; i > order; --i)
+		block->freeLists[i - 1].insert(offset + (s_MinAllocationSize << (i - 1)));
+
+	++block->allocationCount;
+	++m_Statistics.allocationCount;
+	m_Statistics.bytesUsed += requirements.size;
+	m_Statistics.bytesWasted += (s_MinAllocationSize << order) - requirements.size;
+
+	Allocation allocation{};
+	allocation.memory = block->memory;
+	allocation.offset = offset;
+	allocation.size = requirements.size;
+	allocation.mappedData = block->mappedData ? static_cast<uint8_t*>(block->mappedData) + offset : nullptr;
+	allocation.block = block;
+	allocation.order = order;
+	return allocation;
+}
+
+void MemoryAllocator::Free(Allocation& allocation)
+{
+	if (allocation.memory == VK_NULL_HANDLE)
+		return;
+
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+
+	--m_Statistics.allocationCount;
+	m_Statistics.bytesUsed -= allocation.size;
+
+	MemoryBlock* block = allocation.block;
+	if (!block)
+	{
+		FreeDeviceMemory(allocation.memory, allocation.mappedData);
+		--m_Statistics.dedicatedAllocationCount;
+		m_Statistics.bytesAllocated -= allocation.size;
+		allocation = Allocation{};
+		return;
+	}
+
+	m_Statistics.bytesWasted -= (s_MinAllocationSize << allocation.order) - allocation.size;
+
+	// merge with the free buddies
+	VkDeviceSize offset = allocation.offset;
+	uint32_t order = allocation.order;
+	for (; order < m_MaxOrder; ++order)
+	{
+		const VkDeviceSize buddy = offset ^ (s_MinAllocationSize << order);
+		if (block->freeLists[order].erase(buddy) == 0)
+			break;
+		offset = std::min(offset, buddy);
+	}
+	block->freeLists[order].insert(offset);
+	--block->allocationCount;
+	allocation = Allocation{};
+
+	if (block->allocationCount > 0)
+		return;
+
+	// keep one empty block per pool, so allocating and freeing in a loop doesn't allocate device memory every time
+	auto& pool = m_Pools[block->poolIndex];
+	const bool hasOtherEmptyBlock = std::any_of(pool.begin(), pool.end(), [block](const auto& other) {
+		return other.get() != block && other->allocationCount == 0;
+	});
+	if (!hasOtherEmptyBlock)
+		return;
+
+	FreeDeviceMemory(block->memory, block->mappedData);
+	pool.erase(std::find_if(pool.begin(), pool.end(), [block](const auto& other) { return other.get() == block; }));
+	--m_Statistics.blockCount;
+	m_Statistics.bytesAllocated -= m_BlockSize;
+}
+
+MemoryStatistics MemoryAllocator::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	return m_Statistics;
+}
+
+uint32_t MemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const
+{
+	for (uint32_t i = 0; i < m_MemoryProperties.memoryTypeCount; ++i)
+	{
+		// typeFilter specifies a bit field of memory types
+		if (typeFilter & (1 << i) && (m_MemoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+			return i;
+	}
+
+	THROW(true, "Failed to find suitable memory type!");
+}
+
+VkDeviceMemory MemoryAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData)
+{
+	VkMemoryAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	THROW(vkAllocateMemory(m_DeviceVk, &allocInfo, nullptr, &memory) != VK_SUCCESS, "Failed to allocate memory!")
+
+	*mappedData = nullptr;
+	if (m_MemoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+	{
+		THROW(vkMapMemory(m_DeviceVk, memory, 0, VK_WHOLE_SIZE, 0, mappedData) != VK_SUCCESS,
+			"Failed to map memory!")
+	}
+
+	return memory;
+}
+
+void MemoryAllocator::FreeDeviceMemory(VkDeviceMemory memory, void* mappedData)
+{
+	if (mappedData)
+		vkUnmapMemory(m_DeviceVk, memory);
+	vkFreeMemory(m_DeviceVk, memory, nullptr);
+}
+
+Allocation MemoryAllocator::AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex)
+{
+	Allocation allocation{};
+	allocation.memory = AllocateDeviceMemory(size, memoryTypeIndex, &allocation.mappedData);
+	allocation.size = size;
+
+	++m_Statistics.dedicatedAllocationCount;
+	++m_Statistics.allocationCount;
+	m_Statistics.bytesAllocated += size;
+	m_Statistics.bytesUsed += size;
+	return allocation;
+}
+
+uint32_t MemoryAllocator::GetOrder(VkDeviceSize size)
+{
+	uint32_t order = 0;
+	while ((s_MinAllocationSize << order) < size)
+		++order;
+	return order;
+}
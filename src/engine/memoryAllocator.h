@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+struct MemoryBlock;
+
+// range of device memory bound to a buffer or an image
+struct Allocation
+{
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0; // requested size
+	// host visible memory is persistently mapped, points to `offset` (nullptr for device local memory)
+	void* mappedData = nullptr;
+
+	MemoryBlock* block = nullptr; // nullptr for dedicated allocations
+	uint32_t order = 0; // size class within the block
+};
+
+// which resources share a block, linear and optimal resources are kept apart
+// so `bufferImageGranularity` never has to be considered
+enum class ResourceTiling
+{
+	LINEAR = 0, // buffers and linear images
+	OPTIMAL = 1 // optimal tiling images
+};
+
+struct MemoryStatistics
+{
+	uint32_t blockCount = 0;
+	uint32_t dedicatedAllocationCount = 0;
+	uint32_t allocationCount = 0; // including the dedicated allocations
+	VkDeviceSize bytesAllocated = 0; // allocated from the device (blocks and dedicated allocations)
+	VkDeviceSize bytesUsed = 0; // requested by the resources
+	VkDeviceSize bytesWasted = 0; // lost to rounding the sub-allocations up to their size class
+};
+
+/**
+ * Device memory allocator
+ * Allocates large blocks per memory type (and `ResourceTiling`) and sub-allocates
+ * them with a buddy allocator, so the number of `vkAllocateMemory()` calls stays
+ * far below `maxMemoryAllocationCount`. Allocations larger than half a block get
+ * their own `VkDeviceMemory`. Host visible blocks are mapped once when created.
+ * Thread safe.
+ */
+class MemoryAllocator
+{
+public:
+	MemoryAllocator(VkDevice deviceVk, VkPhysicalDevice physicalDevice);
+	~MemoryAllocator();
+
+	MemoryAllocator(const MemoryAllocator&) = delete;
+	MemoryAllocator& operator=(const MemoryAllocator&) = delete;
+
+	/**
+	 * @param requirements memory requirements of the buffer or image
+	 * @param properties required memory properties
+	 * @param tiling `LINEAR` for buffers, `OPTIMAL` for images with optimal tiling
+	 */
+	[[nodiscard]] Allocation Allocate(const VkMemoryRequirements& requirements,
+		VkMemoryPropertyFlags properties,
+		ResourceTiling tiling);
+	void Free(Allocation& allocation);
+
+	[[nodiscard]] MemoryStatistics GetStatistics() const;
+
+private:
+	uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+	VkDeviceMemory AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryTypeIndex, void** mappedData);
+	void FreeDeviceMemory(VkDeviceMemory memory, void* mappedData);
+	Allocation AllocateDedicated(VkDeviceSize size, uint32_t memoryTypeIndex);
+
+	static uint32_t GetOrder(VkDeviceSize size);
+
+private:
+	// smallest sub-allocation, sizes are rounded up to `s_MinAllocationSize * 2^order`
+	static constexpr VkDeviceSize s_MinAllocationSize = 256;
+	static constexpr VkDeviceSize s_DefaultBlockSize = 64ull * 1024 * 1024;
+
+	VkDevice m_DeviceVk;
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+	VkDeviceSize m_BlockSize; // power of 2
+	uint32_t m_MaxOrder; // order of a whole block
+
+	mutable std::mutex m_Mutex;
+	// blocks of every (memory type, tiling) pair, index = `memoryTypeIndex * 2 + tiling`
+	std::vector<std::vector<std::unique_ptr<MemoryBlock>>> m_Pools;
+	MemoryStatistics m_Statistics{};
+};
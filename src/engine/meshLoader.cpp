@@ -0,0 +1,529 @@
+#include "engine/meshLoader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <string>
+#include <thread>
+#include "core/core.h"
+#include "core/mappedFile.h"
+
+namespace {
+
+// smaller files are not split across all the threads
+constexpr size_t MIN_CHUNK_SIZE = 1 << 20;
+constexpr uint32_t MISSING_INDEX = std::numeric_limits<uint32_t>::max();
+
+// part of the file, both ends are at line boundaries
+struct Chunk
+{
+	const char* begin = nullptr;
+	const char* end = nullptr;
+
+	// number of attributes in the chunk (first pass) and in front of it (second pass)
+	uint32_t positionCount = 0;
+	uint32_t texCoordCount = 0;
+	uint32_t normalCount = 0;
+	uint32_t positionOffset = 0;
+	uint32_t texCoordOffset = 0;
+	uint32_t normalOffset = 0;
+
+	// resolved indices of the triangle corners (3 per triangle)
+	std::vector<uint32_t> cornerPositions;
+	std::vector<uint32_t> cornerTexCoords;
+	std::vector<uint32_t> cornerNormals;
+
+	std::exception_ptr error;
+};
+
+/**
+ * calls `fn(chunkIndex)` for every chunk on `threadCount` threads
+ * the first exception thrown by `fn` is rethrown after all the threads are done
+ */
+void ParallelForChunks(std::vector<Chunk>& chunks, uint32_t threadCount, const std::function<void(Chunk&)>& fn)
+{
+	std::atomic<size_t> nextChunk{ 0 };
+	auto worker = [&]() {
+		for (size_t i = nextChunk.fetch_add(1, std::memory_order_relaxed); i < chunks.size();
+			 i = nextChunk.fetch_add(1, std::memory_order_relaxed))
+		{
+			try
+			{
+				fn(chunks[i]);
+			}
+			catch (...)
+			{
+				chunks[i].error = std::current_exception();
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	threads.reserve(threadCount);
+	for (uint32_t i = 0; i < threadCount; ++i)
+		threads.emplace_back(worker);
+
+	for (auto& thread : threads)
+		thread.join();
+
+	for (const Chunk& chunk : chunks)
+	{
+		if (chunk.error)
+			std::rethrow_exception(chunk.error);
+	}
+}
+
+// ---------------------------------------
+
+inline bool IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool IsDigit(char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+inline const char* SkipSpaces(const char* p, const char* end)
+{
+	while (p < end && IsSpace(*p))
+		++p;
+	return p;
+}
+
+// @returns pointer to the first character of the next line
+inline const char* SkipLine(const char* p, const char* end)
+{
+	while (p < end && *p != '\n')
+		++p;
+	return p < end ? p + 1 : end;
+}
+
+/**
+ * parses an optionally signed integer
+ * @returns pointer after the number, or `p` if there is no number
+ */
+const char* ParseInt(const char* p, const char* end, int64_t& value)
+{
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	if (p == end || !IsDigit(*p))
+		return start;
+
+	int64_t result = 0;
+	while (p < end && IsDigit(*p))
+		result = result * 10 + (*p++ - '0');
+
+	value = negative ? -result : result;
+	return p;
+}
+
+/**
+ * parses a decimal float with an optional exponent (`strtof()` needs a null terminated string)
+ * @returns pointer after the number, or `p` if there is no number
+ */
+const char* ParseFloat(const char* p, const char* end, float& value)
+{
+	const char* start = p;
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = *p++ == '-';
+
+	// only the first 19 significant digits fit into the mantissa, the rest only moves the decimal point
+	uint64_t mantissa = 0;
+	int significantDigits = 0;
+	int exponent = 0;
+	bool hasDigits = false;
+	for (; p < end && IsDigit(*p); ++p, hasDigits = true)
+	{
+		if (significantDigits < 19)
+		{
+			mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+			significantDigits += mantissa > 0 ? 1 : 0;
+		}
+		else
+		{
+			++exponent;
+		}
+	}
+	if (p < end && *p == '.')
+	{
+		for (++p; p < end && IsDigit(*p); ++p, hasDigits = true)
+		{
+			if (significantDigits < 19)
+			{
+				mantissa = mantissa * 10 + static_cast<uint64_t>(*p - '0');
+				significantDigits += mantissa > 0 ? 1 : 0;
+				--exponent;
+			}
+		}
+	}
+	if (!hasDigits)
+		return start;
+
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		int64_t exponentValue = 0;
+		const char* exponentEnd = ParseInt(p + 1, end, exponentValue);
+		if (exponentEnd != p + 1)
+		{
+			exponent += static_cast<int>(std::clamp<int64_t>(exponentValue, -400, 400));
+			p = exponentEnd;
+		}
+	}
+
+	double result = static_cast<double>(mantissa);
+	if (exponent != 0)
+		result *= std::pow(10.0, exponent);
+
+	value = static_cast<float>(negative ? -result : result);
+	return p;
+}
+
+/**
+ * resolves a 1-based or negative (relative to the last attribute so far) OBJ index
+ * @param definedCount number of attributes defined in front of the index
+ * @param totalCount number of attributes in the whole file
+ * @returns 0-based index
+ */
+uint32_t ResolveIndex(int64_t index, uint32_t definedCount, size_t totalCount)
+{
+	const int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(definedCount) + index;
+	THROW(index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(totalCount),
+		"Invalid OBJ index: {} ({} attribute(s) in the file)",
+		index,
+		totalCount)
+
+	return static_cast<uint32_t>(resolved);
+}
+
+// ---------------------------------------
+
+enum class LineType
+{
+	OTHER,
+	POSITION,
+	TEX_COORD,
+	NORMAL,
+	FACE
+};
+
+/**
+ * @param p first character of the line (after the leading spaces)
+ * @returns type of the line and moves `p` after the keyword
+ */
+LineType ParseLineType(const char*& p, const char* end)
+{
+	const auto isKeywordEnd = [end](const char* c) { return c == end || IsSpace(*c); };
+
+	if (p < end && *p == 'v')
+	{
+		if (isKeywordEnd(p + 1))
+		{
+			p += 1;
+			return LineType::POSITION;
+		}
+		if (p + 1 < end && p[1] == 't' && isKeywordEnd(p + 2))
+		{
+			p += 2;
+			return LineType::TEX_COORD;
+		}
+		if (p + 1 < end && p[1] == 'n' && isKeywordEnd(p + 2))
+		{
+			p += 2;
+			return LineType::NORMAL;
+		}
+	}
+	else if (p < end && *p == 'f' && isKeywordEnd(p + 1))
+	{
+		p += 1;
+		return LineType::FACE;
+	}
+
+	return LineType::OTHER;
+}
+
+// first pass, counts the attributes, so that the second pass knows where every chunk starts
+void CountAttributes(Chunk& chunk)
+{
+	for (const char* p = chunk.begin; p < chunk.end; p = SkipLine(p, chunk.end))
+	{
+		p = SkipSpaces(p, chunk.end);
+		switch (ParseLineType(p, chunk.end))
+		{
+		case LineType::POSITION:
+			++chunk.positionCount;
+			break;
+		case LineType::TEX_COORD:
+			++chunk.texCoordCount;
+			break;
+		case LineType::NORMAL:
+			++chunk.normalCount;
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+/**
+ * second pass, writes the attributes of the chunk into the arrays of the whole
+ * file and triangulates the faces
+ */
+void ParseChunk(Chunk& chunk,
+	std::vector<glm::vec3>& positions,
+	std::vector<glm::vec2>& texCoords,
+	std::vector<glm::vec3>& normals)
+{
+	// number of attributes defined so far, relative indices refer to them
+	uint32_t positionCount = chunk.positionOffset;
+	uint32_t texCoordCount = chunk.texCoordOffset;
+	uint32_t normalCount = chunk.normalOffset;
+
+	std::vector<uint32_t> polygon[3]; // position, tex coord and normal indices of the corners
+
+	for (const char* p = chunk.begin; p < chunk.end; p = SkipLine(p, chunk.end))
+	{
+		p = SkipSpaces(p, chunk.end);
+		const LineType type = ParseLineType(p, chunk.end);
+		if (type == LineType::OTHER)
+			continue;
+
+		if (type == LineType::FACE)
+		{
+			for (auto& corners : polygon)
+				corners.clear();
+
+			p = SkipSpaces(p, chunk.end);
+			while (p < chunk.end && *p != '\n' && *p != '#')
+			{
+				// v, v/vt, v//vn or v/vt/vn
+				int64_t index = 0;
+				const char* next = ParseInt(p, chunk.end, index);
+				THROW(next == p, "Invalid OBJ face: {}", std::string(p, SkipLine(p, chunk.end)))
+				p = next;
+				polygon[0].push_back(ResolveIndex(index, positionCount, positions.size()));
+
+				uint32_t texCoord = MISSING_INDEX;
+				uint32_t normal = MISSING_INDEX;
+				if (p < chunk.end && *p == '/')
+				{
+					next = ParseInt(++p, chunk.end, index);
+					if (next != p)
+						texCoord = ResolveIndex(index, texCoordCount, texCoords.size());
+					p = next;
+
+					if (p < chunk.end && *p == '/')
+					{
+						next = ParseInt(++p, chunk.end, index);
+						if (next != p)
+							normal = ResolveIndex(index, normalCount, normals.size());
+						p = next;
+					}
+				}
+				polygon[1].push_back(texCoord);
+				polygon[2].push_back(normal);
+
+				p = SkipSpaces(p, chunk.end);
+			}
+
+			// triangle fan
+			for (size_t i = 2; i < polygon[0].size(); ++i)
+			{
+				for (size_t corner : { size_t{ 0 }, i - 1, i })
+				{
+					chunk.cornerPositions.push_back(polygon[0][corner]);
+					chunk.cornerTexCoords.push_back(polygon[1][corner]);
+					chunk.cornerNormals.push_back(polygon[2][corner]);
+				}
+			}
+			continue;
+		}
+
+		// the missing components are 0
+		float values[3] = { 0.0f, 0.0f, 0.0f };
+		for (float& value : values)
+		{
+			p = SkipSpaces(p, chunk.end);
+			p = ParseFloat(p, chunk.end, value);
+		}
+
+		switch (type)
+		{
+		case LineType::POSITION:
+			positions[positionCount++] = glm::vec3(values[0], values[1], values[2]);
+			break;
+		case LineType::TEX_COORD:
+			texCoords[texCoordCount++] = glm::vec2(values[0], values[1]);
+			break;
+		case LineType::NORMAL:
+			normals[normalCount++] = glm::vec3(values[0], values[1], values[2]);
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+// ---------------------------------------
+
+/**
+ * Open addressing hash set of the unique vertices
+ * Only stores 4 byte indices into the vertex array (the vertices are hashed
+ * with `std::hash<Vertex>`), which is much smaller than a node based map.
+ */
+class VertexDeduplicator
+{
+public:
+	explicit VertexDeduplicator(std::vector<Vertex>& vertices)
+		: m_Vertices{ vertices },
+		  m_Slots(1024, MISSING_INDEX)
+	{}
+
+	/**
+	 * @returns index of the vertex, adds it to the vertex array if it's not there yet
+	 */
+	uint32_t Insert(const Vertex& vertex)
+	{
+		const size_t mask = m_Slots.size() - 1;
+		for (size_t slot = std::hash<Vertex>()(vertex) & mask;; slot = (slot + 1) & mask)
+		{
+			const uint32_t index = m_Slots[slot];
+			if (index == MISSING_INDEX)
+			{
+				const uint32_t newIndex = static_cast<uint32_t>(m_Vertices.size());
+				m_Vertices.push_back(vertex);
+				m_Slots[slot] = newIndex;
+				// keep the load factor under 0.5
+				if (m_Vertices.size() * 2 > m_Slots.size())
+					Grow();
+				return newIndex;
+			}
+			if (m_Vertices[index] == vertex)
+				return index;
+		}
+	}
+
+private:
+	void Grow()
+	{
+		m_Slots.assign(m_Slots.size() * 2, MISSING_INDEX);
+		const size_t mask = m_Slots.size() - 1;
+		for (uint32_t i = 0; i < static_cast<uint32_t>(m_Vertices.size()); ++i)
+		{
+			size_t slot = std::hash<Vertex>()(m_Vertices[i]) & mask;
+			while (m_Slots[slot] != MISSING_INDEX)
+				slot = (slot + 1) & mask;
+			m_Slots[slot] = i;
+		}
+	}
+
+private:
+	std::vector<Vertex>& m_Vertices;
+	std::vector<uint32_t> m_Slots; // power of 2 size
+};
+
+} // namespace
+
+
+namespace meshLoader {
+
+Mesh LoadObj(const char* path, uint32_t threadCount)
+{
+	std::chrono::time_point<std::chrono::high_resolution_clock> startTime = std::chrono::high_resolution_clock::now();
+
+	if (threadCount == 0)
+		threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+	const MappedFile file{ path };
+	const char* data = file.GetData();
+	const char* dataEnd = data + file.GetSize();
+
+	// split the file into chunks, moving every split point to the start of the next line
+	const size_t chunkCount =
+		std::clamp<size_t>(file.GetSize() / MIN_CHUNK_SIZE, 1, static_cast<size_t>(threadCount) * 4);
+	std::vector<Chunk> chunks;
+	chunks.reserve(chunkCount);
+	const char* chunkBegin = data;
+	for (size_t i = 1; i <= chunkCount && chunkBegin < dataEnd; ++i)
+	{
+		const char* chunkEnd = i == chunkCount ? dataEnd : SkipLine(data + file.GetSize() / chunkCount * i, dataEnd);
+		Chunk& chunk = chunks.emplace_back();
+		chunk.begin = chunkBegin;
+		chunk.end = std::max(chunkEnd, chunkBegin);
+		chunkBegin = chunk.end;
+	}
+	threadCount = std::min(threadCount, static_cast<uint32_t>(std::max<size_t>(chunks.size(), 1)));
+
+	ParallelForChunks(chunks, threadCount, CountAttributes);
+
+	uint32_t positionCount = 0, texCoordCount = 0, normalCount = 0;
+	for (Chunk& chunk : chunks)
+	{
+		chunk.positionOffset = positionCount;
+		chunk.texCoordOffset = texCoordCount;
+		chunk.normalOffset = normalCount;
+		positionCount += chunk.positionCount;
+		texCoordCount += chunk.texCoordCount;
+		normalCount += chunk.normalCount;
+	}
+
+	std::vector<glm::vec3> positions(positionCount);
+	std::vector<glm::vec2> texCoords(texCoordCount);
+	std::vector<glm::vec3> normals(normalCount);
+	ParallelForChunks(
+		chunks, threadCount, [&](Chunk& chunk) { ParseChunk(chunk, positions, texCoords, normals); });
+
+	// deduplicate the vertices, and free the corners of every chunk once they are done
+	Mesh mesh{};
+	size_t cornerCount = 0;
+	for (const Chunk& chunk : chunks)
+		cornerCount += chunk.cornerPositions.size();
+	mesh.indices.reserve(cornerCount);
+
+	VertexDeduplicator deduplicator{ mesh.vertices };
+	for (Chunk& chunk : chunks)
+	{
+		for (size_t i = 0; i < chunk.cornerPositions.size(); ++i)
+		{
+			Vertex vertex{};
+			vertex.pos = positions[chunk.cornerPositions[i]];
+			vertex.normal = glm::vec3(0.0f);
+			vertex.texCoord = glm::vec2(0.0f);
+			if (chunk.cornerNormals[i] != MISSING_INDEX)
+				vertex.normal = normals[chunk.cornerNormals[i]];
+			if (chunk.cornerTexCoords[i] != MISSING_INDEX)
+				vertex.texCoord = texCoords[chunk.cornerTexCoords[i]];
+
+			mesh.indices.push_back(deduplicator.Insert(vertex));
+		}
+
+		chunk.cornerPositions = {};
+		chunk.cornerTexCoords = {};
+		chunk.cornerNormals = {};
+	}
+	mesh.vertices.shrink_to_fit();
+
+	float elapsed = std::chrono::duration<float, std::chrono::milliseconds::period>(
+		std::chrono::high_resolution_clock::now() - startTime)
+						.count();
+	Logger::Info("Loaded \"{}\": {} triangle(s), {} vertices ({} chunk(s) on {} thread(s)) in {:.1f} ms",
+		path,
+		mesh.indices.size() / 3,
+		mesh.vertices.size(),
+		chunks.size(),
+		threadCount,
+		elapsed);
+
+	return mesh;
+}
+
+} // namespace meshLoader
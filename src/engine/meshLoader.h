@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "engine/types.h"
+
+// indexed triangle mesh
+struct Mesh
+{
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices; // 3 per triangle
+};
+
+namespace meshLoader {
+
+/**
+ * Loads a Wavefront OBJ file
+ * The file is memory mapped and split into chunks at line boundaries, which are
+ * parsed in parallel. Polygons are triangulated as fans and the vertices are
+ * deduplicated. Vertices without a normal have a zero normal (the ray tracer
+ * uses the normal of the triangle for them). Materials and groups are ignored.
+ * @param path path of the .obj file
+ * @param threadCount number of threads used for parsing (default = 0 = all hardware threads)
+ */
+[[nodiscard]] Mesh LoadObj(const char* path, uint32_t threadCount = 0);
+
+} // namespace meshLoader
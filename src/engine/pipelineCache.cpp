@@ -0,0 +1,113 @@
+#include "engine/pipelineCache.h"
+
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <vector>
+#include "core/core.h"
+
+namespace {
+
+// written in front of the data returned by `vkGetPipelineCacheData()`
+struct PipelineCacheFileHeader
+{
+	uint32_t magic;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint64_t dataSize;
+};
+
+constexpr uint32_t s_PipelineCacheMagic = 0x43505653; // "SVPC"
+
+PipelineCacheFileHeader CreateHeader(const VkPhysicalDeviceProperties& properties, uint64_t dataSize)
+{
+	PipelineCacheFileHeader header{};
+	header.magic = s_PipelineCacheMagic;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE);
+	header.dataSize = dataSize;
+	return header;
+}
+
+} // namespace
+
+
+PipelineCache::PipelineCache(VkDevice deviceVk, const VkPhysicalDeviceProperties& properties, std::string path)
+	: m_DeviceVk{ deviceVk },
+	  m_Properties{ properties },
+	  m_Path{ std::move(path) }
+{
+	std::vector<char> data;
+
+	std::ifstream file{ m_Path, std::ios::binary | std::ios::ate };
+	if (file.is_open())
+	{
+		const auto fileSize = static_cast<uint64_t>(file.tellg());
+		file.seekg(0);
+
+		PipelineCacheFileHeader header{};
+		const PipelineCacheFileHeader expected = CreateHeader(m_Properties, fileSize - sizeof(header));
+		if (fileSize >= sizeof(header) && file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			&& memcmp(&header, &expected, sizeof(header)) == 0)
+		{
+			data.resize(header.dataSize);
+			if (!file.read(data.data(), static_cast<std::streamsize>(data.size())))
+				data.clear();
+		}
+		else
+		{
+			Logger::Warn("Pipeline cache {} is invalid or from another device or driver, it is discarded", m_Path);
+		}
+	}
+
+	VkPipelineCacheCreateInfo pipelineCacheInfo{};
+	pipelineCacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	pipelineCacheInfo.initialDataSize = data.size();
+	pipelineCacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+	THROW(vkCreatePipelineCache(m_DeviceVk, &pipelineCacheInfo, nullptr, &m_PipelineCache) != VK_SUCCESS,
+		"Failed to create pipeline cache!")
+
+	m_IsWarm = !data.empty();
+	if (m_IsWarm)
+		Logger::Info("Loaded pipeline cache {} ({:.1f} KiB)", m_Path, static_cast<float>(data.size()) / 1024.0f);
+	else
+		Logger::Info("No pipeline cache loaded, pipelines are compiled from scratch (cold start)");
+}
+
+PipelineCache::~PipelineCache()
+{
+	Save();
+	vkDestroyPipelineCache(m_DeviceVk, m_PipelineCache, nullptr);
+}
+
+void PipelineCache::Save() const
+{
+	size_t dataSize = 0;
+	if (vkGetPipelineCacheData(m_DeviceVk, m_PipelineCache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0)
+		return;
+	std::vector<char> data(dataSize);
+	if (vkGetPipelineCacheData(m_DeviceVk, m_PipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+		return;
+
+	// written to a temporary file first, so a crash while saving doesn't leave a truncated cache behind
+	const std::string tempPath = m_Path + ".tmp";
+	{
+		std::ofstream file{ tempPath, std::ios::binary | std::ios::trunc };
+		const PipelineCacheFileHeader header = CreateHeader(m_Properties, dataSize);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(data.data(), static_cast<std::streamsize>(dataSize));
+		if (!file)
+		{
+			Logger::Warn("Failed to write pipeline cache {}", tempPath);
+			return;
+		}
+	}
+	// `std::rename()` doesn't replace existing files on Windows
+	std::remove(m_Path.c_str());
+	if (std::rename(tempPath.c_str(), m_Path.c_str()) != 0)
+		Logger::Warn("Failed to save pipeline cache {}", m_Path);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vulkan/vulkan.h>
+
+/**
+ * `VkPipelineCache` persisted on disk
+ * The data is prefixed with the device and driver it was created with, and is
+ * discarded when it doesn't match the current device (e.g. after a driver update),
+ * since some drivers don't reject foreign cache data gracefully. The cache is
+ * saved when it is destroyed.
+ */
+class PipelineCache
+{
+public:
+	/**
+	 * @param properties properties of the device the pipelines are created for
+	 * @param path file the cache is loaded from and saved to
+	 */
+	PipelineCache(VkDevice deviceVk, const VkPhysicalDeviceProperties& properties, std::string path);
+	~PipelineCache();
+
+	PipelineCache(const PipelineCache&) = delete;
+	PipelineCache& operator=(const PipelineCache&) = delete;
+
+	[[nodiscard]] inline VkPipelineCache GetHandle() const { return m_PipelineCache; }
+	// whether valid data has been loaded from disk
+	[[nodiscard]] inline bool IsWarm() const { return m_IsWarm; }
+
+private:
+	void Save() const;
+
+private:
+	VkDevice m_DeviceVk;
+	VkPhysicalDeviceProperties m_Properties;
+	std::string m_Path;
+
+	VkPipelineCache m_PipelineCache = VK_NULL_HANDLE;
+	bool m_IsWarm = false;
+};
@@ -0,0 +1,57 @@
+#include "engine/resolutionScaler.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+ResolutionScaler::ResolutionScaler(float scale, float targetFrameTimeMs)
+	: m_Scale{ std::clamp(scale, s_MinScale, s_MaxScale) },
+	  m_TargetFrameTimeMs{ targetFrameTimeMs }
+{}
+
+bool ResolutionScaler::Update(float frameTimeMs)
+{
+	if (!IsDynamic() || frameTimeMs <= 0.0f)
+		return false;
+
+	if (m_CooldownFrameCount > 0)
+	{
+		--m_CooldownFrameCount;
+		m_AverageFrameTimeMs = frameTimeMs;
+		return false;
+	}
+
+	// exponential moving average, so that single slow frames don't change the scale
+	m_AverageFrameTimeMs += (frameTimeMs - m_AverageFrameTimeMs) * s_Smoothing;
+	const float ratio = m_TargetFrameTimeMs / m_AverageFrameTimeMs;
+	if (std::abs(ratio - 1.0f) <= s_Tolerance)
+	{
+		m_OffTargetFrameCount = 0;
+		return false;
+	}
+	if (++m_OffTargetFrameCount < s_SettleFrameCount)
+		return false;
+	m_OffTargetFrameCount = 0;
+
+	// the cost of a frame is roughly proportional to the number of pixels, i.e. to the square of the scale
+	const float scale =
+		std::clamp(std::round(m_Scale * std::sqrt(ratio) / s_ScaleStep) * s_ScaleStep, s_MinScale, s_MaxScale);
+	if (scale == m_Scale)
+		return false;
+
+	m_Scale = scale;
+	m_CooldownFrameCount = s_CooldownFrameCount;
+	return true;
+}
+
+void ResolutionScaler::SetScale(float scale)
+{
+	m_Scale = std::clamp(scale, s_MinScale, s_MaxScale);
+	m_CooldownFrameCount = s_CooldownFrameCount;
+}
+
+VkExtent2D ResolutionScaler::GetRenderExtent(VkExtent2D outputExtent) const
+{
+	return { std::max(static_cast<uint32_t>(std::lround(static_cast<float>(outputExtent.width) * m_Scale)), 1u),
+		std::max(static_cast<uint32_t>(std::lround(static_cast<float>(outputExtent.height) * m_Scale)), 1u) };
+}
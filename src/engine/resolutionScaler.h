@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+/**
+ * Dynamic resolution of the ray traced image
+ * Picks the scale of the ray traced image (relative to the output extent) so that the
+ * frame time stays close to a target. The frame time is smoothed and the scale only
+ * changes in steps, after the frame time has been off the target for a few frames,
+ * because every change restarts the accumulation.
+ */
+class ResolutionScaler
+{
+public:
+	/**
+	 * @param scale initial scale (fixed if there is no target frame time)
+	 * @param targetFrameTimeMs the scale adapts to it, 0 keeps the scale fixed
+	 */
+	ResolutionScaler(float scale, float targetFrameTimeMs);
+
+	/**
+	 * @param frameTimeMs time of the last finished frame
+	 * @returns true if the scale has changed
+	 */
+	bool Update(float frameTimeMs);
+
+	// clamped to [`s_MinScale`, `s_MaxScale`]
+	void SetScale(float scale);
+	inline void SetTargetFrameTime(float targetFrameTimeMs) { m_TargetFrameTimeMs = targetFrameTimeMs; }
+
+	[[nodiscard]] inline float GetScale() const { return m_Scale; }
+	[[nodiscard]] inline float GetTargetFrameTime() const { return m_TargetFrameTimeMs; }
+	[[nodiscard]] inline bool IsDynamic() const { return m_TargetFrameTimeMs > 0.0f; }
+	// extent of the ray traced image, at least 1x1
+	[[nodiscard]] VkExtent2D GetRenderExtent(VkExtent2D outputExtent) const;
+
+public:
+	static constexpr float s_MinScale = 0.25f;
+	static constexpr float s_MaxScale = 1.0f;
+
+private:
+	// the frame time can be this far off the target (relative) without changing the scale
+	static constexpr float s_Tolerance = 0.1f;
+	static constexpr float s_ScaleStep = 0.05f;
+	// frames off the target before the scale changes
+	static constexpr uint32_t s_SettleFrameCount = 8;
+	// frames ignored after a change, the frames in flight were rendered at the previous scale
+	static constexpr uint32_t s_CooldownFrameCount = 8;
+	// weight of the last frame in the average
+	static constexpr float s_Smoothing = 0.1f;
+
+	float m_Scale;
+	float m_TargetFrameTimeMs;
+	float m_AverageFrameTimeMs = 0.0f;
+	uint32_t m_OffTargetFrameCount = 0;
+	uint32_t m_CooldownFrameCount = s_CooldownFrameCount;
+};
@@ -0,0 +1,221 @@
+#include "engine/scene.h"
+
+#include <cmath>
+#include <cstring>
+#include <random>
+#include "core/core.h"
+
+namespace {
+
+/**
+ * packs the elements behind a header holding their count
+ * @param `elements` elements of one of the scene buffers
+ * @returns contents of the buffer
+ */
+template<typename T>
+std::vector<uint8_t> PackBufferData(const std::vector<T>& elements)
+{
+	std::vector<uint8_t> data(Scene::s_BufferHeaderSize + elements.size() * sizeof(T), 0);
+
+	const uint32_t count = static_cast<uint32_t>(elements.size());
+	std::memcpy(data.data(), &count, sizeof(count));
+	if (!elements.empty())
+		std::memcpy(data.data() + Scene::s_BufferHeaderSize, elements.data(), elements.size() * sizeof(T));
+
+	return data;
+}
+
+} // namespace
+
+
+uint32_t Scene::AddMaterial(const Material& material)
+{
+	m_Materials.push_back(material);
+	return static_cast<uint32_t>(m_Materials.size() - 1);
+}
+
+void Scene::AddSphere(const glm::vec3& center, float radius, uint32_t materialIndex)
+{
+	THROW(materialIndex >= m_Materials.size(), "Invalid material index: {}", materialIndex)
+	THROW(m_Spheres.size() > s_PrimitiveIndexMask, "Too many spheres!")
+	m_Spheres.push_back(Sphere{ center, radius, materialIndex });
+}
+
+void Scene::AddPlane(const glm::vec3& normal, const glm::vec3& position, uint32_t materialIndex)
+{
+	THROW(materialIndex >= m_Materials.size(), "Invalid material index: {}", materialIndex)
+	m_Planes.push_back(Plane{ glm::normalize(normal), materialIndex, position });
+}
+
+void Scene::AddMesh(const Mesh& mesh, const glm::vec3& offset, float scale, uint32_t materialIndex)
+{
+	THROW(materialIndex >= m_Materials.size(), "Invalid material index: {}", materialIndex)
+	THROW(m_Triangles.size() + mesh.indices.size() / 3 > s_PrimitiveIndexMask, "Too many triangles!")
+
+	const uint32_t firstVertex = static_cast<uint32_t>(m_Vertices.size());
+	m_Vertices.reserve(m_Vertices.size() + mesh.vertices.size());
+	for (Vertex vertex : mesh.vertices)
+	{
+		// the normals don't change with a uniform scale
+		vertex.pos = vertex.pos * scale + offset;
+		m_Vertices.push_back(vertex);
+	}
+
+	m_Triangles.reserve(m_Triangles.size() + mesh.indices.size() / 3);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		const glm::uvec3 indices{ firstVertex + mesh.indices[i],
+			firstVertex + mesh.indices[i + 1],
+			firstVertex + mesh.indices[i + 2] };
+		m_Triangles.push_back(Triangle{ indices, materialIndex });
+	}
+}
+
+void Scene::BuildBvh()
+{
+	std::vector<Aabb> primitiveBounds;
+	std::vector<uint32_t> primitiveRefs;
+	primitiveBounds.reserve(m_Spheres.size() + m_Triangles.size());
+	primitiveRefs.reserve(m_Spheres.size() + m_Triangles.size());
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_Spheres.size()); ++i)
+	{
+		const Sphere& sphere = m_Spheres[i];
+		const glm::vec3 radius{ std::abs(sphere.radius) };
+		primitiveBounds.push_back(Aabb{ sphere.center - radius, sphere.center + radius });
+		primitiveRefs.push_back(PackPrimitiveRef(PrimitiveType::SPHERE, i));
+	}
+
+	for (uint32_t i = 0; i < static_cast<uint32_t>(m_Triangles.size()); ++i)
+	{
+		Aabb bounds{};
+		for (int corner = 0; corner < 3; ++corner)
+			bounds.Grow(m_Vertices[m_Triangles[i].indices[corner]].pos);
+		primitiveBounds.push_back(bounds);
+		primitiveRefs.push_back(PackPrimitiveRef(PrimitiveType::TRIANGLE, i));
+	}
+
+	m_Bvh = Bvh{ primitiveBounds };
+
+	// reorder the references, so that every leaf refers to a contiguous range
+	const std::vector<uint32_t>& primitiveIndices = m_Bvh.GetPrimitiveIndices();
+	m_PrimitiveRefs.resize(primitiveIndices.size());
+	for (size_t i = 0; i < primitiveIndices.size(); ++i)
+		m_PrimitiveRefs[i] = primitiveRefs[primitiveIndices[i]];
+}
+
+Scene Scene::CreateDefault(uint32_t randomSphereCount, const char* meshPath, uint32_t seed)
+{
+	Scene scene{};
+
+	const uint32_t glass =
+		scene.AddMaterial(Material{ glm::vec3(1.0f, 1.0f, 1.0f), MaterialType::DIELECTRIC, 0.0f, 1.5f });
+	const uint32_t diffuse =
+		scene.AddMaterial(Material{ glm::vec3(0.6f, 0.4f, 0.4f), MaterialType::LAMBERTIAN, 0.0f, 0.0f });
+	const uint32_t metal =
+		scene.AddMaterial(Material{ glm::vec3(0.8f, 0.7f, 0.5f), MaterialType::METAL, 0.5f, 0.0f });
+	const uint32_t ground =
+		scene.AddMaterial(Material{ glm::vec3(0.45f, 0.6f, 0.3f), MaterialType::METAL, 0.99f, 0.0f });
+
+	scene.AddSphere(glm::vec3(-1.2f, 0.0f, -1.0f), 0.5f, glass); // left sphere
+	scene.AddSphere(glm::vec3(0.0f, 0.0f, -1.0f), 0.5f, diffuse); // middle sphere
+	scene.AddSphere(glm::vec3(1.2f, 0.0f, -1.0f), 0.5f, metal); // right sphere
+	scene.AddPlane(glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, -0.501f, 0.0f), ground); // ground plane
+
+	if (randomSphereCount > 0)
+	{
+		std::mt19937 rng{ seed };
+		std::uniform_real_distribution<float> dist{ 0.0f, 1.0f };
+
+		// a small palette of random materials shared by all the random spheres
+		const uint32_t paletteSize = 32;
+		const uint32_t firstPaletteMaterial = static_cast<uint32_t>(scene.GetMaterials().size());
+		for (uint32_t i = 0; i < paletteSize; ++i)
+		{
+			const glm::vec3 albedo{ dist(rng), dist(rng), dist(rng) };
+			const float chooseMaterial = dist(rng);
+			if (chooseMaterial < 0.7f)
+				scene.AddMaterial(Material{ albedo * albedo, MaterialType::LAMBERTIAN, 0.0f, 0.0f });
+			else if (chooseMaterial < 0.9f)
+				scene.AddMaterial(Material{ 0.5f + 0.5f * albedo, MaterialType::METAL, 0.5f * dist(rng), 0.0f });
+			else
+				scene.AddMaterial(Material{ glm::vec3(1.0f), MaterialType::DIELECTRIC, 0.0f, 1.5f });
+		}
+
+		// the area grows with the number of spheres, so that their density stays about the same
+		const float radius = 0.1f;
+		const float halfExtent = std::max(5.0f, 0.25f * std::sqrt(static_cast<float>(randomSphereCount)));
+		for (uint32_t i = 0; i < randomSphereCount; ++i)
+		{
+			const glm::vec3 center{ (2.0f * dist(rng) - 1.0f) * halfExtent,
+				-0.501f + radius,
+				-1.0f + (2.0f * dist(rng) - 1.0f) * halfExtent };
+			const uint32_t material = firstPaletteMaterial + static_cast<uint32_t>(rng() % paletteSize);
+			scene.AddSphere(center, radius, material);
+		}
+	}
+
+	if (meshPath)
+	{
+		const Mesh mesh = meshLoader::LoadObj(meshPath);
+		Aabb bounds{};
+		for (const Vertex& vertex : mesh.vertices)
+			bounds.Grow(vertex.pos);
+
+		if (!mesh.vertices.empty())
+		{
+			const glm::vec3 extent = bounds.max - bounds.min;
+			const float maxExtent = std::max(std::max(extent.x, extent.y), extent.z);
+			const float scale = maxExtent > 0.0f ? 1.0f / maxExtent : 1.0f;
+			// standing on the ground plane, behind the middle sphere
+			const glm::vec3 bottomCenter{ 0.5f * (bounds.min.x + bounds.max.x),
+				bounds.min.y,
+				0.5f * (bounds.min.z + bounds.max.z) };
+			const glm::vec3 offset = glm::vec3(0.0f, -0.501f, -2.2f) - bottomCenter * scale;
+
+			const uint32_t meshMaterial =
+				scene.AddMaterial(Material{ glm::vec3(0.7f, 0.7f, 0.7f), MaterialType::LAMBERTIAN, 0.0f, 0.0f });
+			scene.AddMesh(mesh, offset, scale, meshMaterial);
+		}
+	}
+
+	scene.BuildBvh();
+	return scene;
+}
+
+std::vector<uint8_t> Scene::GetMaterialBufferData() const
+{
+	return PackBufferData(m_Materials);
+}
+
+std::vector<uint8_t> Scene::GetSphereBufferData() const
+{
+	return PackBufferData(m_Spheres);
+}
+
+std::vector<uint8_t> Scene::GetPlaneBufferData() const
+{
+	return PackBufferData(m_Planes);
+}
+
+std::vector<uint8_t> Scene::GetBvhNodeBufferData() const
+{
+	return PackBufferData(m_Bvh.GetNodes());
+}
+
+std::vector<uint8_t> Scene::GetPrimitiveRefBufferData() const
+{
+	return PackBufferData(m_PrimitiveRefs);
+}
+
+std::vector<uint8_t> Scene::GetVertexBufferData() const
+{
+	// the shader reads every vertex as two vec4s
+	static_assert(sizeof(Vertex) == 32, "Vertex layout doesn't match the shader");
+	return PackBufferData(m_Vertices);
+}
+
+std::vector<uint8_t> Scene::GetTriangleBufferData() const
+{
+	return PackBufferData(m_Triangles);
+}
\ No newline at end of file
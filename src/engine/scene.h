@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "engine/bvh.h"
+#include "engine/meshLoader.h"
+
+enum class MaterialType : uint32_t
+{
+	LAMBERTIAN = 0, // diffuse
+	METAL = 1,
+	DIELECTRIC = 2 // glass / refractive
+};
+
+// types of the primitives referenced by the BVH leaves
+enum class PrimitiveType : uint32_t
+{
+	SPHERE = 0,
+	TRIANGLE = 1
+};
+
+// the structs below match the std430 layout of the scene buffers in `assets/shaders/raytracing.glsl`
+
+struct Material
+{
+	alignas(16) glm::vec3 albedo;
+	alignas(4) MaterialType type;
+	alignas(4) float roughness; // [0, 1] (metal)
+	alignas(4) float refractiveIndex; // (dielectric)
+	// a path ends when it hits the material after this many bounces, 0 if only the global limit applies
+	alignas(4) uint32_t maxBounces = 0;
+};
+
+struct Sphere
+{
+	alignas(16) glm::vec3 center;
+	alignas(4) float radius;
+	alignas(4) uint32_t materialIndex;
+};
+
+struct Plane
+{
+	alignas(16) glm::vec3 normal;
+	alignas(4) uint32_t materialIndex;
+	alignas(16) glm::vec3 position; // a point on the plane
+};
+
+struct Triangle
+{
+	alignas(16) glm::uvec3 indices; // into the vertex array
+	alignas(4) uint32_t materialIndex;
+};
+
+/**
+ * Description of the ray traced scene
+ * Every primitive type is kept in its own array and refers to its material by
+ * index, so the scene can be uploaded to the GPU as it is, one storage buffer per array.
+ * The bounded primitives (spheres, triangles) are also referenced by a BVH, the
+ * planes are unbounded and are tested against every ray. The triangles index into
+ * a shared array of `Vertex`.
+ */
+class Scene
+{
+public:
+	// size of the header (element count + padding) in front of the elements of each scene buffer
+	static constexpr size_t s_BufferHeaderSize = 16;
+	// BVH primitive references store the `PrimitiveType` in the upper bits and the index in the rest
+	static constexpr uint32_t s_PrimitiveIndexBits = 28;
+	static constexpr uint32_t s_PrimitiveIndexMask = (1u << s_PrimitiveIndexBits) - 1;
+
+public:
+	/**
+	 * @returns index of the material, used by the primitives to refer to it
+	 */
+	uint32_t AddMaterial(const Material& material);
+	void AddSphere(const glm::vec3& center, float radius, uint32_t materialIndex);
+	void AddPlane(const glm::vec3& normal, const glm::vec3& position, uint32_t materialIndex);
+	/**
+	 * adds the triangles of the mesh, its vertices are scaled and then moved by `offset`
+	 */
+	void AddMesh(const Mesh& mesh, const glm::vec3& offset, float scale, uint32_t materialIndex);
+
+	// (re)builds the BVH, has to be called after adding primitives
+	void BuildBvh();
+
+	/**
+	 * three spheres (glass, diffuse, metal) on a metal ground plane
+	 * @param randomSphereCount number of small random spheres scattered on the ground plane
+	 * @param meshPath optional .obj mesh, scaled to fit into a unit cube and placed behind the spheres
+	 * @param seed seed of the random spheres
+	 * @returns the scene with its BVH built
+	 */
+	[[nodiscard]] static Scene CreateDefault(
+		uint32_t randomSphereCount = 0, const char* meshPath = nullptr, uint32_t seed = 1);
+
+	[[nodiscard]] inline const std::vector<Material>& GetMaterials() const { return m_Materials; }
+	[[nodiscard]] inline const std::vector<Sphere>& GetSpheres() const { return m_Spheres; }
+	[[nodiscard]] inline const std::vector<Plane>& GetPlanes() const { return m_Planes; }
+	[[nodiscard]] inline const std::vector<Vertex>& GetVertices() const { return m_Vertices; }
+	[[nodiscard]] inline const std::vector<Triangle>& GetTriangles() const { return m_Triangles; }
+	[[nodiscard]] inline const Bvh& GetBvh() const { return m_Bvh; }
+	// packed (type, index) references of the primitives in BVH leaf order
+	[[nodiscard]] inline const std::vector<uint32_t>& GetPrimitiveRefs() const { return m_PrimitiveRefs; }
+
+	// contents of the scene buffers (header followed by the elements)
+	[[nodiscard]] std::vector<uint8_t> GetMaterialBufferData() const;
+	[[nodiscard]] std::vector<uint8_t> GetSphereBufferData() const;
+	[[nodiscard]] std::vector<uint8_t> GetPlaneBufferData() const;
+	[[nodiscard]] std::vector<uint8_t> GetBvhNodeBufferData() const;
+	[[nodiscard]] std::vector<uint8_t> GetPrimitiveRefBufferData() const;
+	[[nodiscard]] std::vector<uint8_t> GetVertexBufferData() const;
+	[[nodiscard]] std::vector<uint8_t> GetTriangleBufferData() const;
+
+	[[nodiscard]] static inline uint32_t PackPrimitiveRef(PrimitiveType type, uint32_t index)
+	{
+		return (static_cast<uint32_t>(type) << s_PrimitiveIndexBits) | index;
+	}
+	[[nodiscard]] static inline PrimitiveType GetPrimitiveType(uint32_t ref)
+	{
+		return static_cast<PrimitiveType>(ref >> s_PrimitiveIndexBits);
+	}
+	[[nodiscard]] static inline uint32_t GetPrimitiveIndex(uint32_t ref) { return ref & s_PrimitiveIndexMask; }
+
+private:
+	std::vector<Material> m_Materials;
+	std::vector<Sphere> m_Spheres;
+	std::vector<Plane> m_Planes;
+	std::vector<Vertex> m_Vertices;
+	std::vector<Triangle> m_Triangles;
+
+	Bvh m_Bvh;
+	std::vector<uint32_t> m_PrimitiveRefs;
+};
\ No newline at end of file
@@ -0,0 +1,210 @@
+#include "engine/shaderHotReloader.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include "core/core.h"
+#include "core/profiler.h"
+
+// set by CMake to the `glslc` of the Vulkan SDK
+#ifndef SHADERS_BASICS_GLSLC
+	#define SHADERS_BASICS_GLSLC "glslc"
+#endif
+
+namespace {
+
+// FNV-1a
+uint64_t HashBytes(const std::vector<char>& bytes, uint64_t hash = 14695981039346656037ull)
+{
+	for (char byte : bytes)
+	{
+		hash ^= static_cast<uint8_t>(byte);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+std::vector<char> ReadFile(const std::filesystem::path& path)
+{
+	std::ifstream file{ path, std::ios::binary };
+	return std::vector<char>{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+}
+
+/**
+ * Runs a command and captures its output (stdout and stderr)
+ * @returns exit code of the command
+ */
+int RunCommand(const std::string& command, std::string& output)
+{
+#ifdef _WIN32
+	// `cmd /c` strips the outer quotes
+	FILE* pipe = _popen(("\"" + command + " 2>&1\"").c_str(), "r");
+#else
+	FILE* pipe = popen((command + " 2>&1").c_str(), "r");
+#endif
+	if (!pipe)
+		return -1;
+
+	char buffer[256];
+	while (fgets(buffer, sizeof(buffer), pipe))
+		output += buffer;
+
+#ifdef _WIN32
+	return _pclose(pipe);
+#else
+	return pclose(pipe);
+#endif
+}
+
+} // namespace
+
+
+ShaderHotReloader::ShaderHotReloader(std::string sourceDir, std::string cacheDir)
+	: m_SourceDir{ std::move(sourceDir) },
+	  m_CacheDir{ std::move(cacheDir) }
+{
+	std::error_code error;
+	std::filesystem::create_directories(m_CacheDir, error);
+	THROW(error, "Failed to create shader cache directory {}: {}", m_CacheDir, error.message())
+
+	m_Thread = std::thread{ &ShaderHotReloader::Run, this };
+}
+
+ShaderHotReloader::~ShaderHotReloader()
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Stop = true;
+	}
+	m_Condition.notify_one();
+	m_Thread.join();
+}
+
+void ShaderHotReloader::Watch(const std::vector<std::string>& sources, bool compileNow)
+{
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		m_Sources = sources;
+		m_CompileNow = compileNow;
+		// compiled for the previous stages
+		m_Compiled.reset();
+	}
+	m_Condition.notify_one();
+}
+
+std::optional<std::vector<std::string>> ShaderHotReloader::PollCompiled()
+{
+	std::lock_guard<std::mutex> lock{ m_Mutex };
+	std::optional<std::vector<std::string>> compiled;
+	compiled.swap(m_Compiled);
+	return compiled;
+}
+
+void ShaderHotReloader::Run()
+{
+	Profiler::SetThreadName("Shader hot reloader");
+	std::filesystem::file_time_type lastWriteTime = GetLastWriteTime();
+
+	std::unique_lock<std::mutex> lock{ m_Mutex };
+	while (true)
+	{
+		m_Condition.wait_for(lock, s_PollInterval, [this]() { return m_Stop || m_CompileNow; });
+		if (m_Stop)
+			return;
+
+		const bool compileNow = m_CompileNow;
+		m_CompileNow = false;
+		const std::vector<std::string> sources = m_Sources;
+
+		// the file system and the compiler are slow, the engine can keep polling meanwhile
+		lock.unlock();
+		const std::filesystem::file_time_type writeTime = GetLastWriteTime();
+		std::vector<std::string> spirvPaths;
+		const bool changed = compileNow || writeTime != lastWriteTime;
+		lastWriteTime = writeTime;
+		const bool compiled = changed && !sources.empty() && Compile(sources, spirvPaths);
+		lock.lock();
+
+		// the stages might have been switched while compiling
+		if (compiled && sources == m_Sources)
+			m_Compiled = std::move(spirvPaths);
+	}
+}
+
+bool ShaderHotReloader::Compile(const std::vector<std::string>& sources, std::vector<std::string>& spirvPaths) const
+{
+	PROFILE_FUNCTION();
+
+	for (const std::string& source : sources)
+	{
+		char hash[17];
+		snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(HashSources(source)));
+		const std::string sourcePath = m_SourceDir + "/" + source;
+		const std::string spirvPath = m_CacheDir + "/" + source + "." + hash + ".spv";
+		spirvPaths.push_back(spirvPath);
+
+		if (std::filesystem::exists(spirvPath))
+			continue;
+
+		// compiled to a temporary file, so a failed compilation never leaves a broken file in the cache
+		const std::string tempPath = spirvPath + ".tmp";
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		std::string output;
+		const int exitCode = RunCommand(
+			"\"" SHADERS_BASICS_GLSLC "\" \"" + sourcePath + "\" -o \"" + tempPath + "\"", output);
+		if (exitCode != 0)
+		{
+			Logger::Error("Failed to compile {}:\n{}", source, output);
+			std::remove(tempPath.c_str());
+			return false;
+		}
+
+		std::error_code error;
+		std::filesystem::rename(tempPath, spirvPath, error);
+		if (error)
+		{
+			Logger::Error("Failed to move {} into the shader cache: {}", source, error.message());
+			return false;
+		}
+
+		Logger::Info("Compiled {} in {:.2f} ms",
+			source,
+			std::chrono::duration<float, std::chrono::milliseconds::period>(
+				std::chrono::high_resolution_clock::now() - startTime)
+				.count());
+	}
+	return true;
+}
+
+uint64_t ShaderHotReloader::HashSources(const std::string& source) const
+{
+	uint64_t hash = HashBytes(ReadFile(m_SourceDir + "/" + source));
+
+	// any of the `.glsl` files could be included, in a stable order so the hash doesn't change
+	std::vector<std::filesystem::path> includes;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator{ m_SourceDir, error })
+	{
+		if (entry.path().extension() == ".glsl")
+			includes.push_back(entry.path());
+	}
+	std::sort(includes.begin(), includes.end());
+
+	for (const auto& include : includes)
+		hash = HashBytes(ReadFile(include), hash);
+	return hash;
+}
+
+std::filesystem::file_time_type ShaderHotReloader::GetLastWriteTime() const
+{
+	auto lastWriteTime = std::filesystem::file_time_type::min();
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator{ m_SourceDir, error })
+	{
+		if (!entry.is_regular_file(error))
+			continue;
+		lastWriteTime = std::max(lastWriteTime, entry.last_write_time(error));
+	}
+	return lastWriteTime;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * Recompiles the GLSL shaders of the running pipeline when their sources change
+ * A background thread polls the write times of the files in the source directory,
+ * and compiles the watched stages with `glslc` when anything changed. The SPIR-V is
+ * cached by the hash of the stage source and the included `.glsl` files, so reverting
+ * an edit or switching back to a shader doesn't compile it again.
+ */
+class ShaderHotReloader
+{
+public:
+	/**
+	 * @param sourceDir directory with the GLSL sources and the `.glsl` files they include
+	 * @param cacheDir directory the compiled SPIR-V is cached in
+	 */
+	ShaderHotReloader(std::string sourceDir, std::string cacheDir);
+	~ShaderHotReloader();
+
+	ShaderHotReloader(const ShaderHotReloader&) = delete;
+	ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+	/**
+	 * Sets the shader stages of the pipeline
+	 * @param sources file names of the stages in the source directory
+	 * @param compileNow compile the stages right away (when switching shaders) instead of on the next change
+	 */
+	void Watch(const std::vector<std::string>& sources, bool compileNow);
+	// SPIR-V paths of the watched stages (in the order passed to `Watch()`), if they were compiled since the last call
+	[[nodiscard]] std::optional<std::vector<std::string>> PollCompiled();
+
+private:
+	void Run();
+	// @returns false if any of the stages failed to compile (the error is logged)
+	bool Compile(const std::vector<std::string>& sources, std::vector<std::string>& spirvPaths) const;
+	// hash of the contents of `source` and of all the `.glsl` files
+	uint64_t HashSources(const std::string& source) const;
+	std::filesystem::file_time_type GetLastWriteTime() const;
+
+private:
+	// how often the source directory is checked for changes
+	static constexpr std::chrono::milliseconds s_PollInterval{ 250 };
+
+	std::string m_SourceDir;
+	std::string m_CacheDir;
+
+	std::thread m_Thread;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	// guarded by `m_Mutex`
+	bool m_Stop = false;
+	bool m_CompileNow = false;
+	std::vector<std::string> m_Sources;
+	std::optional<std::vector<std::string>> m_Compiled;
+};
@@ -0,0 +1,70 @@
+#include "engine/tileScheduler.h"
+
+#include <algorithm>
+
+
+TileScheduler::TileScheduler(float budgetMs)
+	: m_BudgetMs{ budgetMs }
+{}
+
+void TileScheduler::Restart()
+{
+	m_NextTile = 0;
+}
+
+void TileScheduler::Update(float tracingMs, uint32_t tileCount)
+{
+	if (tileCount == 0 || tracingMs <= 0.0f)
+		return;
+
+	const float tileMs = tracingMs / static_cast<float>(tileCount);
+	m_TileMs = m_TileMs > 0.0f ? m_TileMs + (tileMs - m_TileMs) * s_Smoothing : tileMs;
+}
+
+TileScheduler::Slice TileScheduler::NextSlice(VkExtent2D extent)
+{
+	const uint32_t tilesPerRow = (extent.width + s_TileSize - 1) / s_TileSize;
+	const uint32_t tileCount = tilesPerRow * ((extent.height + s_TileSize - 1) / s_TileSize);
+	if (tileCount != m_TileCount)
+	{
+		m_TileCount = tileCount;
+		m_NextTile = 0;
+	}
+
+	if (!IsEnabled())
+	{
+		m_TilesPerFrame = m_TileCount;
+	}
+	else if (m_TileMs > 0.0f)
+	{
+		m_TilesPerFrame =
+			static_cast<uint32_t>(std::clamp(m_BudgetMs / m_TileMs, 1.0f, static_cast<float>(m_TileCount)));
+	}
+	else
+	{
+		// the cost of a tile is unknown until the first slice has been measured
+		m_TilesPerFrame = 1;
+	}
+
+	const uint32_t remaining = m_TileCount - m_NextTile;
+	const Slice slice{ m_NextTile, std::min(m_TilesPerFrame, remaining), m_TilesPerFrame >= remaining };
+	m_NextTile = slice.completesPass ? 0 : m_NextTile + slice.tileCount;
+	return slice;
+}
+
+uint64_t TileScheduler::GetPixelCount(const Slice& slice, VkExtent2D extent)
+{
+	if (extent.width == 0 || extent.height == 0)
+		return 0;
+
+	const uint32_t tilesPerRow = (extent.width + s_TileSize - 1) / s_TileSize;
+	uint64_t pixelCount = 0;
+	for (uint32_t tile = slice.firstTile; tile < slice.firstTile + slice.tileCount; ++tile)
+	{
+		const uint32_t x = tile % tilesPerRow * s_TileSize;
+		const uint32_t y = tile / tilesPerRow * s_TileSize;
+		pixelCount +=
+			static_cast<uint64_t>(std::min(s_TileSize, extent.width - x)) * std::min(s_TileSize, extent.height - y);
+	}
+	return pixelCount;
+}
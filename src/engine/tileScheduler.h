@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+/**
+ * Time slicing of the ray traced image
+ * Splits every accumulation pass over the image into square tiles and picks how many of them
+ * are traced in a frame, so that the GPU time of the ray tracing stays within a budget (a long
+ * trace would freeze the ui and can trigger the driver's watchdog). The time per tile is learned
+ * from the measured time of the previous slices, and a pass can span several frames.
+ */
+class TileScheduler
+{
+public:
+	// consecutive tiles in row major order
+	struct Slice
+	{
+		uint32_t firstTile;
+		uint32_t tileCount;
+		bool completesPass; // the last tile of the pass is traced
+	};
+
+	// @param budgetMs GPU time of the ray tracing per frame, 0 traces the whole image every frame
+	explicit TileScheduler(float budgetMs);
+
+	// the next slice starts a new pass at the first tile, e.g. when the accumulation is reset
+	void Restart();
+
+	/**
+	 * @param tracingMs time of a previous slice
+	 * @param tileCount number of tiles of that slice (ignored if 0)
+	 */
+	void Update(float tracingMs, uint32_t tileCount);
+
+	/**
+	 * @param extent of the ray traced image, the pass restarts when its number of tiles changes
+	 * @returns the tiles traced in this frame
+	 */
+	[[nodiscard]] Slice NextSlice(VkExtent2D extent);
+
+	/**
+	 * @param slice tiles of a pass
+	 * @param extent of the ray traced image
+	 * @returns number of pixels of the tiles within the image (the edge tiles are clipped)
+	 */
+	[[nodiscard]] static uint64_t GetPixelCount(const Slice& slice, VkExtent2D extent);
+
+	inline void SetBudget(float budgetMs) { m_BudgetMs = budgetMs; }
+
+	[[nodiscard]] inline float GetBudget() const { return m_BudgetMs; }
+	[[nodiscard]] inline bool IsEnabled() const { return m_BudgetMs > 0.0f; }
+	// a pass doesn't fit into the budget of one frame
+	[[nodiscard]] inline bool IsSliced() const { return m_TilesPerFrame < m_TileCount; }
+	// tiles traced of the current pass
+	[[nodiscard]] inline uint32_t GetProgress() const { return m_NextTile; }
+	[[nodiscard]] inline uint32_t GetTileCount() const { return m_TileCount; }
+
+public:
+	// in pixels, a multiple of the work group size of `raytracing.comp`
+	static constexpr uint32_t s_TileSize = 64;
+
+private:
+	// weight of the last slice in the average time per tile
+	static constexpr float s_Smoothing = 0.2f;
+
+	float m_BudgetMs;
+	float m_TileMs = 0.0f; // average time per tile, 0 until a slice has been measured
+	uint32_t m_TileCount = 0; // of the current pass
+	uint32_t m_NextTile = 0;
+	uint32_t m_TilesPerFrame = 0;
+};
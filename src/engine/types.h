@@ -11,6 +11,7 @@ struct Config
 {
 public:
 	static bool enableValidationLayers;
+	// the per-frame resources are created for this many frames, `EngineProps::framesInFlight` of them are used
 	static uint32_t maxFramesInFlight;
 	static std::array<const char*, 1> validationLayers;
 	static std::array<const char*, 1> deviceExtensions;
@@ -22,6 +23,8 @@ struct QueueFamilyIndices
 	// we can check if it contains a value by calling has_value()
 	std::optional<uint32_t> graphicsFamily;
 	std::optional<uint32_t> presentFamily;
+	// queue family without graphics and compute support (usually a DMA engine), not required
+	std::optional<uint32_t> transferFamily;
 
 	[[nodiscard]] inline bool IsComplete() const { return graphicsFamily.has_value() && presentFamily.has_value(); }
 };
@@ -41,6 +44,7 @@ struct SwapchainCreateDetails
 	uint32_t imageCount;
 	VkSurfaceKHR windowSurface;
 	VkSurfaceTransformFlagBitsKHR currentTransform;
+	VkImageUsageFlags imageUsage;
 	QueueFamilyIndices queueFamilyIndices;
 };
 
@@ -107,9 +111,53 @@ struct UniformBufferObject
 	alignas(16) glm::vec3 resolution;
 	alignas(4) float time;
 	alignas(16) glm::vec3 cameraPos;
+	alignas(4) uint32_t frameIndex; // number of frames accumulated since the last reset
 	alignas(16) glm::mat4 model;
 	alignas(16) glm::mat4 viewProj;
 	alignas(16) glm::mat4 invView; // inverse view matrix
 	alignas(16) glm::mat4 invProj; // inverse projection matrix
 	alignas(16) glm::mat4 invViewProj; // inverse view-projection matrix
+	alignas(16) glm::mat4 prevViewProj; // view-projection matrix of the frame the history was accumulated in
+	alignas(16) glm::vec3 prevCameraPos;
+	alignas(4) uint32_t viewChanged; // since the history was accumulated, it's reprojected if it has (1)
+	alignas(4) uint32_t maxBounces; // of the paths, up to `MAX_BOUNCES` in `raytracing.glsl`
+};
+
+// push constants of `raytracing.comp` and `adaptive.comp`, the tiles traced by a dispatch (see `TileScheduler`)
+struct TraceTiles
+{
+	alignas(4) uint32_t firstTile;
+	alignas(4) uint32_t tileSize; // in pixels
+	// adaptive sampling if positive (see `adaptive.comp`), the noise level at which a pixel stops being sampled
+	alignas(4) float noiseThreshold;
+};
+
+// start of the pixel list of `adaptive.comp`, it's reset to no pixels and no work groups before every dispatch
+struct AdaptivePixelsHeader
+{
+	alignas(4) VkDispatchIndirectCommand groupCount; // of the indirect dispatch of `raytracing.comp`
+	alignas(4) uint32_t pixelCount;
+};
+
+// push constants of `wavefront.comp`, the tiles like `TraceTiles` and the bounce of the stage
+struct WavefrontPass
+{
+	alignas(4) uint32_t firstTile;
+	alignas(4) uint32_t tileSize; // in pixels
+	alignas(4) float noiseThreshold;
+	alignas(4) uint32_t bounce;
+};
+
+// queue of the paths of a stage of `wavefront.comp`, reset to no paths and no work groups before every dispatch
+struct WavefrontQueueHeader
+{
+	alignas(4) VkDispatchIndirectCommand groupCount; // of the indirect dispatch of the stage reading the queue
+	alignas(4) uint32_t count;
+};
+
+// push constants of `denoise.comp`, one dispatch per iteration
+struct DenoiseIteration
+{
+	alignas(4) uint32_t iteration; // the taps are `2^iteration` pixels apart
+	alignas(4) uint32_t iterationCount;
 };
@@ -0,0 +1,60 @@
+#include "engine/uniformRingBuffer.h"
+
+#include <algorithm>
+#include <cstring>
+#include "core/core.h"
+#include "utils/utils.h"
+
+namespace {
+
+VkDeviceSize AlignUp(VkDeviceSize value, VkDeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+
+UniformRingBuffer::UniformRingBuffer(VkDevice deviceVk,
+	MemoryAllocator& allocator,
+	const VkPhysicalDeviceLimits& limits,
+	VkDeviceSize frameSize,
+	uint32_t frameCount)
+	: m_DeviceVk{ deviceVk },
+	  m_Allocator{ allocator },
+	  m_Alignment{ std::max<VkDeviceSize>(limits.minUniformBufferOffsetAlignment, 1) }
+{
+	m_FrameSize = AlignUp(frameSize, m_Alignment);
+	// the dynamic offsets are 32 bit
+	THROW(m_FrameSize * frameCount > UINT32_MAX, "Uniform ring buffer is too large!")
+
+	utils::CreateBuffer(m_DeviceVk,
+		m_Allocator,
+		m_FrameSize * frameCount,
+		VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+		VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+		m_Buffer,
+		m_Allocation);
+}
+
+UniformRingBuffer::~UniformRingBuffer()
+{
+	vkDestroyBuffer(m_DeviceVk, m_Buffer, nullptr);
+	m_Allocator.Free(m_Allocation);
+}
+
+void UniformRingBuffer::BeginFrame(uint32_t frameIndex)
+{
+	m_FrameBegin = m_FrameSize * frameIndex;
+	m_Head = m_FrameBegin;
+}
+
+uint32_t UniformRingBuffer::Push(const void* data, VkDeviceSize size)
+{
+	const VkDeviceSize offset = m_Head;
+	THROW(offset + size > m_FrameBegin + m_FrameSize, "Uniform ring buffer region of the frame is full!")
+
+	memcpy(static_cast<uint8_t*>(m_Allocation.mappedData) + offset, data, size);
+	m_Head = AlignUp(offset + size, m_Alignment);
+	return static_cast<uint32_t>(offset);
+}
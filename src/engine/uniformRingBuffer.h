@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vulkan/vulkan.h>
+#include "engine/memoryAllocator.h"
+
+/**
+ * Persistently mapped, host coherent uniform buffer shared by all frames in flight
+ * Every frame owns a fixed region of the buffer, `Push()` appends data to the region
+ * of the current frame and returns its offset, which is passed as the dynamic offset
+ * of an `UNIFORM_BUFFER_DYNAMIC` descriptor. A region is reused once the previous frame of
+ * its slot has been waited on, so the data is written without any map/unmap calls.
+ */
+class UniformRingBuffer
+{
+public:
+	/**
+	 * @param frameSize size of the region of every frame (rounded up to the offset alignment)
+	 * @param frameCount number of frames in flight
+	 */
+	UniformRingBuffer(VkDevice deviceVk,
+		MemoryAllocator& allocator,
+		const VkPhysicalDeviceLimits& limits,
+		VkDeviceSize frameSize,
+		uint32_t frameCount);
+	~UniformRingBuffer();
+
+	UniformRingBuffer(const UniformRingBuffer&) = delete;
+	UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+	// starts writing at the beginning of the region of `frameIndex`, its previous data must no longer be in use
+	void BeginFrame(uint32_t frameIndex);
+
+	/**
+	 * Copies `data` into the region of the current frame
+	 * @return dynamic offset of the data
+	 */
+	[[nodiscard]] uint32_t Push(const void* data, VkDeviceSize size);
+	template<typename T>
+	[[nodiscard]] inline uint32_t Push(const T& data)
+	{
+		return Push(&data, sizeof(T));
+	}
+
+	[[nodiscard]] inline VkBuffer GetBuffer() const { return m_Buffer; }
+
+private:
+	VkDevice m_DeviceVk;
+	MemoryAllocator& m_Allocator;
+
+	VkBuffer m_Buffer = VK_NULL_HANDLE;
+	Allocation m_Allocation{};
+
+	VkDeviceSize m_Alignment; // minUniformBufferOffsetAlignment
+	VkDeviceSize m_FrameSize;
+	VkDeviceSize m_FrameBegin = 0;
+	VkDeviceSize m_Head = 0; // next free offset in the region of the current frame
+};
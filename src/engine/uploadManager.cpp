@@ -0,0 +1,353 @@
+#include "engine/uploadManager.h"
+
+#include <cstring>
+#include "core/core.h"
+#include "utils/utils.h"
+
+
+UploadManager::UploadManager(VkDevice deviceVk,
+	MemoryAllocator& allocator,
+	uint32_t queueFamilyIndex,
+	VkQueue queue,
+	uint32_t dstQueueFamilyIndex,
+	VkDeviceSize stagingSize)
+	: m_DeviceVk{ deviceVk },
+	  m_Allocator{ allocator },
+	  m_QueueFamilyIndex{ queueFamilyIndex },
+	  m_Queue{ queue },
+	  m_DstQueueFamilyIndex{ dstQueueFamilyIndex },
+	  m_StagingSize{ stagingSize }
+{
+	VkCommandPoolCreateInfo commandPoolInfo{};
+	commandPoolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	commandPoolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	commandPoolInfo.queueFamilyIndex = m_QueueFamilyIndex;
+	THROW(vkCreateCommandPool(m_DeviceVk, &commandPoolInfo, nullptr, &m_CommandPool) != VK_SUCCESS,
+		"Failed to create upload command pool!")
+
+	utils::CreateBuffer(m_DeviceVk,
+		m_Allocator,
+		m_StagingSize,
+		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_StagingBuffer,
+		m_StagingAllocation);
+}
+
+UploadManager::~UploadManager()
+{
+	// recorded but never submitted
+	if (m_RecordingBatch)
+	{
+		vkEndCommandBuffer(m_RecordingBatch->cmdBuff);
+		Release(*m_RecordingBatch);
+		m_FreeBatches.push_back(std::move(*m_RecordingBatch));
+	}
+	while (!m_InFlightBatches.empty())
+		Collect(true);
+
+	for (const Batch& batch : m_FreeBatches)
+		vkDestroyFence(m_DeviceVk, batch.fence, nullptr);
+	vkDestroyCommandPool(m_DeviceVk, m_CommandPool, nullptr);
+
+	vkDestroyBuffer(m_DeviceVk, m_StagingBuffer, nullptr);
+	m_Allocator.Free(m_StagingAllocation);
+}
+
+void UploadManager::UploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset)
+{
+	if (size == 0)
+		return;
+
+	void* mappedData = nullptr;
+	const auto [stagingBuffer, stagingOffset] = AllocateStaging(size, &mappedData);
+	memcpy(mappedData, data, static_cast<size_t>(size));
+
+	Batch& batch = GetRecordingBatch();
+	VkBufferCopy copyRegion{};
+	copyRegion.srcOffset = stagingOffset;
+	copyRegion.dstOffset = dstOffset;
+	copyRegion.size = size;
+	vkCmdCopyBuffer(batch.cmdBuff, stagingBuffer, dstBuffer, 1, &copyRegion);
+
+	VkBufferMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.srcQueueFamilyIndex = m_QueueFamilyIndex;
+	barrier.dstQueueFamilyIndex = m_DstQueueFamilyIndex;
+	barrier.buffer = dstBuffer;
+	barrier.offset = dstOffset;
+	barrier.size = size;
+	batch.bufferBarriers.push_back(barrier);
+}
+
+void UploadManager::UploadImage(VkImage image,
+	uint32_t width,
+	uint32_t height,
+	const void* data,
+	VkDeviceSize size,
+	VkImageLayout finalLayout)
+{
+	void* mappedData = nullptr;
+	const auto [stagingBuffer, stagingOffset] = AllocateStaging(size, &mappedData);
+	memcpy(mappedData, data, static_cast<size_t>(size));
+
+	Batch& batch = GetRecordingBatch();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+	vkCmdPipelineBarrier(batch.cmdBuff,
+		VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0,
+		0,
+		nullptr,
+		0,
+		nullptr,
+		1,
+		&barrier);
+
+	VkBufferImageCopy region{};
+	region.bufferOffset = stagingOffset;
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageExtent = { width, height, 1 };
+	vkCmdCopyBufferToImage(batch.cmdBuff, stagingBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	// the layout transition to `finalLayout` is part of the queue family ownership transfer
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	barrier.srcQueueFamilyIndex = m_QueueFamilyIndex;
+	barrier.dstQueueFamilyIndex = m_DstQueueFamilyIndex;
+	batch.imageBarriers.push_back(barrier);
+}
+
+UploadTicket UploadManager::Submit()
+{
+	if (!m_RecordingBatch)
+		return m_NextTicket - 1;
+
+	Batch batch = std::move(*m_RecordingBatch);
+	m_RecordingBatch.reset();
+
+	AcquireBarriers& acquireBarriers = m_AcquireBarriers[batch.ticket];
+	acquireBarriers.bufferBarriers = std::move(batch.bufferBarriers);
+	acquireBarriers.imageBarriers = std::move(batch.imageBarriers);
+
+	// the other half of the ownership transfer, the destination access is ignored
+	if (m_QueueFamilyIndex != m_DstQueueFamilyIndex)
+	{
+		std::vector<VkBufferMemoryBarrier> bufferReleases = acquireBarriers.bufferBarriers;
+		for (auto& barrier : bufferReleases)
+			barrier.dstAccessMask = 0;
+		std::vector<VkImageMemoryBarrier> imageReleases = acquireBarriers.imageBarriers;
+		for (auto& barrier : imageReleases)
+			barrier.dstAccessMask = 0;
+
+		vkCmdPipelineBarrier(batch.cmdBuff,
+			VK_PIPELINE_STAGE_TRANSFER_BIT,
+			VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+			0,
+			0,
+			nullptr,
+			static_cast<uint32_t>(bufferReleases.size()),
+			bufferReleases.data(),
+			static_cast<uint32_t>(imageReleases.size()),
+			imageReleases.data());
+	}
+	THROW(vkEndCommandBuffer(batch.cmdBuff) != VK_SUCCESS, "Failed to record upload command buffer!")
+
+	VkSubmitInfo submitInfo{};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.cmdBuff;
+	THROW(vkQueueSubmit(m_Queue, 1, &submitInfo, batch.fence) != VK_SUCCESS, "Failed to submit uploads!")
+
+	const UploadTicket ticket = batch.ticket;
+	m_InFlightBatches.push_back(std::move(batch));
+	return ticket;
+}
+
+bool UploadManager::IsComplete(UploadTicket ticket)
+{
+	Collect(false);
+	return ticket <= m_CompletedTicket;
+}
+
+void UploadManager::Wait(UploadTicket ticket)
+{
+	THROW(m_RecordingBatch && ticket >= m_RecordingBatch->ticket, "Waiting for uploads that were not submitted!")
+	while (ticket > m_CompletedTicket)
+		Collect(true);
+}
+
+void UploadManager::RecordAcquireBarriers(VkCommandBuffer cmdBuff,
+	UploadTicket ticket,
+	VkPipelineStageFlags dstStageMask,
+	VkAccessFlags dstAccessMask)
+{
+	THROW(ticket > m_CompletedTicket, "Acquiring uploads that have not completed!")
+
+	// also the batches submitted in between, e.g. when the staging ring was full
+	std::vector<VkBufferMemoryBarrier> bufferBarriers;
+	std::vector<VkImageMemoryBarrier> imageBarriers;
+	const auto end = m_AcquireBarriers.upper_bound(ticket);
+	for (auto it = m_AcquireBarriers.begin(); it != end; ++it)
+	{
+		bufferBarriers.insert(bufferBarriers.end(), it->second.bufferBarriers.begin(), it->second.bufferBarriers.end());
+		imageBarriers.insert(imageBarriers.end(), it->second.imageBarriers.begin(), it->second.imageBarriers.end());
+	}
+	m_AcquireBarriers.erase(m_AcquireBarriers.begin(), end);
+	if (bufferBarriers.empty() && imageBarriers.empty())
+		return;
+
+	// the release barriers have been executed on the upload queue, the source access only matters without them
+	const bool isOwnershipTransfer = m_QueueFamilyIndex != m_DstQueueFamilyIndex;
+	for (auto& barrier : bufferBarriers)
+	{
+		barrier.srcAccessMask = isOwnershipTransfer ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccessMask;
+	}
+	for (auto& barrier : imageBarriers)
+	{
+		barrier.srcAccessMask = isOwnershipTransfer ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = dstAccessMask;
+	}
+
+	vkCmdPipelineBarrier(cmdBuff,
+		isOwnershipTransfer ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+		dstStageMask,
+		0,
+		0,
+		nullptr,
+		static_cast<uint32_t>(bufferBarriers.size()),
+		bufferBarriers.data(),
+		static_cast<uint32_t>(imageBarriers.size()),
+		imageBarriers.data());
+}
+
+std::pair<VkBuffer, VkDeviceSize> UploadManager::AllocateStaging(VkDeviceSize size, void** mappedData)
+{
+	const VkDeviceSize alignedSize = (size + s_StagingAlignment - 1) / s_StagingAlignment * s_StagingAlignment;
+
+	// too large for the ring
+	if (alignedSize > m_StagingSize / 2)
+	{
+		Batch& batch = GetRecordingBatch();
+		batch.stagingBuffers.emplace_back();
+		batch.stagingAllocations.emplace_back();
+		utils::CreateBuffer(m_DeviceVk,
+			m_Allocator,
+			size,
+			VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			batch.stagingBuffers.back(),
+			batch.stagingAllocations.back());
+		*mappedData = batch.stagingAllocations.back().mappedData;
+		return { batch.stagingBuffers.back(), 0 };
+	}
+
+	while (true)
+	{
+		if (m_StagingUsed == 0)
+			m_StagingHead = 0;
+
+		// the space at the end of the ring is skipped if the data doesn't fit there
+		const bool wrapAround = m_StagingHead + alignedSize > m_StagingSize;
+		const VkDeviceSize skipped = wrapAround ? m_StagingSize - m_StagingHead : 0;
+		if (skipped + alignedSize <= m_StagingSize - m_StagingUsed)
+		{
+			const VkDeviceSize offset = wrapAround ? 0 : m_StagingHead;
+			m_StagingHead = offset + alignedSize;
+			m_StagingUsed += skipped + alignedSize;
+			GetRecordingBatch().stagingBytes += skipped + alignedSize;
+
+			*mappedData = static_cast<uint8_t*>(m_StagingAllocation.mappedData) + offset;
+			return { m_StagingBuffer, offset };
+		}
+
+		// the ring is full, the recorded uploads have to finish before their space can be reused
+		if (m_InFlightBatches.empty())
+			static_cast<void>(Submit());
+		Collect(true);
+	}
+}
+
+UploadManager::Batch& UploadManager::GetRecordingBatch()
+{
+	if (m_RecordingBatch)
+		return *m_RecordingBatch;
+
+	if (!m_FreeBatches.empty())
+	{
+		m_RecordingBatch = std::move(m_FreeBatches.back());
+		m_FreeBatches.pop_back();
+		THROW(vkResetFences(m_DeviceVk, 1, &m_RecordingBatch->fence) != VK_SUCCESS, "Failed to reset upload fence!")
+	}
+	else
+	{
+		m_RecordingBatch.emplace();
+		VkCommandBufferAllocateInfo cmdBuffAllocInfo{};
+		cmdBuffAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cmdBuffAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cmdBuffAllocInfo.commandPool = m_CommandPool;
+		cmdBuffAllocInfo.commandBufferCount = 1;
+		THROW(vkAllocateCommandBuffers(m_DeviceVk, &cmdBuffAllocInfo, &m_RecordingBatch->cmdBuff) != VK_SUCCESS,
+			"Failed to allocate upload command buffer!")
+
+		VkFenceCreateInfo fenceInfo{};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+		THROW(vkCreateFence(m_DeviceVk, &fenceInfo, nullptr, &m_RecordingBatch->fence) != VK_SUCCESS,
+			"Failed to create upload fence!")
+	}
+
+	m_RecordingBatch->ticket = m_NextTicket++;
+	m_RecordingBatch->stagingBytes = 0;
+
+	VkCommandBufferBeginInfo cmdBuffBeginInfo{};
+	cmdBuffBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	cmdBuffBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	THROW(vkBeginCommandBuffer(m_RecordingBatch->cmdBuff, &cmdBuffBeginInfo) != VK_SUCCESS,
+		"Failed to begin recording upload command buffer!")
+	return *m_RecordingBatch;
+}
+
+void UploadManager::Collect(bool waitForOldest)
+{
+	if (waitForOldest && !m_InFlightBatches.empty())
+		vkWaitForFences(m_DeviceVk, 1, &m_InFlightBatches.front().fence, VK_TRUE, UINT64_MAX);
+
+	while (!m_InFlightBatches.empty() && vkGetFenceStatus(m_DeviceVk, m_InFlightBatches.front().fence) == VK_SUCCESS)
+	{
+		Batch& batch = m_InFlightBatches.front();
+		m_CompletedTicket = batch.ticket;
+		Release(batch);
+		m_FreeBatches.push_back(std::move(batch));
+		m_InFlightBatches.pop_front();
+	}
+}
+
+void UploadManager::Release(Batch& batch)
+{
+	m_StagingUsed -= batch.stagingBytes;
+	batch.stagingBytes = 0;
+
+	for (size_t i = 0; i < batch.stagingBuffers.size(); ++i)
+	{
+		vkDestroyBuffer(m_DeviceVk, batch.stagingBuffers[i], nullptr);
+		m_Allocator.Free(batch.stagingAllocations[i]);
+	}
+	batch.stagingBuffers.clear();
+	batch.stagingAllocations.clear();
+	batch.bufferBarriers.clear();
+	batch.imageBarriers.clear();
+	vkResetCommandBuffer(batch.cmdBuff, 0);
+}
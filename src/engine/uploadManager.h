@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <optional>
+#include <utility>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "engine/memoryAllocator.h"
+
+// identifies a submitted batch of uploads, see `UploadManager::Submit()`
+using UploadTicket = uint64_t;
+
+/**
+ * Batched, asynchronous uploads to device local buffers and images
+ * The data is copied into a persistently mapped staging ring buffer, and the copies
+ * are recorded into one command buffer until `Submit()`, which doesn't wait for them.
+ * The completion is tracked with a fence per batch, and the staging memory of a batch
+ * is reused once it has completed. Data larger than the ring gets its own staging buffer.
+ *
+ * The uploads run on the given queue, preferably a dedicated transfer queue. The
+ * resources are then owned by its queue family and have to be acquired by the queue
+ * family that uses them with `RecordAcquireBarriers()` (which also makes the writes
+ * visible when both are the same family).
+ * Not thread safe, uploads are recorded by the thread that owns the manager.
+ */
+class UploadManager
+{
+public:
+	/**
+	 * @param queueFamilyIndex family of `queue`, the uploads run on
+	 * @param dstQueueFamilyIndex family of the queue that uses the uploaded resources
+	 * @param stagingSize size of the staging ring buffer
+	 */
+	UploadManager(VkDevice deviceVk,
+		MemoryAllocator& allocator,
+		uint32_t queueFamilyIndex,
+		VkQueue queue,
+		uint32_t dstQueueFamilyIndex,
+		VkDeviceSize stagingSize);
+	~UploadManager();
+
+	UploadManager(const UploadManager&) = delete;
+	UploadManager& operator=(const UploadManager&) = delete;
+
+	/**
+	 * Records a copy of `data` to `dstBuffer` (created with `VK_BUFFER_USAGE_TRANSFER_DST_BIT`)
+	 * `data` is copied right away and can be freed after the call.
+	 */
+	void UploadBuffer(VkBuffer dstBuffer, const void* data, VkDeviceSize size, VkDeviceSize dstOffset = 0);
+	/**
+	 * Records a copy of tightly packed pixels to mip level 0 of a color image (created with
+	 * `VK_IMAGE_USAGE_TRANSFER_DST_BIT`), whose contents are discarded
+	 * @param finalLayout layout of the image after it has been acquired
+	 */
+	void UploadImage(VkImage image,
+		uint32_t width,
+		uint32_t height,
+		const void* data,
+		VkDeviceSize size,
+		VkImageLayout finalLayout);
+
+	// submits the recorded uploads without waiting for them
+	[[nodiscard]] UploadTicket Submit();
+	[[nodiscard]] bool IsComplete(UploadTicket ticket);
+	void Wait(UploadTicket ticket);
+
+	/**
+	 * Records the barriers that hand the resources of the completed batches up to `ticket`
+	 * over to the destination queue family, before the resources are used
+	 * @param dstStageMask stages that use the resources
+	 * @param dstAccessMask how the resources are accessed
+	 */
+	void RecordAcquireBarriers(VkCommandBuffer cmdBuff,
+		UploadTicket ticket,
+		VkPipelineStageFlags dstStageMask,
+		VkAccessFlags dstAccessMask);
+
+private:
+	struct Batch
+	{
+		UploadTicket ticket = 0;
+		VkCommandBuffer cmdBuff = VK_NULL_HANDLE;
+		VkFence fence = VK_NULL_HANDLE;
+		VkDeviceSize stagingBytes = 0; // consumed from the ring, including the space skipped when wrapping around
+
+		// staging buffers of uploads that don't fit into the ring
+		std::vector<VkBuffer> stagingBuffers;
+		std::vector<Allocation> stagingAllocations;
+
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+	};
+
+	struct AcquireBarriers
+	{
+		std::vector<VkBufferMemoryBarrier> bufferBarriers;
+		std::vector<VkImageMemoryBarrier> imageBarriers;
+	};
+
+	// @returns staging buffer and offset with room for `size` bytes, submits and waits when the ring is full
+	std::pair<VkBuffer, VkDeviceSize> AllocateStaging(VkDeviceSize size, void** mappedData);
+	Batch& GetRecordingBatch();
+	// reclaims the completed batches (in submission order), optionally waiting for the oldest one
+	void Collect(bool waitForOldest);
+	void Release(Batch& batch);
+
+private:
+	// offsets into the ring are kept aligned for buffer and image copies
+	static constexpr VkDeviceSize s_StagingAlignment = 16;
+
+	VkDevice m_DeviceVk;
+	MemoryAllocator& m_Allocator;
+	uint32_t m_QueueFamilyIndex;
+	VkQueue m_Queue;
+	uint32_t m_DstQueueFamilyIndex;
+
+	VkCommandPool m_CommandPool = VK_NULL_HANDLE;
+
+	VkBuffer m_StagingBuffer = VK_NULL_HANDLE;
+	Allocation m_StagingAllocation{};
+	VkDeviceSize m_StagingSize;
+	VkDeviceSize m_StagingHead = 0; // next free offset
+	VkDeviceSize m_StagingUsed = 0; // bytes of the recording and in-flight batches
+
+	UploadTicket m_NextTicket = 1;
+	UploadTicket m_CompletedTicket = 0; // batches complete in submission order
+	std::optional<Batch> m_RecordingBatch;
+	std::deque<Batch> m_InFlightBatches;
+	std::vector<Batch> m_FreeBatches; // command buffers and fences to reuse
+	std::map<UploadTicket, AcquireBarriers> m_AcquireBarriers; // of the submitted batches that were not acquired yet
+};
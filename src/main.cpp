@@ -1,11 +1,254 @@
+#include <chrono>
+#include <cstring>
+#include <string>
 #include "core/core.h"
+#include "core/profiler.h"
 #include "engine/engine.h"
+#include "engine/cpuRayTracer.h"
 
-int main()
+struct CpuTracerOptions
+{
+	bool enabled = false;
+	uint32_t threadCount = 0; // 0 = all hardware threads
+};
+
+/**
+ * Parses the command line arguments
+ * --headless          render without a window into an offscreen image
+ * --width <pixels>    width of the window/offscreen image
+ * --height <pixels>   height of the window/offscreen image
+ * --frames <count>    number of frames rendered in headless mode
+ * --output <path>     path of the image (.ppm) written after the last headless frame
+ * --cpu               render (headless) with the multithreaded CPU ray tracer instead of Vulkan
+ * --threads <count>   number of threads used by the CPU ray tracer
+ * --fragment          trace rays in a fullscreen fragment pass instead of the compute shader
+ * --spheres <count>   number of random spheres added to the scene
+ * --mesh <path>       .obj mesh added to the scene
+ * --trace <path>      Chrome trace (.json) of the CPU scopes written at exit
+ * --present-mode <m>  immediate, mailbox (default), fifo or fifo-relaxed
+ * --render-scale <s>  resolution of the ray traced image relative to the window (0.25 to 1), upscaled to it
+ * --target-frame-time <ms> the render scale adapts to keep the GPU frame time close to it
+ * --trace-budget <ms> GPU time of the ray tracing per frame, longer traces are split into tiles over several frames
+ * --denoise <count>   iterations of the a-trous denoiser (0 to 5, 0 disables it)
+ * --no-reprojection   restart the accumulation when the camera moves instead of reprojecting the samples
+ * --max-bounces <count> bounces of the ray traced paths (1 to 64)
+ * --noise-threshold <t> adaptive sampling, pixels whose noise (standard error, 0 to 1) is lower aren't sampled
+ * --wavefront         trace the paths in stages with one kernel per material (compute path)
+ * --frames-in-flight <count> number of frames recorded while the device works on the previous ones
+ * @returns false if the arguments are invalid
+ */
+static bool ParseArgs(int argc, char** argv, EngineProps& props, CpuTracerOptions& cpuOptions)
+{
+	try
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const char* arg = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (std::strcmp(arg, "--headless") == 0)
+			{
+				props.headless = true;
+			}
+			else if (std::strcmp(arg, "--width") == 0 && hasValue)
+			{
+				props.width = std::stoull(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--height") == 0 && hasValue)
+			{
+				props.height = std::stoull(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--frames") == 0 && hasValue)
+			{
+				props.frameCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--output") == 0 && hasValue)
+			{
+				props.outputPath = argv[++i];
+			}
+			else if (std::strcmp(arg, "--cpu") == 0)
+			{
+				cpuOptions.enabled = true;
+				props.headless = true;
+			}
+			else if (std::strcmp(arg, "--threads") == 0 && hasValue)
+			{
+				cpuOptions.threadCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--fragment") == 0)
+			{
+				props.computeRayTracing = false;
+			}
+			else if (std::strcmp(arg, "--spheres") == 0 && hasValue)
+			{
+				props.sphereCount = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--mesh") == 0 && hasValue)
+			{
+				props.meshPath = argv[++i];
+			}
+			else if (std::strcmp(arg, "--trace") == 0 && hasValue)
+			{
+				props.tracePath = argv[++i];
+			}
+			else if (std::strcmp(arg, "--present-mode") == 0 && hasValue)
+			{
+				const char* mode = argv[++i];
+				if (std::strcmp(mode, "immediate") == 0)
+				{
+					props.presentMode = VK_PRESENT_MODE_IMMEDIATE_KHR;
+				}
+				else if (std::strcmp(mode, "mailbox") == 0)
+				{
+					props.presentMode = VK_PRESENT_MODE_MAILBOX_KHR;
+				}
+				else if (std::strcmp(mode, "fifo") == 0)
+				{
+					props.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+				}
+				else if (std::strcmp(mode, "fifo-relaxed") == 0)
+				{
+					props.presentMode = VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+				}
+				else
+				{
+					Logger::Error("Invalid present mode: {}", mode);
+					return false;
+				}
+			}
+			else if (std::strcmp(arg, "--frames-in-flight") == 0 && hasValue)
+			{
+				props.framesInFlight = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--render-scale") == 0 && hasValue)
+			{
+				props.renderScale = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--target-frame-time") == 0 && hasValue)
+			{
+				props.targetFrameTime = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--trace-budget") == 0 && hasValue)
+			{
+				props.traceBudget = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--denoise") == 0 && hasValue)
+			{
+				props.denoiseIterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--no-reprojection") == 0)
+			{
+				props.reprojection = false;
+			}
+			else if (std::strcmp(arg, "--max-bounces") == 0 && hasValue)
+			{
+				props.maxBounces = static_cast<uint32_t>(std::stoul(argv[++i]));
+			}
+			else if (std::strcmp(arg, "--noise-threshold") == 0 && hasValue)
+			{
+				props.noiseThreshold = std::stof(argv[++i]);
+			}
+			else if (std::strcmp(arg, "--wavefront") == 0)
+			{
+				props.wavefront = true;
+			}
+			else
+			{
+				Logger::Error("Invalid argument: {}", arg);
+				return false;
+			}
+		}
+	}
+	catch (const std::exception&)
+	{
+		Logger::Error("Invalid argument value!");
+		return false;
+	}
+
+	if (props.width == 0 || props.height == 0 || props.frameCount == 0)
+	{
+		Logger::Error("Width, height and frame count must be greater than 0!");
+		return false;
+	}
+
+	return true;
+}
+
+/**
+ * Renders `props.frameCount` samples per pixel with the CPU ray tracer and saves the image
+ */
+static void RunCpuRayTracer(const EngineProps& props, const CpuTracerOptions& cpuOptions)
+{
+	const Scene scene =
+		Scene::CreateDefault(props.sphereCount, props.meshPath.empty() ? nullptr : props.meshPath.c_str());
+	Logger::Info("Scene: {} sphere(s), {} triangle(s), BVH: {} node(s), depth {}",
+		scene.GetSpheres().size(),
+		scene.GetTriangles().size(),
+		scene.GetBvh().GetNodes().size(),
+		scene.GetBvh().GetDepth());
+	CpuRayTracer tracer{
+		scene, static_cast<uint32_t>(props.width), static_cast<uint32_t>(props.height), cpuOptions.threadCount
+	};
+	tracer.SetMaxBounces(props.maxBounces);
+	Camera camera{ static_cast<float>(props.width) / static_cast<float>(props.height) };
+	camera.UpdateMatrices();
+
+	Logger::Info(
+		"CPU ray tracer: {}x{} on {} thread(s)", tracer.GetWidth(), tracer.GetHeight(), tracer.GetThreadCount());
+
+	std::chrono::time_point<std::chrono::high_resolution_clock> startTime = std::chrono::high_resolution_clock::now();
+	for (uint32_t i = 0; i < props.frameCount; ++i)
+		tracer.Render(camera);
+
+	float elapsed = std::chrono::duration<float, std::chrono::seconds::period>(
+		std::chrono::high_resolution_clock::now() - startTime)
+						.count();
+	Logger::Info("Rendered {} sample(s) per pixel in {:.3f} s ({:.2f} Mrays/s)",
+		tracer.GetSampleCount(),
+		elapsed,
+		static_cast<float>(tracer.GetRayCount()) / elapsed / 1.0e6f);
+
+	tracer.SaveImage(props.outputPath.c_str());
+}
+
+int main(int argc, char** argv)
 {
 	Logger::Init();
+	Profiler::SetThreadName("Main");
+
+	EngineProps props{ "Shaders Basics", 1600, 900 };
+	CpuTracerOptions cpuOptions{};
+	if (!ParseArgs(argc, argv, props, cpuOptions))
+	{
+		Logger::Info("Usage: {} [--headless] [--width <pixels>] [--height <pixels>] [--frames <count>] [--output "
+					 "<path.ppm>] [--cpu] [--threads <count>] [--fragment] [--spheres <count>] [--mesh <path.obj>] "
+					 "[--trace <path.json>] [--present-mode <immediate|mailbox|fifo|fifo-relaxed>] [--frames-in-flight "
+					 "<count>] [--render-scale <scale>] [--target-frame-time <ms>] [--trace-budget <ms>] "
+					 "[--denoise <count>] [--no-reprojection] [--max-bounces <count>] "
+					 "[--noise-threshold <t>] [--wavefront]",
+			argv[0]);
+		return 1;
+	}
+
+	if (cpuOptions.enabled)
+	{
+		RunCpuRayTracer(props, cpuOptions);
+		return 0;
+	}
+
+	try
+	{
+		Engine* engine = Engine::Create(props);
+		engine->Run();
+		delete engine;
+	}
+	catch (const std::exception& e)
+	{
+		// without a usable Vulkan device, headless renders fall back to the CPU ray tracer
+		if (!props.headless)
+			throw;
 
-	Engine* engine = Engine::Create("Shaders Basics", 1600, 900);
-	engine->Run();
-	delete engine;
+		Logger::Warn("Vulkan renderer failed ({}), falling back to the CPU ray tracer", e.what());
+		RunCpuRayTracer(props, cpuOptions);
+	}
 }
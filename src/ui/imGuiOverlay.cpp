@@ -3,6 +3,7 @@
 #include "imgui/backends/imgui_impl_glfw.h"
 #include "imgui/backends/imgui_impl_vulkan.h"
 #include "core/core.h"
+#include "core/profiler.h"
 #include "engine/engine.h"
 #include "engine/initializers.h"
 #include "utils/utils.h"
@@ -85,6 +86,7 @@ void ImGuiOverlay::Cleanup(VkDevice deviceVk)
 
 void ImGuiOverlay::Begin()
 {
+	PROFILE_SCOPE("ImGuiOverlay::Begin");
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
@@ -92,6 +94,7 @@ void ImGuiOverlay::Begin()
 
 void ImGuiOverlay::End(VkCommandBuffer commandBuffer)
 {
+	PROFILE_SCOPE("ImGuiOverlay::End");
 	ImGui::Render();
 	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), commandBuffer);
 }
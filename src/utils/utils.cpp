@@ -2,6 +2,7 @@
 
 #include <set>
 #include <string>
+#include <fstream>
 #include "core/core.h"
 #include "core/window.h"
 #include "engine/engine.h"
@@ -50,11 +51,16 @@ bool CheckValidationLayerSupport()
 	return true;
 }
 
-std::vector<const char*> GetRequiredExtensions()
+std::vector<const char*> GetRequiredExtensions(bool headless)
 {
-	uint32_t extensionCount = 0;
-	const char** extensions = Window::GetRequiredVulkanExtensions(&extensionCount);
-	std::vector<const char*> availableExtensions{ extensions, extensions + extensionCount };
+	// there is no window surface in headless mode, so no window extensions are required
+	std::vector<const char*> availableExtensions{};
+	if (!headless)
+	{
+		uint32_t extensionCount = 0;
+		const char** extensions = Window::GetRequiredVulkanExtensions(&extensionCount);
+		availableExtensions.assign(extensions, extensions + extensionCount);
+	}
 
 	if (Config::enableValidationLayers)
 		availableExtensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -66,8 +72,22 @@ std::vector<const char*> GetRequiredExtensions()
 // device details functions
 bool IsDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurface)
 {
+	// the frames are tracked with a timeline semaphore (core and required in Vulkan 1.2)
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	if (properties.apiVersion < VK_API_VERSION_1_2)
+		return false;
+
 	QueueFamilyIndices indicies = FindQueueFamilies(physicalDevice, windowSurface);
 
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
+	// headless mode (no window surface) only needs a graphics queue
+	if (windowSurface == VK_NULL_HANDLE)
+		return indicies.IsComplete() && supportedFeatures.samplerAnisotropy
+			   && supportedFeatures.fragmentStoresAndAtomics;
+
 	// checking for extension availability like swapchain extension availability
 	bool extensionsSupported = CheckDeviceExtensionSupport(physicalDevice);
 
@@ -79,10 +99,8 @@ bool IsDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurfac
 		swapchainAdequate = !swapchainSupport.formats.empty() && !swapchainSupport.presentModes.empty();
 	}
 
-	VkPhysicalDeviceFeatures supportedFeatures;
-	vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
-
-	return indicies.IsComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy;
+	return indicies.IsComplete() && extensionsSupported && swapchainAdequate && supportedFeatures.samplerAnisotropy
+		   && supportedFeatures.fragmentStoresAndAtomics;
 }
 
 bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
@@ -100,21 +118,6 @@ bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice)
 	return requiredExtensions.empty();
 }
 
-uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties)
-{
-	VkPhysicalDeviceMemoryProperties memProperties;
-	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
-
-	for (uint32_t i = 0; i < memProperties.memoryTypeCount; ++i)
-	{
-		// typeFilter specifies a bit field of memory types
-		if (typeFilter & (1 << i) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties)
-			return i;
-	}
-
-	THROW(true, "Failed to find suitable memory type!");
-}
-
 SwapchainSupportDetails QuerySwapchainSupport(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurface)
 {
 	// Simply checking swapchain availability is not enough,
@@ -161,17 +164,23 @@ QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceK
 	std::vector<VkQueueFamilyProperties> queueFamilies{ queueFamilyCount };
 	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
 
-	// find a queue that supports graphics commands
+	// find a queue that supports graphics (and compute) commands
 	for (int i = 0; i < queueFamilies.size(); ++i)
 	{
-		if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+		const VkQueueFlags graphicsAndCompute = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+		if ((queueFamilies[i].queueFlags & graphicsAndCompute) == graphicsAndCompute)
 			indices.graphicsFamily = i;
 
 		// check for queue family compatible for presentation
 		// the graphics queue and the presentation queue might end up being the
 		// same but we treat them as separate queues
+		// nothing is presented without a window surface (headless mode),
+		// so the graphics queue stands in for the present queue
 		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, windowSurface, &presentSupport);
+		if (windowSurface != VK_NULL_HANDLE)
+			vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, windowSurface, &presentSupport);
+		else
+			presentSupport = indices.graphicsFamily.has_value();
 
 		if (presentSupport)
 			indices.presentFamily = i;
@@ -180,6 +189,17 @@ QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceK
 			break;
 	}
 
+	// uploads on a dedicated transfer queue don't compete with the rendering
+	for (uint32_t i = 0; i < queueFamilyCount; ++i)
+	{
+		const VkQueueFlags queueFlags = queueFamilies[i].queueFlags;
+		if ((queueFlags & VK_QUEUE_TRANSFER_BIT) && !(queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+		{
+			indices.transferFamily = i;
+			break;
+		}
+	}
+
 	return indices;
 }
 
@@ -215,11 +235,12 @@ VkSurfaceFormatKHR ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& av
 	return availableFormats[0];
 }
 
-VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes)
+VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+	VkPresentModeKHR preferredPresentMode)
 {
 	for (const auto& presentMode : availablePresentModes)
 	{
-		if (presentMode == VK_PRESENT_MODE_MAILBOX_KHR)
+		if (presentMode == preferredPresentMode)
 			return presentMode;
 	}
 
@@ -257,7 +278,7 @@ VkFormat FindDepthFormat()
 
 // images and buffers
 void CreateImage(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
+	MemoryAllocator& allocator,
 	uint32_t width,
 	uint32_t height,
 	uint32_t miplevels,
@@ -267,7 +288,7 @@ void CreateImage(VkDevice deviceVk,
 	VkImageUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkImage& image,
-	VkDeviceMemory& imageMemory)
+	Allocation& imageAllocation)
 {
 	VkImageCreateInfo imgInfo{};
 	imgInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
@@ -290,15 +311,11 @@ void CreateImage(VkDevice deviceVk,
 	VkMemoryRequirements memRequirements{};
 	vkGetImageMemoryRequirements(deviceVk, image, &memRequirements);
 
-	VkMemoryAllocateInfo memAllocInfo{};
-	memAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	memAllocInfo.allocationSize = memRequirements.size;
-	memAllocInfo.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+	const ResourceTiling resourceTiling =
+		tiling == VK_IMAGE_TILING_OPTIMAL ? ResourceTiling::OPTIMAL : ResourceTiling::LINEAR;
+	imageAllocation = allocator.Allocate(memRequirements, properties, resourceTiling);
 
-	THROW(vkAllocateMemory(deviceVk, &memAllocInfo, nullptr, &imageMemory) != VK_SUCCESS,
-		"Failed to allocate image memory!")
-
-	vkBindImageMemory(deviceVk, image, imageMemory, 0);
+	vkBindImageMemory(deviceVk, image, imageAllocation.memory, imageAllocation.offset);
 }
 
 VkImageView CreateImageView(VkDevice deviceVk,
@@ -325,12 +342,12 @@ VkImageView CreateImageView(VkDevice deviceVk,
 }
 
 void CreateBuffer(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
+	MemoryAllocator& allocator,
 	VkDeviceSize size,
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkBuffer& buffer,
-	VkDeviceMemory& bufferMemory)
+	Allocation& bufferAllocation)
 {
 	VkBufferCreateInfo bufferInfo{};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -343,14 +360,9 @@ void CreateBuffer(VkDevice deviceVk,
 	VkMemoryRequirements memRequirements;
 	vkGetBufferMemoryRequirements(deviceVk, buffer, &memRequirements);
 
-	VkMemoryAllocateInfo allocMemory{};
-	allocMemory.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocMemory.allocationSize = memRequirements.size;
-	allocMemory.memoryTypeIndex = FindMemoryType(physicalDevice, memRequirements.memoryTypeBits, properties);
+	bufferAllocation = allocator.Allocate(memRequirements, properties, ResourceTiling::LINEAR);
 
-	THROW(vkAllocateMemory(deviceVk, &allocMemory, nullptr, &bufferMemory) != VK_SUCCESS, "Failed to allocate memory!")
-
-	vkBindBufferMemory(deviceVk, buffer, bufferMemory, 0);
+	vkBindBufferMemory(deviceVk, buffer, bufferAllocation.memory, bufferAllocation.offset);
 }
 
 void CopyBuffer(VkDevice deviceVk,
@@ -400,6 +412,34 @@ void CopyBufferToImage(VkDevice deviceVk,
 	EndSingleTimeCommands(cmdBuff, deviceVk, commandPool, graphicsQueue);
 }
 
+void CopyImageToBuffer(VkDevice deviceVk,
+	VkCommandPool commandPool,
+	VkQueue graphicsQueue,
+	VkImage image,
+	VkBuffer buffer,
+	uint32_t width,
+	uint32_t height)
+{
+	VkCommandBuffer cmdBuff = BeginSingleTimeCommands(deviceVk, commandPool);
+
+	// the image is expected to be in `VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL`
+	// and the buffer to be tightly packed
+	VkBufferImageCopy region{};
+	region.bufferOffset = 0;
+	region.bufferImageHeight = 0;
+	region.bufferRowLength = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { width, height, 1 };
+
+	vkCmdCopyImageToBuffer(cmdBuff, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, buffer, 1, &region);
+
+	EndSingleTimeCommands(cmdBuff, deviceVk, commandPool, graphicsQueue);
+}
+
 void GenerateMipmaps(VkDevice deviceVk,
 	VkPhysicalDevice physicalDevice,
 	VkCommandPool commandPool,
@@ -572,6 +612,15 @@ void TransitionImageLayout(VkDevice deviceVk,
 		srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
 		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
 	}
+	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_GENERAL)
+	{
+		// storage images
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+		srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+		dstStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+	}
 	else
 	{
 		LOG_AND_THROW("Unsupported layout transition!");
@@ -622,4 +671,30 @@ void EndSingleTimeCommands(VkCommandBuffer cmdBuff, VkDevice deviceVk, VkCommand
 }
 
 
+// image output
+/**
+ * Writes 8-bit RGBA (or BGRA) pixels as a binary PPM file (alpha is dropped)
+ */
+void SaveImagePpm(const char* path, uint32_t width, uint32_t height, const uint8_t* pixels, bool isBgra)
+{
+	std::ofstream file{ path, std::ios::binary };
+	THROW(!file.is_open(), "Error opening image file: {}", path)
+
+	file << "P6\n" << width << " " << height << "\n255\n";
+
+	std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* src = pixels + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			row[x * 3 + 0] = src[x * 4 + (isBgra ? 2 : 0)];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + (isBgra ? 0 : 2)];
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), static_cast<std::streamsize>(row.size()));
+	}
+}
+
+
 } // namespace utils
\ No newline at end of file
@@ -4,6 +4,7 @@
 #include <functional>
 #include <vulkan/vulkan.h>
 #include "engine/types.h"
+#include "engine/memoryAllocator.h"
 
 namespace utils {
 
@@ -14,14 +15,13 @@ VKAPI_ATTR VkBool32 VKAPI_CALL DebugCallback(VkDebugUtilsMessageSeverityFlagBits
 	const VkDebugUtilsMessengerCallbackDataEXT* pCallbakck,
 	void* pUserData);
 
-std::vector<const char*> GetRequiredExtensions();
+std::vector<const char*> GetRequiredExtensions(bool headless = false);
 bool CheckValidationLayerSupport();
 
 
 // device details functions
 bool IsDeviceSuitable(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurface);
 bool CheckDeviceExtensionSupport(VkPhysicalDevice physicalDevice);
-uint32_t FindMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, VkMemoryPropertyFlags properties);
 SwapchainSupportDetails QuerySwapchainSupport(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurface);
 QueueFamilyIndices FindQueueFamilies(VkPhysicalDevice physicalDevice, VkSurfaceKHR windowSurface);
 VkFormat FindSupportedFormat(const std::vector<VkFormat>& canditateFormats,
@@ -31,15 +31,18 @@ VkFormat FindSupportedFormat(const std::vector<VkFormat>& canditateFormats,
 
 // swapchain
 VkSurfaceFormatKHR ChooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+// @returns `preferredPresentMode` if it's available, FIFO otherwise (always available)
+VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+	VkPresentModeKHR preferredPresentMode);
 VkExtent2D ChooseExtent(const VkSurfaceCapabilitiesKHR& capabilities,
 	std::function<void(int* width, int* height)> pfnGetFramebufferSize);
 VkFormat FindDepthFormat();
 
 
 // images and buffers
+// the memory is sub-allocated from `allocator`, free it with `allocator.Free()` after destroying the image
 void CreateImage(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
+	MemoryAllocator& allocator,
 	uint32_t width,
 	uint32_t height,
 	uint32_t miplevels,
@@ -49,7 +52,7 @@ void CreateImage(VkDevice deviceVk,
 	VkImageUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkImage& image,
-	VkDeviceMemory& imageMemory);
+	Allocation& imageAllocation);
 
 VkImageView CreateImageView(VkDevice deviceVk,
 	VkImage image,
@@ -57,13 +60,15 @@ VkImageView CreateImageView(VkDevice deviceVk,
 	VkImageAspectFlags aspectFlags,
 	uint32_t miplevels);
 
+// the memory is sub-allocated from `allocator`, free it with `allocator.Free()` after destroying the buffer
+// host visible memory is persistently mapped (`Allocation::mappedData`)
 void CreateBuffer(VkDevice deviceVk,
-	VkPhysicalDevice physicalDevice,
+	MemoryAllocator& allocator,
 	VkDeviceSize size,
 	VkBufferUsageFlags usage,
 	VkMemoryPropertyFlags properties,
 	VkBuffer& buffer,
-	VkDeviceMemory& bufferMemory);
+	Allocation& bufferAllocation);
 
 void CopyBuffer(VkDevice deviceVk,
 	VkCommandPool commandPool,
@@ -80,6 +85,14 @@ void CopyBufferToImage(VkDevice deviceVk,
 	uint32_t width,
 	uint32_t height);
 
+void CopyImageToBuffer(VkDevice deviceVk,
+	VkCommandPool commandPool,
+	VkQueue graphicsQueue,
+	VkImage image,
+	VkBuffer buffer,
+	uint32_t width,
+	uint32_t height);
+
 void GenerateMipmaps(VkDevice deviceVk,
 	VkPhysicalDevice physicalDevice,
 	VkCommandPool commandPool,
@@ -108,4 +121,8 @@ void EndSingleTimeCommands(VkCommandBuffer cmdBuff,
 	VkQueue graphicsQueue);
 
 
+// image output
+void SaveImagePpm(const char* path, uint32_t width, uint32_t height, const uint8_t* pixels, bool isBgra);
+
+
 } // namespace utils
\ No newline at end of file